@@ -27,10 +27,16 @@ SOFTWARE.
 #include <hardware/pio.h>
 #include "abus.h"
 #include "abus_setup.h"
+#include "abus_timing.h"
 #include "abus_pin_config.h"
 #include "buffers.h"
 #include "businterface.h"
+#include "video_planes.h"
+#include "bus_jobs.h"
+#include "bus_stats.h"
+#include "bus_trace.h"
 #include "config/config.h"
+#include "dvi/a2dvi.h"
 
 #ifdef APPLE_MODEL_IIPLUS
     #include "videx_vterm.h"
@@ -42,12 +48,31 @@ void __time_critical_func(abus_clear_fifo)(void)
     {
         (void) abus_pio_blocking_read();
     }
+#ifdef FEATURE_BUS_STATS
+    // the current word dropped cycles on purpose: do not count its processing time
+    bus_stats_skip = true;
+#endif
 }
 
 void __time_critical_func(abus_init)()
 {
+#ifdef FEATURE_DVI_IRQ_CORE1
+    a2dvi_irq_core1_init();
+#endif
 #ifdef APPLE_MODEL_IIPLUS
     videx_vterm_init();
+#endif
+#ifdef FEATURE_VIDEO_PLANES
+    video_planes_init();
+#endif
+#ifdef FEATURE_BUS_JOBS
+    bus_jobs_init();
+#endif
+#ifdef FEATURE_BUS_STATS
+    bus_stats_init();
+#endif
+#ifdef FEATURE_BUS_TRACE
+    bus_trace_init();
 #endif
     abus_pio_setup();
 }
@@ -64,12 +89,41 @@ void __time_critical_func(abus_loop)()
         {
             gpio_xor_mask(1u << PICO_DEFAULT_LED_PIN);
             count = 100*1000;
+#ifdef FEATURE_BUS_FILTER
+            bus_filtered_counter = abus_pio_filtered_cycles();
+#endif
+#ifdef FEATURE_BUS_TIMING
+            abus_timing_update();
+#endif
+#ifdef FEATURE_BUS_JOBS
+            bus_jobs_update();
+#endif
+#ifdef FEATURE_BUS_STATS
+            bus_stats_update();
+#endif
         }
 
+#ifdef FEATURE_BUS_JOBS
+        // use the slack between bus cycles: job steps only run while the FIFO is empty
+        while ((abus_pio_fifo_level() == 0) && (bus_jobs_step()))
+        {
+        }
+#endif
+
         if (abus_pio_is_full())
             bus_overflow_counter++;
 
+#ifdef FEATURE_BUS_STATS
+        bus_stats_read(abus_pio_fifo_level());
+#endif
         uint32_t value = abus_pio_blocking_read();
+#ifdef FEATURE_BUS_STATS
+        const uint32_t start = bus_stats_begin();
+#endif
+#ifdef FEATURE_BUS_TRACE
+        if (bus_trace_armed)
+            bus_trace_record(value, ADDRESS_BUS(value));
+#endif
 
         if (language_switch_enabled)
         {
@@ -79,5 +133,8 @@ void __time_critical_func(abus_loop)()
         bus_counter++;
 
         businterface(value);
+#ifdef FEATURE_BUS_STATS
+        bus_stats_end(start);
+#endif
     }
 }
@@ -36,3 +36,12 @@ void abus_clear_fifo();
 #define CARD_DEVSEL(value)     ((value & (1u << (CONFIG_PIN_APPLEBUS_DEVSEL - CONFIG_PIN_APPLEBUS_DATA_BASE))) == 0)
 #define LANGUAGE_SWITCH(value) ((value & (1u << (CONFIG_PIN_LANGUAGE_SW     - CONFIG_PIN_APPLEBUS_DATA_BASE))) != 0)
 #define ADDRESS_BUS(value)     ((value >> 11) & 0xffff)
+#define BUS_DATA(value)        (value & 0xff)
+
+// Write cycles always carry the written data. Read cycles only carry the data read by the CPU
+// when the PIO samples it late in the cycle (FEATURE_READ_DATA), otherwise their data is undefined.
+#ifdef FEATURE_READ_DATA
+    #define ACCESS_READ_DATA(value) ACCESS_READ(value)
+#else
+    #define ACCESS_READ_DATA(value) false
+#endif
@@ -27,21 +27,55 @@ SOFTWARE.
 #include <hardware/pio.h>
 #include "abus_pin_config.h"
 #include "abus_setup.h"
+#include "abus_timing.h"
 #include "abus.pio.h"
 
 #if CONFIG_PIN_APPLEBUS_PHI0 != PHI0_GPIO
 #error CONFIG_PIN_APPLEBUS_PHI0 and PHI0_GPIO must be set to the same pin
 #endif
 
+#ifdef FEATURE_BUS_FILTER
+static void abus_pio_setup_filter_counter(void)
+{
+    PIO pio = CONFIG_ABUS_PIO;
+    const uint sm = ABUS_FILTER_SM;
+
+    uint program_offset = pio_add_program(pio, &abus_filter_counter_program);
+    pio_sm_claim(pio, sm);
+
+    pio_sm_config c = abus_filter_counter_program_get_default_config(program_offset);
+
+    pio_sm_init(pio, sm, program_offset, &c);
+
+    // start counting (down) from 0xffffffff: the program pushes the inverted counter
+    pio_sm_exec(pio, sm, pio_encode_mov_not(pio_x, pio_null));
+}
+#endif
+
 void abus_pio_setup(void)
 {
     PIO pio = CONFIG_ABUS_PIO;
     const uint sm = ABUS_MAIN_SM;
 
+#ifdef FEATURE_BUS_FILTER
+    uint program_offset = pio_add_program(pio, &abus_filtered_program);
+    pio_sm_claim(pio, sm);
+
+    pio_sm_config c = abus_filtered_program_get_default_config(program_offset);
+
+    // the filter shifts the copy of the address high byte out to the right
+    sm_config_set_out_shift(&c, true, false, 32);
+#elif defined(FEATURE_READ_DATA)
+    uint program_offset = pio_add_program(pio, &abus_read_data_program);
+    pio_sm_claim(pio, sm);
+
+    pio_sm_config c = abus_read_data_program_get_default_config(program_offset);
+#else
     uint program_offset = pio_add_program(pio, &abus_program);
     pio_sm_claim(pio, sm);
 
     pio_sm_config c = abus_program_get_default_config(program_offset);
+#endif
 
     // set the bus R/W pin as the jump pin
     sm_config_set_jmp_pin(&c, CONFIG_PIN_APPLEBUS_RW);
@@ -57,6 +91,10 @@ void abus_pio_setup(void)
 
     pio_sm_init(pio, sm, program_offset, &c);
 
+#ifdef FEATURE_BUS_TIMING
+    abus_timing_init(program_offset);
+#endif
+
     // configure the GPIOs
     // Ensure all transceivers will start disabled
     pio_sm_set_pins_with_mask(
@@ -83,5 +121,24 @@ void abus_pio_setup(void)
         gpio_set_pulls(pin, false, false);
     }
 
+#ifdef FEATURE_BUS_FILTER
+    abus_pio_setup_filter_counter();
+    pio_enable_sm_mask_in_sync(pio, (1 << ABUS_MAIN_SM) | (1 << ABUS_FILTER_SM));
+#else
     pio_enable_sm_mask_in_sync(pio, (1 << ABUS_MAIN_SM));
+#endif
+}
+
+#ifdef FEATURE_BUS_FILTER
+// Number of read cycles dropped by the PIO so far. Never waits: the counter state machine pushes
+// its count after each dropped cycle, but not while the RX FIFO is full. So the result may lag
+// behind by the cycles dropped since the previous call.
+uint32_t abus_pio_filtered_cycles(void)
+{
+    static uint32_t filtered_cycles;
+    PIO pio = CONFIG_ABUS_PIO;
+    while (!pio_sm_is_rx_fifo_empty(pio, ABUS_FILTER_SM))
+        filtered_cycles = pio_sm_get(pio, ABUS_FILTER_SM);
+    return filtered_cycles;
 }
+#endif
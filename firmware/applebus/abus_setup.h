@@ -31,6 +31,20 @@ SOFTWARE.
 
 // statemachines (0-3)
 #define ABUS_MAIN_SM    0
+#define ABUS_FILTER_SM  1 // counts the dropped read cycles (FEATURE_BUS_FILTER)
+
+// spare state machine measuring the PHI0 timing (FEATURE_BUS_TIMING). The 12 instructions of its
+// program fit next to abus (12) or abus_read_data (15) in PIO 0. With FEATURE_BUS_FILTER, abus_filtered
+// (27) and the filter counter (4) leave no room, so it borrows the DVI PIO's spare state machine. It
+// only runs for the calibration and is removed again.
+// Program sizes as reported by tools/pio_asm.py, which also checks that each layout fits into 32 slots.
+#ifdef FEATURE_BUS_FILTER
+#define CONFIG_ABUS_TIMING_PIO pio1
+#define ABUS_TIMING_SM  3
+#else
+#define CONFIG_ABUS_TIMING_PIO pio0
+#define ABUS_TIMING_SM  2
+#endif
 
 #define abus_pio_fifo_level()    (pio_sm_get_rx_fifo_level(CONFIG_ABUS_PIO, ABUS_MAIN_SM))
 #define abus_pio_is_full()       (pio_sm_is_rx_fifo_full(CONFIG_ABUS_PIO, ABUS_MAIN_SM))
@@ -38,3 +52,7 @@ SOFTWARE.
 #define abus_pio_blocking_read() (pio_sm_get_blocking(CONFIG_ABUS_PIO, ABUS_MAIN_SM))
 
 void abus_pio_setup(void);
+
+#ifdef FEATURE_BUS_FILTER
+uint32_t abus_pio_filtered_cycles(void);
+#endif
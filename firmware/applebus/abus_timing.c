@@ -0,0 +1,262 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <hardware/pio.h>
+#include <hardware/clocks.h>
+#include <hardware/timer.h>
+#include "abus_setup.h"
+#include "abus_pin_config.h"
+#include "abus_timing.h"
+#include "abus.pio.h"
+#include "buffers.h"
+
+#ifdef FEATURE_BUS_TIMING
+
+#ifdef FEATURE_BUS_FILTER
+    #define ABUS_TIMING_PROGRAM      abus_filtered_program
+    #define ABUS_OFFSET_ADDRLO_DELAY abus_filtered_offset_addrlo_delay
+    #define ABUS_OFFSET_DATA_DELAY   abus_filtered_offset_data_delay
+    #define ABUS_FILTER_CYCLES       1 // the filter's copy of the address high byte, taken from the data delay
+#elif defined(FEATURE_READ_DATA)
+    #define ABUS_TIMING_PROGRAM      abus_read_data_program
+    #define ABUS_OFFSET_ADDRLO_DELAY abus_read_data_offset_addrlo_delay
+    #define ABUS_OFFSET_DATA_DELAY   abus_read_data_offset_data_delay
+    #define ABUS_FILTER_CYCLES       0
+#else
+    #define ABUS_TIMING_PROGRAM      abus_program
+    #define ABUS_OFFSET_ADDRLO_DELAY abus_offset_addrlo_delay
+    #define ABUS_OFFSET_DATA_DELAY   abus_offset_data_delay
+    #define ABUS_FILTER_CYCLES       0
+#endif
+
+typedef struct
+{
+    uint8_t addrlo_delay; // delay after enabling the AddrLo transceiver
+    uint8_t data_delay;   // delay after enabling the Data transceiver (write cycles)
+    uint8_t read_delay;   // total delay before sampling the read data (FEATURE_READ_DATA)
+} abus_timing_t;
+
+// PIO cycles from the rising PHI0 edge until the written data is sampled
+#define ABUS_DATA_SAMPLE_CYCLES(t) (6+(t)->addrlo_delay+(t)->data_delay)
+
+#if defined(FEATURE_READ_DATA) && !defined(FEATURE_BUS_FILTER)
+// PIO cycles from the rising PHI0 edge until the read data is sampled
+#define ABUS_READ_SAMPLE_CYCLES(t) (8+(t)->addrlo_delay+(t)->read_delay)
+// the later of both sample points must be within the PHI0 high phase
+#define ABUS_SAMPLE_CYCLES(t) ((ABUS_READ_SAMPLE_CYCLES(t) > ABUS_DATA_SAMPLE_CYCLES(t)) ? ABUS_READ_SAMPLE_CYCLES(t) : ABUS_DATA_SAMPLE_CYCLES(t))
+#else
+#define ABUS_SAMPLE_CYCLES(t) ABUS_DATA_SAMPLE_CYCLES(t)
+#endif
+
+// PIO cycles between sampling the data and the end of the PHI0 high phase
+#define ABUS_SAMPLE_MARGIN 8
+
+// in the order of their sample points, latest first
+static const abus_timing_t abus_timings[ABUS_TIMING_PROFILES] =
+{
+    {10, 30, 73}, // 1MHz: write data sampled at P0+200ns (the original timing), read data at P0+418ns
+    {10, 16, 16}, // 2MHz: P0+150ns, P0+190ns
+    { 8,  8,  2}, // 3MHz: P0+115ns, P0+126ns (also used for faster buses, see abus_timing.h)
+};
+
+volatile uint8_t  bus_timing_profile = ABUS_TIMING_AUTO;
+volatile uint8_t  bus_timing_active  = 1;
+volatile uint32_t bus_clock_khz;
+volatile uint32_t bus_phi0_high_ns;
+volatile uint32_t bus_phi0_low_ns;
+volatile uint32_t bus_anomaly_counter;
+
+static uint abus_program_offset;
+static uint abus_timing_offset;
+static bool abus_timing_measuring;            // render core only
+static volatile uint8_t abus_timing_calibrated; // profile picked by the calibration (0: none yet)
+
+volatile bool abus_timing_request;           // the bus core asks the render core for a calibration
+
+static uint32_t abus_timing_last_cycles;
+static uint32_t abus_timing_last_us;
+
+static void __time_critical_func(abus_timing_patch)(uint instr, uint delay)
+{
+    // the instruction memory is write-only: start from the program's original instruction
+    const uint16_t instruction = ABUS_TIMING_PROGRAM.instructions[instr];
+    CONFIG_ABUS_PIO->instr_mem[abus_program_offset + instr] = (instruction & ~(0x1fu << 8)) | ((delay & 0x1f) << 8);
+}
+
+static void __time_critical_func(abus_timing_apply)(uint profile)
+{
+    const abus_timing_t* pTiming = &abus_timings[profile-1];
+    abus_timing_patch(ABUS_OFFSET_ADDRLO_DELAY, pTiming->addrlo_delay);
+    abus_timing_patch(ABUS_OFFSET_DATA_DELAY,   pTiming->data_delay - ABUS_FILTER_CYCLES);
+#if defined(FEATURE_READ_DATA) && !defined(FEATURE_BUS_FILTER)
+    // spread the read delay over the three delays of the read cycle (up to 31 each)
+    uint read_delay = pTiming->read_delay;
+    const uint delay1 = (read_delay > 31) ? 31 : read_delay;
+    read_delay -= delay1;
+    const uint delay2 = (read_delay > 31) ? 31 : read_delay;
+    abus_timing_patch(abus_read_data_offset_read_delay1, delay1);
+    abus_timing_patch(abus_read_data_offset_read_delay2, delay2);
+    abus_timing_patch(abus_read_data_offset_read_delay3, read_delay - delay2);
+#endif
+    bus_timing_active = profile;
+}
+
+void __time_critical_func(abus_timing_select)(uint8_t profile)
+{
+    if (profile > ABUS_TIMING_PROFILES)
+        return;
+    bus_timing_profile = profile;
+    if (profile == ABUS_TIMING_AUTO)
+    {
+        // measure again, the current timing is kept meanwhile
+        abus_timing_calibrated = 0;
+    }
+    else
+    {
+        abus_timing_apply(profile);
+    }
+}
+
+// start measuring the PHI0 timing on the spare state machine
+static void abus_timing_start(void)
+{
+    PIO pio = CONFIG_ABUS_TIMING_PIO;
+    const uint sm = ABUS_TIMING_SM;
+
+    abus_timing_offset = pio_add_program(pio, &abus_phi0_timing_program);
+    pio_sm_claim(pio, sm);
+
+    pio_sm_config c = abus_phi0_timing_program_get_default_config(abus_timing_offset);
+    sm_config_set_jmp_pin(&c, CONFIG_PIN_APPLEBUS_PHI0);
+    pio_sm_init(pio, sm, abus_timing_offset, &c);
+    pio_sm_set_enabled(pio, sm, true);
+
+    abus_timing_measuring = true;
+}
+
+// evaluate the measurement, once the state machine has reported two complete PHI0 cycles
+static void abus_timing_finish(void)
+{
+    PIO pio = CONFIG_ABUS_TIMING_PIO;
+    const uint sm = ABUS_TIMING_SM;
+
+    if (pio_sm_get_rx_fifo_level(pio, sm) < 4)
+        return;
+
+    // shortest high and low times of both cycles
+    uint32_t high = 0xffffffff;
+    uint32_t low  = 0xffffffff;
+    for (uint i=0;i<2;i++)
+    {
+        uint32_t count = pio_sm_get(pio, sm);
+        if (count < high)
+            high = count;
+        count = pio_sm_get(pio, sm);
+        if (count < low)
+            low = count;
+    }
+
+    pio_sm_set_enabled(pio, sm, false);
+    pio_sm_unclaim(pio, sm);
+    pio_remove_program(pio, &abus_phi0_timing_program, abus_timing_offset);
+    abus_timing_measuring = false;
+
+    // 2 PIO cycles per loop, both state machines use the same clock
+    const uint32_t high_cycles = 2*high;
+    const uint32_t khz = clock_get_hz(clk_sys) / 1000;
+    bus_phi0_high_ns = (uint32_t)((high_cycles * 1000000ull) / khz);
+    bus_phi0_low_ns  = (uint32_t)((2*low * 1000000ull) / khz);
+
+    // pick the latest sample point which still leaves the margin (the fastest profile, if none does)
+    uint profile = ABUS_TIMING_PROFILES;
+    for (uint p=0;p<ABUS_TIMING_PROFILES;p++)
+    {
+        if (ABUS_SAMPLE_CYCLES(&abus_timings[p]) + ABUS_SAMPLE_MARGIN <= high_cycles)
+        {
+            profile = p+1;
+            break;
+        }
+    }
+
+    // the bus core applies the profile
+    abus_timing_calibrated = profile;
+    abus_timing_request    = false;
+}
+
+// Render task, activated by abus_timing_request: loads the measuring program, and evaluates and removes
+// it after the next frame. Keeps the SDK's PIO functions (running from flash) off the bus core.
+bool abus_timing_calibrate(void)
+{
+    if (abus_timing_measuring)
+    {
+        abus_timing_finish();
+    }
+    else
+    if (abus_timing_request)
+    {
+        abus_timing_start();
+    }
+    return false;
+}
+
+// Called by the bus core every 100000 bus cycles: samples the bus frequency and applies the calibration.
+void __time_critical_func(abus_timing_update)(void)
+{
+    uint32_t cycles = bus_counter;
+#ifdef FEATURE_BUS_FILTER
+    cycles += bus_filtered_counter;
+#endif
+    const uint32_t now = time_us_32();
+    if (abus_timing_last_us)
+    {
+        bus_clock_khz = ((cycles - abus_timing_last_cycles) * 1000u) / (now - abus_timing_last_us);
+    }
+    abus_timing_last_cycles = cycles;
+    abus_timing_last_us     = now;
+
+    if (bus_timing_profile != ABUS_TIMING_AUTO)
+        return;
+
+    const uint profile = abus_timing_calibrated;
+    if (profile == 0)
+    {
+        // the system clock is final by the time the first frequency sample is available
+        if (bus_clock_khz)
+            abus_timing_request = true;
+    }
+    else
+    if (profile != bus_timing_active)
+    {
+        abus_timing_apply(profile);
+    }
+}
+
+void abus_timing_init(uint program_offset)
+{
+    abus_program_offset = program_offset;
+    abus_timing_apply((bus_timing_profile == ABUS_TIMING_AUTO) ? 1 : bus_timing_profile);
+}
+
+#endif // FEATURE_BUS_TIMING
@@ -0,0 +1,71 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Bus timing profiles (FEATURE_BUS_TIMING).
+// The profiles patch the delays of the bus interface's PIO program, moving the AddrLo and the
+// write data sample points closer to the rising PHI0 edge for faster buses (accelerated machines).
+// A spare state machine measures the PHI0 high and low times, so the automatic setting can pick
+// the profile with the latest sample point which is still safe. The render core loads and evaluates
+// the measurement (abus_timing_calibrate), the bus core only requests it and applies the result. With FEATURE_READ_DATA, the profiles
+// also move the read data sample point, and the calibration checks the later of both.
+// Without FEATURE_BUS_TIMING, all programs keep their fixed 1MHz timing: the read data of
+// FEATURE_READ_DATA is then sampled at P0+418ns, after PHI0 has already fallen on faster buses.
+// No profile samples the write data earlier than P0+115ns, where the original program already relies
+// on a valid ~DEVSEL (the read cycles' sample). Earlier sample points would need scope measurements
+// of the written data on a fast bus, which are not available: faster buses keep the 3MHz profile.
+#define ABUS_TIMING_AUTO     0 // profile chosen by the PHI0 calibration
+#define ABUS_TIMING_PROFILES 3 // fixed profiles 1..3, for buses of up to 1, 2 and 3MHz
+
+#ifdef FEATURE_BUS_TIMING
+
+extern volatile uint8_t  bus_timing_profile;  // selected profile (ABUS_TIMING_AUTO or 1..3)
+extern volatile uint8_t  bus_timing_active;   // profile in use (1..3)
+extern volatile uint32_t bus_clock_khz;       // sampled PHI0 frequency
+extern volatile uint32_t bus_phi0_high_ns;    // measured PHI0 high time (0: not calibrated yet)
+extern volatile uint32_t bus_phi0_low_ns;     // measured PHI0 low time
+extern volatile uint32_t bus_anomaly_counter; // impossible bus cycles, e.g. DEVSEL outside $C080-$C0FF
+extern volatile bool     abus_timing_request; // a PHI0 calibration is pending (render task trigger)
+
+extern void abus_timing_init(uint program_offset);
+extern void abus_timing_select(uint8_t profile);
+extern void abus_timing_update(void);
+extern bool abus_timing_calibrate(void);
+
+#endif
+
+// Called by the bus core for each bus cycle with an active DEVSEL signal.
+static inline void abus_timing_check_devsel(uint32_t address)
+{
+#ifdef FEATURE_BUS_TIMING
+    // DEVSEL is only active for the card's registers: anything else was sampled at the wrong time
+    if ((address & 0xff80) != 0xc080)
+        bus_anomaly_counter++;
+#endif
+}
@@ -33,6 +33,13 @@ volatile uint32_t frame_counter;
 volatile uint32_t devicereg_counter;
 volatile uint32_t devicerom_counter;
 volatile uint32_t vblank_counter;
+#ifdef FEATURE_READ_DATA
+volatile uint8_t  keyboard_data;
+volatile uint32_t keyboard_counter;
+#endif
+#ifdef FEATURE_BUS_FILTER
+volatile uint32_t bus_filtered_counter;
+#endif
 
 volatile uint16_t last_address;
 volatile uint16_t last_address_stack;
@@ -45,6 +52,9 @@ volatile uint16_t last_address_zp;
 
 volatile uint32_t soft_switches = SOFTSW_TEXT_MODE;
 volatile uint32_t internal_flags = IFLAGS_V7_MODE3;
+#ifdef FEATURE_FRAME_SNAPSHOT
+volatile uint32_t soft_switches_seq;
+#endif
 
 volatile uint8_t  cardslot;
 // Set SlotROM area to invalid address, so decoder does not trigger before the actual cardslot is determined.
@@ -52,19 +62,19 @@ volatile uint16_t card_rom_address = 0x00ff;
 
 volatile uint8_t reset_state = 0;
 
-uint8_t __attribute__((section (".appledata."))) apple_memory[MAX_ADDRESS];
-uint8_t __attribute__((section (".appledata."))) private_memory[MAX_ADDRESS];
+uint8_t __attribute__((section (".appledata."))) apple_memory[SHADOW_SIZE];
+uint8_t __attribute__((section (".appledata."))) private_memory[SHADOW_SIZE];
 
 uint8_t __attribute__((section (".appledata."))) status_line[4*40]; // 4 rows of 40 columns
 
-volatile uint8_t *text_p1 = apple_memory   + 0x0400;
-volatile uint8_t *text_p2 = apple_memory   + 0x0800;
-volatile uint8_t *text_p3 = private_memory + 0x0400;
-volatile uint8_t *text_p4 = private_memory + 0x0800;
-volatile uint8_t *hgr_p1  = apple_memory   + 0x2000;
-volatile uint8_t *hgr_p2  = apple_memory   + 0x4000;
-volatile uint8_t *hgr_p3  = private_memory + 0x2000;
-volatile uint8_t *hgr_p4  = private_memory + 0x4000;
+volatile uint8_t *text_p1 = apple_memory   + SHADOW_OFFSET(0x0400);
+volatile uint8_t *text_p2 = apple_memory   + SHADOW_OFFSET(0x0800);
+volatile uint8_t *text_p3 = private_memory + SHADOW_OFFSET(0x0400);
+volatile uint8_t *text_p4 = private_memory + SHADOW_OFFSET(0x0800);
+volatile uint8_t *hgr_p1  = apple_memory   + SHADOW_OFFSET(0x2000);
+volatile uint8_t *hgr_p2  = apple_memory   + SHADOW_OFFSET(0x4000);
+volatile uint8_t *hgr_p3  = private_memory + SHADOW_OFFSET(0x2000);
+volatile uint8_t *hgr_p4  = private_memory + SHADOW_OFFSET(0x4000);
 
 // The currently programmed character generator ROMs for text mode (US + local char set)
 uint8_t __attribute__((section (".appledata."))) character_rom[2* CHARACTER_ROM_SIZE];
@@ -35,6 +35,13 @@ extern volatile uint32_t frame_counter;
 extern volatile uint32_t devicereg_counter;
 extern volatile uint32_t devicerom_counter;
 extern volatile uint32_t vblank_counter;
+#ifdef FEATURE_READ_DATA
+extern volatile uint8_t  keyboard_data;        // most recent key read from $C000 (strobe cleared)
+extern volatile uint32_t keyboard_counter;     // number of key presses seen
+#endif
+#ifdef FEATURE_BUS_FILTER
+extern volatile uint32_t bus_filtered_counter; // read cycles dropped by the PIO (sampled)
+#endif
 
 extern volatile uint16_t last_address;
 extern volatile uint16_t last_address_stack;
@@ -52,8 +59,32 @@ extern volatile uint16_t card_rom_address;
 
 #define MAX_ADDRESS (0xC000)
 
-extern uint8_t apple_memory[MAX_ADDRESS];
-extern uint8_t private_memory[MAX_ADDRESS];
+#ifdef FEATURE_SPARSE_SHADOW
+// Sparse shadow: only the video pages are kept, i.e. TEXT/LORES pages 1+2 ($0400-$0BFF, which also
+// hold all machine signatures) and HIRES pages 1+2 ($2000-$5FFF). Writes to other addresses are dropped.
+#define SHADOW_TEXT_START   (0x0400)
+#define SHADOW_TEXT_SIZE    (0x0800)
+#define SHADOW_HIRES_START  (0x2000)
+#define SHADOW_HIRES_SIZE   (0x4000)
+#define SHADOW_SIZE         (SHADOW_TEXT_SIZE+SHADOW_HIRES_SIZE)
+#define SHADOW_STORED(addr) ((((uint32_t)(addr)) - SHADOW_TEXT_START  < SHADOW_TEXT_SIZE)||\
+                             (((uint32_t)(addr)) - SHADOW_HIRES_START < SHADOW_HIRES_SIZE))
+#define SHADOW_OFFSET(addr) ((((uint32_t)(addr)) < SHADOW_HIRES_START) ? \
+                             ((uint32_t)(addr)) - SHADOW_TEXT_START : \
+                             ((uint32_t)(addr)) - SHADOW_HIRES_START + SHADOW_TEXT_SIZE)
+#else
+// Full shadow of the Apple's main and aux RAM ($0000-$BFFF)
+#define SHADOW_SIZE         MAX_ADDRESS
+#define SHADOW_STORED(addr) true
+#define SHADOW_OFFSET(addr) (addr)
+#endif
+
+// Shadowed byte at an Apple address (the address must be SHADOW_STORED)
+#define APPLE_MEM(addr)     apple_memory[SHADOW_OFFSET(addr)]
+#define PRIVATE_MEM(addr)   private_memory[SHADOW_OFFSET(addr)]
+
+extern uint8_t apple_memory[SHADOW_SIZE];
+extern uint8_t private_memory[SHADOW_SIZE];
 
 extern uint8_t status_line[4*40]; // 4 rows of 40 columns
 
@@ -85,6 +116,41 @@ extern volatile uint32_t soft_switches;
 
 extern volatile uint32_t internal_flags;
 
+#ifdef FEATURE_FRAME_SNAPSHOT
+#include <hardware/sync.h>
+
+// sequence counter of soft_switches/internal_flags: odd while the bus core changes them
+extern volatile uint32_t soft_switches_seq;
+
+// Seqlock of the soft switches: the bus core (the only writer) brackets each change of
+// soft_switches/internal_flags, so the render core can read both consistently.
+static inline void soft_switches_write_begin(void)
+{
+    soft_switches_seq++;
+    __dmb();
+}
+
+static inline void soft_switches_write_end(void)
+{
+    __dmb();
+    soft_switches_seq++;
+}
+#else
+static inline void soft_switches_write_begin(void) {}
+static inline void soft_switches_write_end(void) {}
+#endif
+
+// Sets internal_flags, taking the seqlock only when they actually change.
+static inline void internal_flags_update(uint32_t flags)
+{
+    if (flags != internal_flags)
+    {
+        soft_switches_write_begin();
+        internal_flags = flags;
+        soft_switches_write_end();
+    }
+}
+
 #define SOFTSW_TEXT_MODE      0x00000001ul
 #define SOFTSW_MIX_MODE       0x00000002ul
 #define SOFTSW_HIRES_MODE     0x00000004ul
@@ -138,6 +204,6 @@ extern uint8_t character_rom[2*CHARACTER_ROM_SIZE];
 extern uint8_t custom_font_buffer[2*CHARACTER_ROM_SIZE];
 
 #define IS_IFLAG(FLAGS)             ((internal_flags & FLAGS)==FLAGS)
-#define SET_IFLAG(condition, FLAGS) { if (condition) internal_flags |= FLAGS;else internal_flags &= ~FLAGS; }
+#define SET_IFLAG(condition, FLAGS) internal_flags_update((condition) ? (internal_flags | (FLAGS)) : (internal_flags & ~(FLAGS)))
 
 #define IS_SOFTSWITCH(FLAGS)        ((soft_switches & FLAGS)==FLAGS)
@@ -0,0 +1,147 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <pico/stdlib.h>
+#include <hardware/clocks.h>
+#include <hardware/sync.h>
+#include "bus_jobs.h"
+#include "util/cycles.h"
+
+#ifdef FEATURE_BUS_JOBS
+
+// single producer (core 0), single consumer (bus core) ring of queued jobs
+static bus_job_t* volatile bus_job_queue[BUS_JOB_QUEUE_SIZE];
+static volatile uint32_t   bus_job_head;  // written by core 0
+static volatile uint32_t   bus_job_tail;  // written by the bus core
+
+volatile uint32_t bus_job_steps;
+volatile uint32_t bus_job_max_cycles;
+volatile uint32_t bus_job_load;
+
+// bus core: CPU cycles spent in job steps, since the last update
+static uint32_t bus_job_cycles;
+static uint32_t bus_job_update_time;
+static uint32_t bus_job_mhz;
+
+// Called on the bus core: the cycle counter is private to each core.
+void bus_jobs_init(void)
+{
+    cycle_counter_init();
+    bus_job_mhz = clock_get_hz(clk_sys) / 1000000;
+    bus_job_update_time = time_us_32();
+}
+
+// Queue a job, called on core 0. The job must remain valid until it is done.
+bool bus_jobs_submit(bus_job_t* pJob)
+{
+    const uint32_t head = bus_job_head;
+    if (head - bus_job_tail >= BUS_JOB_QUEUE_SIZE)
+        return false;
+    pJob->done = false;
+    bus_job_queue[head & (BUS_JOB_QUEUE_SIZE-1)] = pJob;
+    __dmb();
+    bus_job_head = head+1;
+    return true;
+}
+
+// Copies words until the job is done or the step has taken BUS_JOB_STEP_CYCLES, at least one word.
+static bool __time_critical_func(bus_jobs_copy_step)(bus_job_t* pJob)
+{
+    const uint32_t start = cycle_counter_now();
+    uint32_t words = pJob->words;
+    if (words == 0)
+        return true;
+    uint32_t* dest = pJob->dest;
+    const uint32_t* src = pJob->src;
+    do
+    {
+        *(dest++) = *(src++);
+    } while ((--words) && (cycle_counter_since(start) < BUS_JOB_STEP_CYCLES));
+    pJob->words = words;
+    pJob->dest  = dest;
+    pJob->src   = src;
+    return (words == 0);
+}
+
+// Queue a copy of word aligned data (e.g. from flash), as many words per step as the cycle budget allows.
+bool bus_jobs_copy(bus_job_t* pJob, void* dest, const void* src, uint32_t size)
+{
+    pJob->step  = bus_jobs_copy_step;
+    pJob->dest  = (uint32_t*) dest;
+    pJob->src   = (const uint32_t*) src;
+    pJob->words = size/4;
+    return bus_jobs_submit(pJob);
+}
+
+// Free entries of the queue, called on core 0 (the only producer: the space can only grow meanwhile).
+uint32_t bus_jobs_space(void)
+{
+    return BUS_JOB_QUEUE_SIZE - (bus_job_head - bus_job_tail);
+}
+
+bool bus_jobs_pending(void)
+{
+    return (bus_job_head != bus_job_tail);
+}
+
+// Run one step of the oldest job on the bus core. Returns false when there was nothing to do.
+bool __time_critical_func(bus_jobs_step)(void)
+{
+    const uint32_t tail = bus_job_tail;
+    if (tail == bus_job_head)
+        return false;
+    __dmb();
+
+    bus_job_t* pJob = bus_job_queue[tail & (BUS_JOB_QUEUE_SIZE-1)];
+    const uint32_t start = cycle_counter_now();
+    const bool done = pJob->step(pJob);
+    const uint32_t cycles = cycle_counter_since(start);
+
+    bus_job_steps++;
+    bus_job_cycles += cycles;
+    if (cycles > bus_job_max_cycles)
+        bus_job_max_cycles = cycles;
+
+    if (done)
+    {
+        pJob->done = true;
+        __dmb();
+        bus_job_tail = tail+1;
+    }
+    return true;
+}
+
+// Called by the bus core every 100000 bus cycles: share of the time spent in job steps.
+void __time_critical_func(bus_jobs_update)(void)
+{
+    const uint32_t now = time_us_32();
+    const uint64_t elapsed = (uint64_t)(now - bus_job_update_time) * bus_job_mhz;
+    bus_job_update_time = now;
+    if (elapsed)
+        bus_job_load = (uint32_t)((bus_job_cycles * 100ull) / elapsed);
+    bus_job_cycles = 0;
+}
+
+#endif // FEATURE_BUS_JOBS
@@ -0,0 +1,70 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Bus core jobs (FEATURE_BUS_JOBS).
+// Core 1 spends most of each bus cycle waiting for the next word of the PIO. abus_loop() uses this
+// slack for jobs queued by core 0: whenever the PIO's RX FIFO is empty, it runs one step of the
+// oldest job, then checks the FIFO again. A step must return well before the 4 entry FIFO fills up
+// (4 bus cycles: about 1000 CPU cycles at 1MHz, 250 at 4MHz), so the bus core always returns to the
+// FIFO in time. The steps are bounded by the core's cycle counter rather than by a word count: a word
+// read from flash costs a few cycles on an XIP cache hit, but up to about a hundred on a miss.
+// bus_job_max_cycles reports the longest step actually taken.
+#define BUS_JOB_QUEUE_SIZE  8   // power of 2
+#define BUS_JOB_STEP_CYCLES 128 // a step stops copying after this many CPU cycles (plus one word's read)
+
+typedef struct bus_job_s bus_job_t;
+
+// Runs one bounded step of the job. Returns true when the job is complete.
+typedef bool (*bus_job_step_t)(bus_job_t* pJob);
+
+struct bus_job_s
+{
+    bus_job_step_t  step;
+    uint32_t*       dest;
+    const uint32_t* src;
+    uint32_t        words;  // copy jobs: words left to copy
+    volatile bool   done;
+};
+
+#ifdef FEATURE_BUS_JOBS
+
+extern volatile uint32_t bus_job_steps;       // job steps run so far
+extern volatile uint32_t bus_job_max_cycles;  // longest job step (CPU cycles)
+extern volatile uint32_t bus_job_load;        // share of the bus core's time spent in job steps (%)
+
+extern void bus_jobs_init(void);
+extern bool bus_jobs_submit(bus_job_t* pJob);
+extern bool bus_jobs_copy(bus_job_t* pJob, void* dest, const void* src, uint32_t size);
+extern uint32_t bus_jobs_space(void);
+extern bool bus_jobs_pending(void);
+extern bool bus_jobs_step(void);
+extern void bus_jobs_update(void);
+
+#endif
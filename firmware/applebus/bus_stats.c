@@ -0,0 +1,81 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <pico/stdlib.h>
+#include <hardware/clocks.h>
+#include "bus_stats.h"
+
+#ifdef FEATURE_BUS_STATS
+
+volatile bus_stats_t bus_stats;
+volatile uint32_t    bus_stats_peak_cycles;
+
+uint32_t bus_stats_fifo[BUS_STATS_FIFO_LEVELS];
+uint32_t bus_stats_busy;
+uint32_t bus_stats_max;
+bool     bus_stats_skip;
+uint32_t bus_stats_skipped;
+
+static uint32_t bus_stats_update_time;
+static uint32_t bus_stats_mhz;
+
+// Called on the bus core: the cycle counter is private to each core.
+void bus_stats_init(void)
+{
+    cycle_counter_init();
+    bus_stats_mhz = clock_get_hz(clk_sys) / 1000000;
+    bus_stats_update_time = time_us_32();
+}
+
+// Called by the bus core every 100000 bus words: publish the statistics of the period.
+void __time_critical_func(bus_stats_update)(void)
+{
+    const uint32_t now = time_us_32();
+    const uint64_t elapsed = (uint64_t)(now - bus_stats_update_time) * bus_stats_mhz;
+    bus_stats_update_time = now;
+
+    uint32_t words = 0;
+    for (uint i=0;i<BUS_STATS_FIFO_LEVELS;i++)
+    {
+        bus_stats.fifo_levels[i] = bus_stats_fifo[i];
+        words += bus_stats_fifo[i];
+        bus_stats_fifo[i] = 0;
+    }
+    bus_stats.words        = words;
+    bus_stats.busy_percent = (elapsed) ? (uint32_t)((bus_stats_busy * 100ull) / elapsed) : 0;
+    // skipped words are in the FIFO histogram, but not in the busy time
+    const uint32_t measured = words - bus_stats_skipped;
+    bus_stats.avg_cycles   = (measured) ? bus_stats_busy / measured : 0;
+    bus_stats.max_cycles   = bus_stats_max;
+
+    if (bus_stats_max > bus_stats_peak_cycles)
+        bus_stats_peak_cycles = bus_stats_max;
+
+    bus_stats_busy    = 0;
+    bus_stats_max     = 0;
+    bus_stats_skipped = 0;
+}
+
+#endif // FEATURE_BUS_STATS
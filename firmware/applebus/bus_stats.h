@@ -0,0 +1,93 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Bus core telemetry (FEATURE_BUS_STATS).
+// abus_loop() records the PIO's RX FIFO level before reading each bus word, and measures the CPU
+// cycles spent processing the word with the core's SysTick timer. Every 100000 bus words, the bus
+// core publishes the FIFO level histogram, the share of its time spent processing words (the rest
+// is spent waiting for the PIO, or in bus jobs) and the longest processing time. Words whose
+// processing cleared the FIFO (the configuration menu) are not measured: they drop cycles on purpose.
+// The measurement itself adds about 34 cycles per bus word. tools/cycle_model.py replay runs abus_loop()
+// on a cycle model and prints these figures next to its own.
+#define BUS_STATS_FIFO_LEVELS 5 // RX FIFO levels 0..4 (4: full)
+
+typedef struct
+{
+    uint32_t fifo_levels[BUS_STATS_FIFO_LEVELS]; // bus words read at each FIFO level
+    uint32_t words;         // bus words in the period
+    uint32_t busy_percent;  // share of the bus core's time spent processing words (%)
+    uint32_t avg_cycles;    // average processing time per measured word (CPU cycles)
+    uint32_t max_cycles;    // longest processing time of a word (CPU cycles)
+} bus_stats_t;
+
+#ifdef FEATURE_BUS_STATS
+#include "util/cycles.h"
+
+extern volatile bus_stats_t bus_stats;  // most recent period, published by bus_stats_update()
+extern volatile uint32_t bus_stats_peak_cycles; // longest processing time of a word since start-up
+
+// bus core only: counters of the current period
+extern uint32_t bus_stats_fifo[BUS_STATS_FIFO_LEVELS];
+extern uint32_t bus_stats_busy;
+extern uint32_t bus_stats_max;
+extern bool     bus_stats_skip;
+extern uint32_t bus_stats_skipped;
+
+extern void bus_stats_init(void);
+extern void bus_stats_update(void);
+
+// Called before reading a bus word, with the RX FIFO level.
+static __force_inline void bus_stats_read(uint32_t fifo_level)
+{
+    bus_stats_fifo[fifo_level]++;
+}
+
+// Called when the bus word was read: returns the start time of its processing.
+static __force_inline uint32_t bus_stats_begin(void)
+{
+    return cycle_counter_now();
+}
+
+// Called when the bus word was processed.
+static __force_inline void bus_stats_end(uint32_t start)
+{
+    const uint32_t cycles = cycle_counter_since(start);
+    if (bus_stats_skip)
+    {
+        bus_stats_skip = false;
+        bus_stats_skipped++;
+        return;
+    }
+    bus_stats_busy += cycles;
+    if (cycles > bus_stats_max)
+        bus_stats_max = cycles;
+}
+
+#endif
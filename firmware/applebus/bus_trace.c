@@ -0,0 +1,238 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <pico/stdlib.h>
+#include <hardware/clocks.h>
+#include <hardware/flash.h>
+#include "abus.h"
+#include "bus_trace.h"
+#include "config/config.h"
+
+#ifdef FEATURE_BUS_TRACE
+
+bool     bus_trace_armed;
+uint32_t bus_trace_index;
+uint32_t bus_trace_time;
+uint32_t bus_trace_post;
+uint32_t bus_trace_trigger_at = 0xffffffff;
+uint32_t bus_trace_first;
+uint32_t bus_trace_span;
+uint32_t bus_trace_rw_mask;
+uint32_t bus_trace_rw_match;
+uint32_t bus_trace_values[BUS_TRACE_SIZE];
+uint16_t bus_trace_deltas[BUS_TRACE_SIZE];
+
+// configuration
+static bus_trace_trigger_t bus_trace_trigger = BUS_TRACE_STOP;
+static uint32_t bus_trace_range = 0x3fff2000;   // last:first address (default: HIRES pages)
+static uint32_t bus_trace_post_words = BUS_TRACE_SIZE/2;
+
+#define BUS_TRACE_RW_BIT     (CONFIG_PIN_APPLEBUS_RW     - CONFIG_PIN_APPLEBUS_DATA_BASE)
+#define BUS_TRACE_DEVSEL_BIT (CONFIG_PIN_APPLEBUS_DEVSEL - CONFIG_PIN_APPLEBUS_DATA_BASE)
+
+extern uint8_t __config_data_start[];
+
+// the export must fit into the configuration area (60KB), behind the configuration
+typedef char bus_trace_export_size_check[(BUS_TRACE_EXPORT_OFFSET + sizeof(bus_trace_header_t) +
+                                          BUS_TRACE_SIZE*sizeof(bus_trace_record_t) <= 60*1024) - 1];
+
+// tools/bus_trace.py and tools/usb_stream.py rely on the header layout
+typedef char bus_trace_header_size_check[(sizeof(bus_trace_header_t) == 36) - 1];
+
+static const char* bus_trace_trigger_names[BUS_TRACE_TRIGGERS] =
+{
+    "NONE", "MANUAL", "WRITE", "ACCESS", "SWITCH", "RESET"
+};
+
+// Called on the bus core: the cycle counter is private to each core.
+void bus_trace_init(void)
+{
+    cycle_counter_init();
+}
+
+// Start a new recording, which stops 'post' words after the given trigger.
+void bus_trace_arm(bus_trace_trigger_t trigger)
+{
+    bus_trace_armed = false;
+    if ((trigger == BUS_TRACE_STOP)||(trigger >= BUS_TRACE_TRIGGERS))
+        return;
+
+    uint32_t first = bus_trace_range & 0xffff;
+    uint32_t last  = bus_trace_range >> 16;
+    bus_trace_rw_mask  = 0;
+    bus_trace_rw_match = 0;
+    switch(trigger)
+    {
+        case BUS_TRACE_WRITE:
+            bus_trace_rw_mask = 1u << BUS_TRACE_RW_BIT;
+            break;
+        case BUS_TRACE_SWITCH:
+            first = 0xC050;
+            last  = 0xC05F;
+            break;
+        case BUS_TRACE_RESET:
+            first = last = 0xFFFC;
+            bus_trace_rw_mask = bus_trace_rw_match = 1u << BUS_TRACE_RW_BIT;
+            break;
+        case BUS_TRACE_MANUAL:
+            first = 0x10000; // never matches a 16bit address
+            last  = 0x10000;
+            break;
+        default:
+            break;
+    }
+    bus_trace_trigger    = trigger;
+    bus_trace_first      = first;
+    bus_trace_span       = (last >= first) ? last - first : 0;
+    bus_trace_index      = 0;
+    bus_trace_post       = 0;
+    bus_trace_trigger_at = 0xffffffff;
+    bus_trace_time       = cycle_counter_now();
+    bus_trace_armed      = true;
+}
+
+// Arm again with the most recent trigger.
+void bus_trace_rearm(void)
+{
+    bus_trace_arm((bus_trace_trigger == BUS_TRACE_STOP) ? BUS_TRACE_MANUAL : bus_trace_trigger);
+}
+
+// The recorded word matched the trigger: keep recording for the configured number of words.
+void __time_critical_func(bus_trace_triggered)(void)
+{
+    bus_trace_trigger_at = bus_trace_index-1;
+    bus_trace_post = bus_trace_post_words;
+    if (bus_trace_post == 0)
+        bus_trace_armed = false;
+}
+
+// Trigger address range, written as 4 bytes: first (low, high), last (low, high).
+void bus_trace_set_range(uint8_t data)
+{
+    bus_trace_range = (bus_trace_range >> 8) | (data << 24);
+}
+
+// Words recorded after the trigger, in 1/256 of the ring.
+void bus_trace_set_post(uint8_t data)
+{
+    bus_trace_post_words = (data * BUS_TRACE_SIZE) / 256;
+}
+
+uint32_t bus_trace_count(void)
+{
+    return (bus_trace_index < BUS_TRACE_SIZE) ? bus_trace_index : BUS_TRACE_SIZE;
+}
+
+// Get a record of the capture, oldest first.
+bool bus_trace_get(uint32_t record, bus_trace_record_t* pRecord)
+{
+    const uint32_t count = bus_trace_count();
+    if (record >= count)
+        return false;
+    const uint32_t i = (bus_trace_index - count + record) & (BUS_TRACE_SIZE-1);
+    pRecord->value  = bus_trace_values[i];
+    pRecord->cycles = bus_trace_deltas[i];
+    return true;
+}
+
+// Record number of the trigger word, or -1.
+int32_t bus_trace_trigger_record(void)
+{
+    const uint32_t count = bus_trace_count();
+    if ((bus_trace_trigger_at == 0xffffffff)||(bus_trace_index - bus_trace_trigger_at > count))
+        return -1;
+    return count - (bus_trace_index - bus_trace_trigger_at);
+}
+
+const char* bus_trace_state(void)
+{
+    if (!bus_trace_armed)
+        return (bus_trace_index) ? "STOPPED" : "EMPTY";
+    return (bus_trace_post) ? "TRIGGERED" : "ARMED";
+}
+
+const char* bus_trace_trigger_name(void)
+{
+    return bus_trace_trigger_names[bus_trace_trigger];
+}
+
+// Header describing the current capture (export format, also used by the USB stream).
+void bus_trace_get_header(bus_trace_header_t* pHeader)
+{
+    memset(pHeader, 0, sizeof(*pHeader));
+    pHeader->magic         = BUS_TRACE_MAGIC;
+    pHeader->version       = BUS_TRACE_VERSION;
+    pHeader->header_size   = sizeof(*pHeader);
+    pHeader->count         = bus_trace_count();
+    pHeader->trigger_index = (bus_trace_trigger_record() < 0) ? 0xffffffff : (uint32_t) bus_trace_trigger_record();
+    pHeader->clock_khz     = clock_get_hz(clk_sys) / 1000;
+    pHeader->trigger       = bus_trace_trigger;
+    pHeader->rw_bit        = BUS_TRACE_RW_BIT;
+    pHeader->devsel_bit    = BUS_TRACE_DEVSEL_BIT;
+    pHeader->address_shift = 11;
+    pHeader->trigger_first = bus_trace_first;
+    pHeader->trigger_last  = bus_trace_first + bus_trace_span;
+}
+
+// Write the capture to flash (stops the recording). Bus cycles are missed while the flash is written.
+bool bus_trace_export(void)
+{
+    bus_trace_armed = false;
+
+    uint8_t* sector = malloc(FLASH_SECTOR_SIZE);
+    if (!sector)
+        return false;
+
+    bus_trace_header_t header;
+    bus_trace_get_header(&header);
+
+    const uint32_t size = sizeof(header) + header.count*sizeof(bus_trace_record_t);
+    uint8_t* flash = __config_data_start + BUS_TRACE_EXPORT_OFFSET;
+    uint32_t record = 0;
+    for (uint32_t offset=0;offset<size;offset+=FLASH_SECTOR_SIZE)
+    {
+        memset(sector, 0xff, FLASH_SECTOR_SIZE);
+        uint32_t pos = 0;
+        if (offset == 0)
+        {
+            memcpy(sector, &header, sizeof(header));
+            pos = sizeof(header);
+        }
+        bus_trace_record_t* pRecord = (bus_trace_record_t*) &sector[pos];
+        for (;(pos+sizeof(bus_trace_record_t) <= FLASH_SECTOR_SIZE) && (bus_trace_get(record, pRecord));pos+=sizeof(bus_trace_record_t))
+        {
+            record++;
+            pRecord++;
+        }
+        config_flash_write(flash+offset, sector, FLASH_SECTOR_SIZE);
+    }
+
+    free(sector);
+    return true;
+}
+
+#endif // FEATURE_BUS_TRACE
@@ -0,0 +1,139 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Bus trace recorder (FEATURE_BUS_TRACE).
+// While armed, abus_loop() records every bus word with the CPU cycles since the previous word into a
+// RAM ring. A trigger (a write or access to an address range, a video soft-switch access or a reset)
+// stops the recording after a configurable number of further words, so the ring holds the bus
+// activity around the trigger. Without a trigger, the recording runs until it is stopped. Disarmed,
+// the recorder costs abus_loop() a single test per bus word.
+// Everything runs on the bus core: recording, the configuration registers, the menu's viewer page
+// and the export, which writes the capture to flash (see bus_trace_export). The USB stream reads the
+// stopped ring from the render core (FEATURE_USB_STREAM).
+#ifdef FEATURE_PICO2
+    #define BUS_TRACE_SIZE 2048 // power of 2
+#else
+    #define BUS_TRACE_SIZE 1024
+#endif
+
+// triggers (also the values of the control register, see device_regs.c)
+typedef enum
+{
+    BUS_TRACE_STOP    = 0,  // disarm
+    BUS_TRACE_MANUAL  = 1,  // record until stopped
+    BUS_TRACE_WRITE   = 2,  // write to the trigger address range
+    BUS_TRACE_ACCESS  = 3,  // read or write of the trigger address range
+    BUS_TRACE_SWITCH  = 4,  // access to a video soft switch ($C050-$C05F)
+    BUS_TRACE_RESET   = 5,  // reset (read of the reset vector)
+    BUS_TRACE_TRIGGERS
+} bus_trace_trigger_t;
+
+// Export format (little endian), written to flash at BUS_TRACE_EXPORT_OFFSET within the configuration
+// area: a header followed by 'count' records of the raw bus word and its cycle delta, oldest first.
+// tools/bus_trace.py decodes it, and the raw words can be replayed through businterface().
+#define BUS_TRACE_MAGIC          0x52543241 // 'A2TR'
+#define BUS_TRACE_VERSION        2 // 2: 32bit trigger address range
+#define BUS_TRACE_EXPORT_OFFSET  0x8000     // 32KB into the configuration area
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t count;         // number of records
+    uint32_t trigger_index; // record of the trigger word (0xffffffff: not triggered)
+    uint32_t clock_khz;     // CPU clock of the cycle deltas
+    uint8_t  trigger;       // bus_trace_trigger_t
+    uint8_t  rw_bit;        // bit of the bus word which is set for read cycles
+    uint8_t  devsel_bit;    // bit of the bus word which is clear for accesses to the card's registers
+    uint8_t  address_shift; // address bits of the bus word (16 bits)
+    uint32_t trigger_first; // trigger address range (0x10000: no address trigger)
+    uint32_t trigger_last;
+    uint32_t reserved;
+} bus_trace_header_t;
+
+typedef struct
+{
+    uint32_t value;         // raw bus word of the PIO
+    uint32_t cycles;        // CPU cycles since the previous word (saturated at 0xffff)
+} bus_trace_record_t;
+
+#ifdef FEATURE_BUS_TRACE
+#include "util/cycles.h"
+
+extern bool     bus_trace_armed;
+extern uint32_t bus_trace_index;      // total words recorded since arming
+extern uint32_t bus_trace_time;
+extern uint32_t bus_trace_post;       // words still to record after the trigger (0: not triggered)
+extern uint32_t bus_trace_trigger_at; // bus_trace_index of the trigger word (0xffffffff: none)
+extern uint32_t bus_trace_first;      // trigger address range, as first address and span
+extern uint32_t bus_trace_span;
+extern uint32_t bus_trace_rw_mask;    // trigger cycle type: (value & mask) == match
+extern uint32_t bus_trace_rw_match;
+extern uint32_t bus_trace_values[BUS_TRACE_SIZE];
+extern uint16_t bus_trace_deltas[BUS_TRACE_SIZE];
+
+extern void     bus_trace_init(void);
+extern void     bus_trace_arm(bus_trace_trigger_t trigger);
+extern void     bus_trace_rearm(void);
+extern void     bus_trace_triggered(void);
+extern void     bus_trace_set_range(uint8_t data);
+extern void     bus_trace_set_post(uint8_t data);
+extern uint32_t bus_trace_count(void);
+extern bool     bus_trace_get(uint32_t record, bus_trace_record_t* pRecord);
+extern int32_t  bus_trace_trigger_record(void);
+extern void     bus_trace_get_header(bus_trace_header_t* pHeader);
+extern bool     bus_trace_export(void);
+extern const char* bus_trace_state(void);
+extern const char* bus_trace_trigger_name(void);
+
+// Record a bus word, called by abus_loop() while armed.
+static __force_inline void bus_trace_record(uint32_t value, uint32_t address)
+{
+    const uint32_t now = cycle_counter_now();
+    const uint32_t delta = cycle_counter_between(bus_trace_time, now);
+    const uint32_t i = (bus_trace_index++) & (BUS_TRACE_SIZE-1);
+    bus_trace_time = now;
+    bus_trace_values[i] = value;
+    bus_trace_deltas[i] = (delta > 0xffff) ? 0xffff : delta;
+
+    if (bus_trace_post)
+    {
+        if (--bus_trace_post == 0)
+            bus_trace_armed = false;
+    }
+    else
+    if (((address - bus_trace_first) <= bus_trace_span) && ((value & bus_trace_rw_mask) == bus_trace_rw_match))
+    {
+        bus_trace_triggered();
+    }
+}
+
+#endif
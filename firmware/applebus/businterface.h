@@ -26,4 +26,11 @@ SOFTWARE.
 
 #pragma once
 
-void businterface(uint32_t value);
+#include "config/config.h"
+
+typedef void (*businterface_t)(uint32_t value);
+
+// bus decoder specialized for the current machine type
+extern businterface_t volatile businterface;
+
+extern void businterface_select(compat_t machine);
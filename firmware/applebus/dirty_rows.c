@@ -0,0 +1,96 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <pico/stdlib.h>
+#include <string.h>
+#include <hardware/sync.h>
+#include "config/config.h"
+#include "dirty_rows.h"
+
+#ifdef FEATURE_DIRTY_ROWS
+
+volatile uint8_t __attribute__((aligned(4))) dirty_rows_text[2][2*1024/128][4];
+volatile uint8_t __attribute__((aligned(4))) dirty_rows_hires[2][2*8192/128][4];
+
+// Render core: clears the flags of a 128 byte block, returns the flagged 40 byte groups as bits 0..2.
+static inline uint32_t dirty_rows_take(volatile uint8_t* pFlags)
+{
+    // most blocks are unchanged: check their 4 flags at once
+    if (*(volatile uint32_t*) pFlags == 0)
+        return 0;
+    uint32_t groups = 0;
+    for (uint group=0;group<4;group++)
+    {
+        if (pFlags[group])
+        {
+            pFlags[group] = 0;
+            groups |= 1u << group;
+        }
+    }
+    return groups & 7; // without the screen hole
+}
+
+// Render core: collect the rows written since the previous snapshot and clear them.
+// A row written while the snapshot is taken is either reported now or by the next snapshot.
+void DELAYED_COPY_CODE(dirty_rows_snapshot)(dirty_rows_t* pDirty)
+{
+    memset(pDirty, 0, sizeof(dirty_rows_t));
+    for (uint bank=0;bank<2;bank++)
+    {
+        // text block: page (bit 3), row within the group (bits 0..2)
+        for (uint block=0;block<2*1024/128;block++)
+        {
+            for (uint32_t groups = dirty_rows_take(dirty_rows_text[bank][block]);groups;groups &= groups-1)
+            {
+                const uint row = __builtin_ctz(groups)*8 + (block & 7);
+                pDirty->text[block >> 3][bank] |= 1u << row;
+            }
+        }
+        // HIRES block: page (bit 6), line bits 0..2 (bits 3..5), line bits 3..5 (bits 0..2)
+        for (uint block=0;block<2*8192/128;block++)
+        {
+            for (uint32_t groups = dirty_rows_take(dirty_rows_hires[bank][block]);groups;groups &= groups-1)
+            {
+                const uint line = __builtin_ctz(groups)*64 + ((block & 7) << 3) + ((block >> 3) & 7);
+                pDirty->hires[block >> 6][bank][line >> 5] |= 1u << (line & 31);
+            }
+        }
+    }
+    // the shadow memory of the reported rows must not be read before the flags were cleared
+    __dmb();
+}
+
+bool DELAYED_COPY_CODE(dirty_rows_any)(const dirty_rows_t* pDirty)
+{
+    const uint32_t* pWords = (const uint32_t*) pDirty;
+    uint32_t any = 0;
+    for (uint i=0;i<sizeof(dirty_rows_t)/sizeof(uint32_t);i++)
+    {
+        any |= pWords[i];
+    }
+    return (any != 0);
+}
+
+#endif // FEATURE_DIRTY_ROWS
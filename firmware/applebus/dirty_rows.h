@@ -0,0 +1,87 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Per-row dirty bitmaps of the video pages (FEATURE_DIRTY_ROWS).
+// The bus core flags the text/LORES rows and HIRES lines written since the render core took
+// its last snapshot, per display page and memory bank. The flags follow the Apple's memory
+// layout: a byte per 40 byte row within each 128 byte block of the pages (the fourth covers
+// the screen hole), so marking a row is a single store. The snapshot clears the flags it
+// reports, and returns them as bitmaps per display row. A row written while the snapshot is
+// taken is reported either now or by the next snapshot: the bus core stores the data before
+// the flag, and the render core reads the data only after clearing the flag.
+#define DIRTY_HIRES_WORDS (192/32)
+
+typedef struct
+{
+    uint32_t text[2][2];                    // [page][bank]: bits 0..23 for the text/LORES rows
+    uint32_t hires[2][2][DIRTY_HIRES_WORDS]; // [page][bank]: one bit per HIRES line
+} dirty_rows_t;
+
+// memory banks
+#define DIRTY_BANK_MAIN 0
+#define DIRTY_BANK_AUX  1
+
+#ifdef FEATURE_DIRTY_ROWS
+#include <hardware/sync.h>
+
+// flags set by the bus core, cleared by the snapshot: [bank][128 byte block][40 byte group]
+extern volatile uint8_t dirty_rows_text[2][2*1024/128][4];
+extern volatile uint8_t dirty_rows_hires[2][2*8192/128][4];
+
+extern void dirty_rows_snapshot(dirty_rows_t* pDirty);
+extern bool dirty_rows_any(const dirty_rows_t* pDirty);
+
+// 40 byte group of an address within its 128 byte block (3: screen hole)
+static inline uint32_t dirty_rows_group(uint32_t address)
+{
+    return ((address & 0x7f) * 205) >> 13; // == (address & 0x7f) / 40
+}
+
+#endif
+
+// Called by the bus core after each RAM write to the shadow memory.
+static inline void dirty_rows_update(uint32_t address, bool aux)
+{
+#ifdef FEATURE_DIRTY_ROWS
+    if (address - 0x0400 < 0x0800)
+    {
+        // TEXT/LORES pages 1+2
+        __compiler_memory_barrier(); // the data is stored before the flag
+        dirty_rows_text[aux][(address - 0x0400) >> 7][dirty_rows_group(address)] = 1;
+    }
+    else
+    if (address - 0x2000 < 0x4000)
+    {
+        // HIRES pages 1+2
+        __compiler_memory_barrier();
+        dirty_rows_hires[aux][(address - 0x2000) >> 7][dirty_rows_group(address)] = 1;
+    }
+#endif
+}
@@ -0,0 +1,109 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <pico/stdlib.h>
+#include <hardware/sync.h>
+#include "buffers.h"
+#include "mockingboard.h"
+
+#ifdef FEATURE_MOCKINGBOARD
+
+uint32_t             mockingboard_page = 0xC000 | (MOCKINGBOARD_DEFAULT_SLOT << 8);
+mockingboard_event_t mockingboard_events[MOCKINGBOARD_EVENTS_SIZE];
+volatile uint32_t    mockingboard_events_write; // bus core only
+volatile uint32_t    mockingboard_events_read;  // render core only
+volatile uint32_t    mockingboard_events_dropped;
+
+// output registers of the two VIAs, and the AY register latched by each
+typedef struct
+{
+    uint8_t ora;
+    uint8_t orb;
+    uint8_t latch;
+} mockingboard_via_t;
+
+static mockingboard_via_t mockingboard_vias[2];
+
+// Slot of the Mockingboard (1..7), 0 switches the snooping off.
+void mockingboard_set_slot(uint8_t slot)
+{
+    mockingboard_page = ((slot >= 1) && (slot <= 7)) ? (0xC000 | (slot << 8)) : 0x10000; // never matches a 16bit address
+}
+
+static void __time_critical_func(mockingboard_push)(uint8_t chip, uint8_t reg, uint8_t value)
+{
+    const uint32_t write = mockingboard_events_write;
+    if (write - mockingboard_events_read >= MOCKINGBOARD_EVENTS_SIZE)
+    {
+        // render core is behind (which only happens when the software floods the AY registers)
+        mockingboard_events_dropped++;
+        return;
+    }
+    mockingboard_event_t* pEvent = &mockingboard_events[write & (MOCKINGBOARD_EVENTS_SIZE-1)];
+    pEvent->cycle = bus_counter;
+    pEvent->chip  = chip;
+    pEvent->reg   = reg;
+    pEvent->value = value;
+    // publish the event after its data
+    __dmb();
+    mockingboard_events_write = write+1;
+}
+
+// Called by the bus core for writes to the Mockingboard's page.
+void __time_critical_func(mockingboard_write)(uint32_t address, uint8_t data)
+{
+    const uint8_t chip = (address >> 7) & 1;
+    mockingboard_via_t* pVia = &mockingboard_vias[chip];
+    switch(address & 0x0f)
+    {
+        case 0x0: // ORB: AY control lines
+            pVia->orb = data;
+            switch(data & 0x07)
+            {
+                case MOCKINGBOARD_AY_LATCH:
+                    // the AY only responds to register addresses 0..15
+                    pVia->latch = (pVia->ora < 16) ? pVia->ora : MOCKINGBOARD_REG_RESET;
+                    break;
+                case MOCKINGBOARD_AY_WRITE:
+                    if (pVia->latch < 16)
+                        mockingboard_push(chip, pVia->latch, pVia->ora);
+                    break;
+                case 0x0 ... 0x3: // /RESET low
+                    mockingboard_push(chip, MOCKINGBOARD_REG_RESET, 0);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        case 0x1: // ORA: AY data bus
+        case 0xf: // ORA without handshake
+            pVia->ora = data;
+            break;
+        default:
+            // DDRs, timers and interrupt registers do not affect the AYs
+            break;
+    }
+}
+
+#endif // FEATURE_MOCKINGBOARD
@@ -0,0 +1,67 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Mockingboard snooping (FEATURE_MOCKINGBOARD).
+// A Mockingboard drives two AY-3-8910 sound chips through two 6522 VIAs in its slot's $Cn00 page: the
+// VIA at $Cn00 drives the left AY, the VIA at $Cn80 the right one. Port A is the AY's data bus, port B
+// drives its control lines (bit 0: BC1, bit 1: BDIR, bit 2: /RESET). The bus core follows the writes
+// to both ports and pushes every AY register write (and reset) into a single-producer/single-consumer
+// ring, stamped with the bus cycle counter. The render core synthesizes the audio (audio/audio.c).
+#define MOCKINGBOARD_EVENTS_SIZE  256 // must be a power of 2
+#define MOCKINGBOARD_DEFAULT_SLOT 4
+
+// AY function selected by port B (BDIR, BC1, with /RESET high)
+#define MOCKINGBOARD_AY_INACTIVE 0x4
+#define MOCKINGBOARD_AY_READ     0x5
+#define MOCKINGBOARD_AY_WRITE    0x6
+#define MOCKINGBOARD_AY_LATCH    0x7
+
+#define MOCKINGBOARD_REG_RESET   0xff // register of a reset event
+
+typedef struct
+{
+    uint32_t cycle;  // bus cycle counter at the write
+    uint8_t  chip;   // 0: left, 1: right
+    uint8_t  reg;    // AY register, or MOCKINGBOARD_REG_RESET
+    uint8_t  value;
+    uint8_t  reserved;
+} mockingboard_event_t;
+
+#ifdef FEATURE_MOCKINGBOARD
+
+extern uint32_t                mockingboard_page; // $Cn00 of the Mockingboard's slot (0x10000: off)
+extern mockingboard_event_t    mockingboard_events[MOCKINGBOARD_EVENTS_SIZE];
+extern volatile uint32_t       mockingboard_events_write;
+extern volatile uint32_t       mockingboard_events_read;
+extern volatile uint32_t       mockingboard_events_dropped;
+
+extern void mockingboard_set_slot(uint8_t slot);
+extern void mockingboard_write(uint32_t address, uint8_t data);
+
+#endif
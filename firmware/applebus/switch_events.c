@@ -0,0 +1,130 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <pico/stdlib.h>
+#include <hardware/sync.h>
+#include "config/config.h"
+#include "switch_events.h"
+
+#ifdef FEATURE_MIDFRAME_SPLITS
+
+switch_event_t    switch_events[SWITCH_EVENTS_SIZE];
+volatile uint32_t switch_events_write; // bus core only
+volatile uint32_t switch_events_dropped;
+static volatile uint32_t switch_events_read; // render core only
+
+// Apple video timing, phase-locked by the bus core through $C019
+static volatile uint32_t vbl_cycle;      // bus cycle of the most recent VBL start
+static volatile uint32_t frame_cycles = APPLE_CYCLES_PER_LINE*APPLE_LINES_NTSC;
+static volatile bool     vbl_locked;
+static          bool     vbl_active;
+
+// give up the phase lock when software stopped reading $C019 for this many frames
+#define VBL_LOCK_FRAMES 256
+
+void __time_critical_func(switch_events_push)(uint32_t old_switches, uint32_t new_switches)
+{
+    const uint32_t write = switch_events_write;
+    if (write - switch_events_read >= SWITCH_EVENTS_SIZE)
+    {
+        // render core is behind (which only happens when the software floods the soft-switches)
+        switch_events_dropped++;
+        return;
+    }
+    switch_event_t* pEvent = &switch_events[write & (SWITCH_EVENTS_SIZE-1)];
+    pEvent->cycle        = bus_counter;
+    pEvent->old_switches = old_switches;
+    pEvent->new_switches = new_switches;
+    // publish the event after its data
+    __dmb();
+    switch_events_write = write+1;
+}
+
+void __time_critical_func(switch_events_vbl)(bool vbl)
+{
+    if (vbl && !vbl_active)
+    {
+        // start of VBL: the previous edge tells NTSC from PAL timing
+        const uint32_t now = bus_counter;
+        const uint32_t delta = now - vbl_cycle;
+        if (vbl_locked)
+        {
+            if ((delta > APPLE_CYCLES_PER_LINE*(APPLE_LINES_PAL-1)) && (delta < APPLE_CYCLES_PER_LINE*(APPLE_LINES_PAL+1)))
+                frame_cycles = APPLE_CYCLES_PER_LINE*APPLE_LINES_PAL;
+            else
+            if ((delta > APPLE_CYCLES_PER_LINE*(APPLE_LINES_NTSC-1)) && (delta < APPLE_CYCLES_PER_LINE*(APPLE_LINES_NTSC+1)))
+                frame_cycles = APPLE_CYCLES_PER_LINE*APPLE_LINES_NTSC;
+        }
+        vbl_cycle  = now;
+        vbl_locked = true;
+    }
+    vbl_active = vbl;
+}
+
+// Render core: collect the video mode changes within the visible area of the most recent complete
+// Apple frame, ordered by scanline. Returns 0 when there were none (or no phase lock), in which
+// case the frame is rendered with the current soft-switches.
+uint32_t DELAYED_COPY_CODE(switch_events_frame)(switch_split_t* pSplits, uint32_t max_splits)
+{
+    const uint32_t write = switch_events_write;
+    __dmb();
+
+    const uint32_t now    = bus_counter;
+    const uint32_t frame  = frame_cycles;
+    const uint32_t vbl    = vbl_cycle;
+    if ((!vbl_locked)||(now - vbl > VBL_LOCK_FRAMES*frame))
+    {
+        switch_events_read = write;
+        return 0;
+    }
+
+    // visible line 0 starts 192 lines before VBL
+    const uint32_t phase = (now - vbl + APPLE_VISIBLE_LINES*APPLE_CYCLES_PER_LINE) % frame;
+    const uint32_t start = now - phase - frame;
+
+    // drop the events of earlier frames
+    uint32_t read = switch_events_read;
+    while ((read != write) && ((int32_t)(switch_events[read & (SWITCH_EVENTS_SIZE-1)].cycle - start) < 0))
+        read++;
+    switch_events_read = read;
+
+    // the events in the visible area are kept: they only drop out with the next frame
+    uint32_t count = 0;
+    while ((read != write) && (count < max_splits))
+    {
+        const switch_event_t* pEvent = &switch_events[read & (SWITCH_EVENTS_SIZE-1)];
+        const uint32_t offset = pEvent->cycle - start;
+        if (offset >= APPLE_VISIBLE_LINES*APPLE_CYCLES_PER_LINE)
+            break;
+        pSplits[count].line         = offset / APPLE_CYCLES_PER_LINE;
+        pSplits[count].old_switches = pEvent->old_switches;
+        pSplits[count].new_switches = pEvent->new_switches;
+        count++;
+        read++;
+    }
+    return count;
+}
+
+#endif // FEATURE_MIDFRAME_SPLITS
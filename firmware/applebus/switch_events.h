@@ -0,0 +1,95 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "buffers.h"
+
+// Soft-switch event log for mid-frame mode splits (FEATURE_MIDFRAME_SPLITS).
+// The bus core stamps every change of a video soft-switch with the bus cycle counter and
+// pushes it into a single-producer/single-consumer ring. Reads of $C019 (VBL) phase-lock
+// the cycle counter to the Apple's video timing (65 cycles per line, 262 lines per frame,
+// or 312 lines for PAL machines), which needs the data of read cycles (FEATURE_READ_DATA).
+// Before compiling a frame, the render core maps the events of the most recent complete
+// Apple frame onto its scanlines, so modes which software switches at a specific line are
+// rendered per line range instead of for the whole frame.
+#define SWITCH_EVENTS_SIZE     128 // must be a power of 2
+
+#define APPLE_CYCLES_PER_LINE  65
+#define APPLE_LINES_NTSC       262
+#define APPLE_LINES_PAL        312
+#define APPLE_VISIBLE_LINES    192
+
+// soft-switches which change the rendered image
+#define SWITCH_EVENTS_MASK (SOFTSW_MODE_MASK | SOFTSW_PAGE_2 | SOFTSW_80STORE | SOFTSW_80COL | SOFTSW_ALTCHAR | SOFTSW_DGR)
+
+typedef struct
+{
+    uint32_t cycle;        // bus cycle counter at the change
+    uint32_t old_switches;
+    uint32_t new_switches;
+} switch_event_t;
+
+// a change of the video mode at a visible scanline of the frame
+typedef struct
+{
+    uint32_t line;
+    uint32_t old_switches;
+    uint32_t new_switches;
+} switch_split_t;
+
+#ifdef FEATURE_MIDFRAME_SPLITS
+
+extern switch_event_t    switch_events[SWITCH_EVENTS_SIZE];
+extern volatile uint32_t switch_events_write;
+extern volatile uint32_t switch_events_dropped;
+
+extern void switch_events_push(uint32_t old_switches, uint32_t new_switches);
+extern void switch_events_vbl(bool vbl);
+extern uint32_t switch_events_frame(switch_split_t* pSplits, uint32_t max_splits);
+
+#endif
+
+// Called by the bus core after each soft-switch access.
+static inline void switch_events_update(uint32_t old_switches)
+{
+#ifdef FEATURE_MIDFRAME_SPLITS
+    if ((soft_switches ^ old_switches) & SWITCH_EVENTS_MASK)
+    {
+        switch_events_push(old_switches, soft_switches);
+    }
+#endif
+}
+
+// Called by the bus core on each read of $C019 with valid read data (FEATURE_READ_DATA).
+// IIe: bit 7 is clear during VBL, IIgs: set during VBL.
+static inline void switch_events_vbl_read(uint8_t data, bool iigs)
+{
+#ifdef FEATURE_MIDFRAME_SPLITS
+    switch_events_vbl(((data & 0x80) != 0) == iigs);
+#endif
+}
@@ -0,0 +1,141 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <pico/stdlib.h>
+#include "dvi.h"
+#include "dvi/tmds.h"
+#include "switch_profiler.h"
+
+#ifdef FEATURE_SWITCH_PROFILER
+
+volatile uint32_t switch_access_counters[0x80];
+volatile switch_profile_t switch_totals;
+
+switch_profile_t switch_frame_ring[SWITCH_PROFILER_FRAMES];
+uint32_t         switch_frame_count;
+
+// totals at the end of the previous frame (core 0 only)
+static switch_profile_t switch_last_totals;
+
+// Bus core: a video relevant soft-switch changed. Only called on actual changes, so it is rare.
+void __time_critical_func(switch_profiler_change)(uint32_t old_switches, uint32_t new_switches)
+{
+    const uint32_t changed = old_switches ^ new_switches;
+    if (changed & SWITCH_PROFILER_MODE_MASK)
+        switch_totals.mode_changes++;
+    // with 80STORE enabled, PAGE2 selects the memory bank instead of the displayed page
+    if ((changed & SOFTSW_PAGE_2) && !(new_switches & SOFTSW_80STORE))
+        switch_totals.page_flips++;
+    if (dvi0.timing_state.v_state == DVI_STATE_ACTIVE)
+        switch_totals.mid_frame_changes++;
+}
+
+// Core 0: close the current frame and store its statistics in the ring.
+void switch_profiler_frame(void)
+{
+    switch_profile_t totals;
+    totals.page_flips        = switch_totals.page_flips;
+    totals.mode_changes      = switch_totals.mode_changes;
+    totals.mid_frame_changes = switch_totals.mid_frame_changes;
+    totals.shown_writes      = switch_totals.shown_writes;
+    totals.hidden_writes     = switch_totals.hidden_writes;
+
+    // the totals are only ever incremented by the bus core, so the differences need no locking
+    switch_profile_t* pFrame = &switch_frame_ring[switch_frame_count % SWITCH_PROFILER_FRAMES];
+    pFrame->page_flips        = totals.page_flips        - switch_last_totals.page_flips;
+    pFrame->mode_changes      = totals.mode_changes      - switch_last_totals.mode_changes;
+    pFrame->mid_frame_changes = totals.mid_frame_changes - switch_last_totals.mid_frame_changes;
+    pFrame->shown_writes      = totals.shown_writes      - switch_last_totals.shown_writes;
+    pFrame->hidden_writes     = totals.hidden_writes     - switch_last_totals.hidden_writes;
+
+    switch_last_totals = totals;
+    switch_frame_count++;
+}
+
+// Average and maximum per frame over the frames in the ring.
+void switch_profiler_summary(switch_profile_t* pAverage, switch_profile_t* pMaximum)
+{
+    switch_profile_t sum = {0};
+    switch_profile_t max = {0};
+    uint32_t frames = (switch_frame_count < SWITCH_PROFILER_FRAMES) ? switch_frame_count : SWITCH_PROFILER_FRAMES;
+    for (uint32_t i=0;i<frames;i++)
+    {
+        const uint32_t* pFrame = (const uint32_t*) &switch_frame_ring[i];
+        uint32_t* pSum = (uint32_t*) &sum;
+        uint32_t* pMax = (uint32_t*) &max;
+        for (uint32_t j=0;j<sizeof(switch_profile_t)/sizeof(uint32_t);j++)
+        {
+            pSum[j] += pFrame[j];
+            if (pFrame[j] > pMax[j])
+                pMax[j] = pFrame[j];
+        }
+    }
+
+    if (frames)
+    {
+        uint32_t* pSum = (uint32_t*) &sum;
+        for (uint32_t j=0;j<sizeof(switch_profile_t)/sizeof(uint32_t);j++)
+        {
+            pSum[j] /= frames;
+        }
+    }
+    *pAverage = sum;
+    *pMaximum = max;
+}
+
+// Find the most frequently accessed soft-switches ($C0xx, low byte), most frequent first.
+// Returns the number of registers found (registers which were never accessed are not reported).
+uint32_t switch_profiler_hot_registers(uint8_t* pRegisters, uint32_t count)
+{
+    uint32_t found = 0;
+    uint32_t last_hits = 0xffffffff;
+    uint32_t last_reg  = 0;
+    while (found < count)
+    {
+        // next register after the previous one, ordered by hits (descending), then by address
+        uint32_t hits = 0;
+        uint32_t reg  = 0;
+        for (uint32_t r=0;r<0x80;r++)
+        {
+            uint32_t c = switch_access_counters[r];
+            if ((c < last_hits)||((c == last_hits)&&(r > last_reg)))
+            {
+                if (c > hits)
+                {
+                    hits = c;
+                    reg  = r;
+                }
+            }
+        }
+        if (hits == 0)
+            break;
+        pRegisters[found++] = reg;
+        last_hits = hits;
+        last_reg  = reg;
+    }
+    return found;
+}
+
+#endif // FEATURE_SWITCH_PROFILER
@@ -0,0 +1,124 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <pico/stdlib.h>
+#include "buffers.h"
+#include "video_planes.h"
+
+#ifdef FEATURE_VIDEO_PLANES
+
+uint32_t __attribute__((section (".appledata."))) hgr_plane[2][192*VIDEO_PLANE_WORDS];
+uint32_t __attribute__((section (".appledata."))) dhgr_plane[2][192*VIDEO_PLANE_WORDS];
+
+// HIRES byte to 14 dots (the delayed dot of bytes with bit 7 set spills into bit 14).
+// Built at start-up: the renderer's own table is only copied to RAM after core 1 has started.
+static uint16_t plane_dot_patterns[256];
+
+static inline uint hires_line_to_mem_offset(uint line)
+{
+    return ((line & 0x07) << 10) | ((line & 0x38) << 4) | (((line & 0xc0) >> 6) * 40);
+}
+
+// 28 dots of HIRES columns 2*word and 2*word+1, including the dot carried over from the previous column
+static inline uint32_t __time_critical_func(video_planes_hgr_word)(const uint8_t* line_mem, uint word)
+{
+    uint col = word*2;
+    uint32_t dots = (col) ? (plane_dot_patterns[line_mem[col-1]] >> 14) : 0;
+    dots |= plane_dot_patterns[line_mem[col]];
+    dots |= plane_dot_patterns[line_mem[col+1]] << 14;
+    return dots & 0x0fffffff;
+}
+
+void __time_critical_func(video_planes_write)(uint32_t address, uint8_t data, bool aux)
+{
+    // map the address to plane line and column (inverse of hires_line_to_mem_offset)
+    uint32_t offset = address & 0x1fff;
+    uint col = offset & 0x7f;
+    uint group = 0;
+    if (col >= 80)
+    {
+        group = 2;
+        col -= 80;
+    }
+    else
+    if (col >= 40)
+    {
+        group = 1;
+        col -= 40;
+    }
+    if (col >= 40)
+        return; // screen holes
+
+    const uint page = (address >> 13) - 1;
+    const uint line = ((offset >> 10) & 0x07) | ((offset >> 4) & 0x38) | (group << 6);
+    uint32_t* plane_line = &dhgr_plane[page][line*VIDEO_PLANE_WORDS];
+
+    // DHGR: replace the 7 dots of this byte
+    const uint shift = ((col & 1) ? 14 : 0) + ((aux) ? 0 : 7);
+    plane_line[col/2] = (plane_line[col/2] & ~(0x7f << shift)) | ((data & 0x7f) << shift);
+
+    if (!aux)
+    {
+        // HIRES: rebuild the word of this column, and the next word when its carried dot changes
+        const uint8_t* line_mem = &APPLE_MEM(address - col);
+        plane_line = &hgr_plane[page][line*VIDEO_PLANE_WORDS];
+        plane_line[col/2] = video_planes_hgr_word(line_mem, col/2);
+        if ((col & 1) && (col < 39))
+        {
+            plane_line[col/2+1] = video_planes_hgr_word(line_mem, col/2+1);
+        }
+    }
+}
+
+void __time_critical_func(video_planes_init)(void)
+{
+    for (uint b=0;b<256;b++)
+    {
+        uint32_t dots = 0;
+        for (uint i=0;i<7;i++)
+        {
+            if (b & (1 << i))
+                dots |= 3 << (2*i);
+        }
+        plane_dot_patterns[b] = (b & 0x80) ? (dots << 1) : dots;
+    }
+
+    // decode the current memory contents
+    for (uint page=0;page<2;page++)
+    {
+        for (uint line=0;line<192;line++)
+        {
+            const uint32_t address = 0x2000*(page+1) + hires_line_to_mem_offset(line);
+            for (uint col=0;col<40;col+=2)
+            {
+                video_planes_write(address+col, PRIVATE_MEM(address+col), true);
+                video_planes_write(address+col, APPLE_MEM(address+col), false);
+                video_planes_write(address+col+1, PRIVATE_MEM(address+col+1), true);
+                video_planes_write(address+col+1, APPLE_MEM(address+col+1), false);
+            }
+        }
+    }
+}
+
+#endif // FEATURE_VIDEO_PLANES
@@ -0,0 +1,61 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Pre-decoded HIRES/DHGR video planes (FEATURE_VIDEO_PLANES).
+// The bus core updates the planes on every write to the HIRES pages ($2000-$5FFF), so the
+// render kernels read scanline-linear, already decoded data instead of unscrambling the
+// Apple II memory layout. Each plane line holds 20 words of 28 dots (two columns), in the
+// order the dots are displayed (first dot in bit 0):
+//  hgr_plane:  main memory, HIRES dots doubled, with the delayed half-dot (bit 7) resolved
+//  dhgr_plane: aux/main memory merged: aux[2n], main[2n], aux[2n+1], main[2n+1]
+// A HIRES write then takes the bus core about 160 more cycles, a little longer than a bus cycle
+// (tools/cycle_model.py replay). The RX FIFO absorbs it: the 6502 never writes the HIRES pages in
+// more than two cycles in a row (read-modify-write instructions).
+#define VIDEO_PLANE_WORDS (560/28)
+
+#ifdef FEATURE_VIDEO_PLANES
+
+extern uint32_t hgr_plane[2][192*VIDEO_PLANE_WORDS];
+extern uint32_t dhgr_plane[2][192*VIDEO_PLANE_WORDS];
+
+extern void video_planes_init(void);
+extern void video_planes_write(uint32_t address, uint8_t data, bool aux);
+
+#endif
+
+// Called by the bus core after each RAM write to the shadow memory.
+static inline void video_planes_update(uint32_t address, uint8_t data, bool aux)
+{
+#ifdef FEATURE_VIDEO_PLANES
+    if ((address >= 0x2000) && (address < 0x6000))
+    {
+        video_planes_write(address, data, aux);
+    }
+#endif
+}
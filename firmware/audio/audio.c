@@ -0,0 +1,157 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <pico/stdlib.h>
+#include <hardware/sync.h>
+#include "applebus/buffers.h"
+#include "applebus/mockingboard.h"
+#include "config/config.h"
+#include "ay8910.h"
+#include "audio.h"
+
+#ifdef FEATURE_MOCKINGBOARD
+
+uint32_t          audio_pcm[AUDIO_PCM_SIZE];
+volatile uint32_t audio_pcm_write;
+volatile uint32_t audio_synth_us;
+
+// bus cycles per sample, 24.8 fixed-point
+#define AUDIO_CYCLES_PER_SAMPLE ((AY_CLOCK_HZ << 8) / AUDIO_SAMPLE_RATE)
+
+static ay8910_t audio_ay[2];
+static uint32_t audio_cycle;    // bus cycle up to which samples are due
+static uint32_t audio_fraction; // bus cycles (24.8) not rendered yet
+static uint32_t audio_target;   // bus cycle the current synthesis catches up to
+static bool     audio_busy;
+static uint32_t audio_time_us;  // synthesis time of the current second of audio
+static uint32_t audio_samples;
+
+void audio_init(void)
+{
+    ay8910_init();
+    ay8910_reset(&audio_ay[0], AUDIO_SAMPLE_RATE);
+    ay8910_reset(&audio_ay[1], AUDIO_SAMPLE_RATE);
+    audio_cycle = bus_counter;
+    mockingboard_events_read = mockingboard_events_write;
+}
+
+// Render both AYs towards the given bus cycle, in blocks which do not wrap around the ring, but no
+// more than *pSamples samples. Returns true when all samples due were rendered.
+static bool DELAYED_COPY_CODE(audio_render)(uint32_t cycle, uint32_t* pSamples)
+{
+    if ((int32_t)(cycle - audio_cycle) > 0)
+    {
+        uint32_t cycles = cycle - audio_cycle;
+        audio_cycle = cycle;
+        // after a long gap (no bus activity, no audio), render at most one ring
+        if (cycles > (AUDIO_PCM_SIZE * AUDIO_CYCLES_PER_SAMPLE) >> 8)
+            cycles = (AUDIO_PCM_SIZE * AUDIO_CYCLES_PER_SAMPLE) >> 8;
+        audio_fraction += cycles << 8;
+    }
+
+    uint32_t samples = audio_fraction / AUDIO_CYCLES_PER_SAMPLE;
+    if (samples > *pSamples)
+        samples = *pSamples;
+    audio_fraction -= samples * AUDIO_CYCLES_PER_SAMPLE;
+    audio_samples  += samples;
+    *pSamples      -= samples;
+
+    uint32_t write = audio_pcm_write;
+    while (samples)
+    {
+        const uint32_t first = write & (AUDIO_PCM_SIZE-1);
+        uint32_t count = AUDIO_PCM_SIZE - first;
+        if (count > samples)
+            count = samples;
+        int16_t* pOut = (int16_t*) &audio_pcm[first];
+        ay8910_render(&audio_ay[0], pOut,   count, 2);
+        ay8910_render(&audio_ay[1], pOut+1, count, 2);
+        write   += count;
+        samples -= count;
+    }
+    // publish the samples after their data
+    __dmb();
+    audio_pcm_write = write;
+
+    return (audio_fraction < AUDIO_CYCLES_PER_SAMPLE);
+}
+
+// A slice of the render core's audio task: renders up to AUDIO_SLICE_SAMPLES samples towards the bus
+// cycle at which the frame's synthesis started, applying the register writes at their bus cycles.
+// Returns true while more slices are needed.
+bool DELAYED_COPY_CODE(audio_slice)(void)
+{
+    const uint32_t start = time_us_32();
+    if (!audio_busy)
+    {
+        audio_target = bus_counter;
+        audio_busy   = true;
+    }
+
+    if (mockingboard_page > 0xffff)
+    {
+        // switched off (device register 0xE): no synthesis
+        audio_cycle = audio_target;
+        audio_busy  = false;
+        mockingboard_events_read = mockingboard_events_write;
+        return false;
+    }
+
+    uint32_t samples = AUDIO_SLICE_SAMPLES;
+    uint32_t read = mockingboard_events_read;
+    for (;;)
+    {
+        if (read != mockingboard_events_write)
+        {
+            const mockingboard_event_t* pEvent = &mockingboard_events[read & (MOCKINGBOARD_EVENTS_SIZE-1)];
+            if ((int32_t)(pEvent->cycle - audio_target) <= 0)
+            {
+                if (!audio_render(pEvent->cycle, &samples))
+                    break; // slice used up before the write
+                ay8910_t* pAy = &audio_ay[pEvent->chip];
+                if (pEvent->reg == MOCKINGBOARD_REG_RESET)
+                    ay8910_reset(pAy, AUDIO_SAMPLE_RATE);
+                else
+                    ay8910_write(pAy, pEvent->reg, pEvent->value);
+                read++;
+                continue;
+            }
+        }
+        if (audio_render(audio_target, &samples))
+            audio_busy = false;
+        break;
+    }
+    mockingboard_events_read = read;
+
+    audio_time_us += time_us_32() - start;
+    if (audio_samples >= AUDIO_SAMPLE_RATE)
+    {
+        audio_synth_us = (uint32_t)(((uint64_t) audio_time_us * AUDIO_SAMPLE_RATE) / audio_samples);
+        audio_time_us  = 0;
+        audio_samples  = 0;
+    }
+    return audio_busy;
+}
+
+#endif // FEATURE_MOCKINGBOARD
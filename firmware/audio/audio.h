@@ -0,0 +1,53 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Mockingboard audio (FEATURE_MOCKINGBOARD).
+// Once per frame, the render core's audio task replays the AY register writes seen by the bus core
+// (applebus/mockingboard.c) through two AY-3-8910 generators, up to the current bus cycle, and
+// appends the samples to a PCM ring: 16bit signed stereo, left AY in the low half of each word.
+// The synthesis runs in slices of AUDIO_SLICE_SAMPLES (see render/render_tasks.h).
+// The bus cycle counter is the time base, so the audio follows the Apple's clock. Consumers (the
+// USB stream) read the ring behind audio_pcm_write.
+#define AUDIO_SAMPLE_RATE   22050
+#define AUDIO_SLICE_SAMPLES 128
+
+#ifdef FEATURE_PICO2
+    #define AUDIO_PCM_SIZE 4096 // stereo samples, power of 2
+#else
+    #define AUDIO_PCM_SIZE 2048
+#endif
+
+#ifdef FEATURE_MOCKINGBOARD
+extern uint32_t          audio_pcm[AUDIO_PCM_SIZE];
+extern volatile uint32_t audio_pcm_write; // samples written since start-up
+extern volatile uint32_t audio_synth_us;  // synthesis time per second of audio (us)
+
+extern void audio_init(void);
+extern bool audio_slice(void);
+#endif
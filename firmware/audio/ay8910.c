@@ -0,0 +1,179 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string.h>
+#include <pico/stdlib.h>
+#include "config/config.h"
+#include "ay8910.h"
+
+#ifdef FEATURE_MOCKINGBOARD
+
+// AY registers
+#define AY_TONE_A       0  // 12bit tone periods: fine, coarse
+#define AY_NOISE_PERIOD 6
+#define AY_MIXER        7  // bits 0..2: tone off, bits 3..5: noise off
+#define AY_AMPLITUDE_A  8  // bits 0..3: level, bit 4: envelope
+#define AY_ENV_FINE     11
+#define AY_ENV_COARSE   12
+#define AY_ENV_SHAPE    13 // bit 0: hold, bit 1: alternate, bit 2: attack, bit 3: continue
+
+// logarithmic DAC levels, scaled so three channels at full level fit into 16 bits
+static int16_t DELAYED_COPY_DATA(ay_volume)[16] =
+{
+    0, 139, 201, 295, 436, 645, 899, 1470, 1731, 2784, 3889, 4881, 6161, 7736, 9198, 10922
+};
+
+// Envelope levels of each shape over two cycles, built at start-up. Repeating shapes continue with
+// step 0 after step 31, the others hold the level of step 31.
+static uint8_t DELAYED_COPY_DATA(ay_envelope)[16][32];
+
+#define AY_ENV_REPEATS(shape) (((shape) & 0x9) == 0x8) // continue, no hold
+
+void ay8910_init(void)
+{
+    for (uint shape=0;shape<16;shape++)
+    {
+        const bool attack = (shape & 0x4) != 0;
+        for (uint step=0;step<32;step++)
+        {
+            uint8_t level;
+            if (step < 16)
+                level = (attack) ? step : 15-step;
+            else
+            if (!(shape & 0x8))
+                level = 0;
+            else
+            if (shape & 0x1)
+                level = (attack != ((shape & 0x2) != 0)) ? 15 : 0;
+            else
+            if (attack != ((shape & 0x2) != 0))
+                level = step-16;
+            else
+                level = 31-step;
+            ay_envelope[shape][step] = level;
+        }
+    }
+}
+
+void ay8910_reset(ay8910_t* pAy, uint32_t sample_rate)
+{
+    memset(pAy, 0, sizeof(*pAy));
+    pAy->step = ((AY_CLOCK_HZ/8) << AY_FRAC_BITS) / sample_rate;
+    pAy->noise_lfsr = 1;
+    pAy->regs[AY_MIXER] = 0x3f; // all off
+    for (uint i=0;i<16;i++)
+        ay8910_write(pAy, i, pAy->regs[i]);
+}
+
+void DELAYED_COPY_CODE(ay8910_write)(ay8910_t* pAy, uint8_t reg, uint8_t value)
+{
+    reg &= 0xf;
+    pAy->regs[reg] = value;
+    switch(reg)
+    {
+        case AY_TONE_A ... AY_TONE_A+5:
+        {
+            const uint channel = reg/2;
+            uint32_t period = ((pAy->regs[channel*2+1] & 0xf) << 8) | pAy->regs[channel*2];
+            pAy->tone_period[channel] = ((period) ? period : 1) << AY_FRAC_BITS;
+            break;
+        }
+        case AY_NOISE_PERIOD:
+        {
+            const uint32_t period = value & 0x1f;
+            pAy->noise_period = ((period) ? period : 1) << (AY_FRAC_BITS+1);
+            break;
+        }
+        case AY_ENV_FINE:
+        case AY_ENV_COARSE:
+        {
+            const uint32_t period = (pAy->regs[AY_ENV_COARSE] << 8) | pAy->regs[AY_ENV_FINE];
+            pAy->env_period = ((period) ? period : 1) << (AY_FRAC_BITS+1);
+            break;
+        }
+        case AY_ENV_SHAPE:
+            // writing the shape restarts the envelope
+            pAy->env_shape = value & 0xf;
+            pAy->env_step  = 0;
+            pAy->env_count = 0;
+            break;
+        default:
+            break;
+    }
+}
+
+// Render a block of samples (the sum of the three channels) to pOut[0], pOut[stride], ...
+void DELAYED_COPY_CODE(ay8910_render)(ay8910_t* pAy, int16_t* pOut, uint32_t samples, uint32_t stride)
+{
+    const uint32_t step    = pAy->step;
+    const uint8_t  mixer   = pAy->regs[AY_MIXER];
+    const uint8_t* pShape  = ay_envelope[pAy->env_shape];
+    const bool     repeats = AY_ENV_REPEATS(pAy->env_shape);
+
+    for (uint32_t i=0;i<samples;i++)
+    {
+        for (uint c=0;c<3;c++)
+        {
+            pAy->tone_count[c] += step;
+            while (pAy->tone_count[c] >= pAy->tone_period[c])
+            {
+                pAy->tone_count[c] -= pAy->tone_period[c];
+                pAy->tone_out[c] ^= 1;
+            }
+        }
+
+        pAy->noise_count += step;
+        while (pAy->noise_count >= pAy->noise_period)
+        {
+            pAy->noise_count -= pAy->noise_period;
+            // 17bit LFSR, taps 0 and 3
+            pAy->noise_lfsr = (pAy->noise_lfsr >> 1) | (((pAy->noise_lfsr ^ (pAy->noise_lfsr >> 3)) & 1) << 16);
+        }
+
+        pAy->env_count += step;
+        while (pAy->env_count >= pAy->env_period)
+        {
+            pAy->env_count -= pAy->env_period;
+            if (pAy->env_step < 31)
+                pAy->env_step++;
+            else
+            if (repeats)
+                pAy->env_step = 0;
+        }
+
+        const uint8_t noise = pAy->noise_lfsr & 1;
+        int32_t sample = 0;
+        for (uint c=0;c<3;c++)
+        {
+            const uint8_t amplitude = pAy->regs[AY_AMPLITUDE_A+c];
+            const int32_t volume = ay_volume[(amplitude & 0x10) ? pShape[pAy->env_step] : (amplitude & 0xf)];
+            const bool out = (pAy->tone_out[c] | ((mixer >> c) & 1)) & (noise | ((mixer >> (c+3)) & 1));
+            sample += (out) ? volume : -volume;
+        }
+        *pOut = sample;
+        pOut += stride;
+    }
+}
+
+#endif // FEATURE_MOCKINGBOARD
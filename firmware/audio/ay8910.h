@@ -0,0 +1,62 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// AY-3-8910 synthesis (FEATURE_MOCKINGBOARD).
+// A block generator: registers only change between blocks, and each block renders samples with
+// fixed-point counters (AY_FRAC_BITS) in units of 8 AY clocks, the half period of the shortest tone.
+// Volume levels and envelope shapes are table-driven. tools/mockingboard.py implements the same
+// generator, to render bus traces on the host.
+#define AY_CLOCK_HZ   1020484 // the Mockingboard clocks its AYs with the Apple's bus clock
+#define AY_FRAC_BITS  12
+
+typedef struct
+{
+    uint8_t  regs[16];
+    uint32_t step;            // counter units per output sample
+    // tone generators A, B, C
+    uint32_t tone_period[3];  // half period
+    uint32_t tone_count[3];
+    uint8_t  tone_out[3];
+    // noise generator
+    uint32_t noise_period;
+    uint32_t noise_count;
+    uint32_t noise_lfsr;
+    // envelope generator
+    uint32_t env_period;      // time per envelope step
+    uint32_t env_count;
+    uint8_t  env_step;        // 0..31: two cycles of the shape
+    uint8_t  env_shape;
+} ay8910_t;
+
+#ifdef FEATURE_MOCKINGBOARD
+extern void ay8910_init(void);
+extern void ay8910_reset(ay8910_t* pAy, uint32_t sample_rate);
+extern void ay8910_write(ay8910_t* pAy, uint8_t reg, uint8_t value);
+extern void ay8910_render(ay8910_t* pAy, int16_t* pOut, uint32_t samples, uint32_t stride);
+#endif
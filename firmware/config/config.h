@@ -46,6 +46,11 @@ typedef enum
 extern volatile compat_t detected_machine;
 extern volatile compat_t cfg_machine;
 extern volatile compat_t current_machine;
+extern volatile bool     machine_detect_request;
+extern volatile compat_t machine_detect_result;
+
+// interval of the machine signature scan while the machine type is unknown
+#define MACHINE_DETECT_FRAMES 8
 
 extern uint32_t invalid_fonts;
 extern uint8_t  cfg_local_charset;
@@ -80,9 +85,15 @@ extern volatile uint8_t color_mode;
 #endif
 
 extern void set_machine         (compat_t machine);
+extern void config_detect_machine(void);
 extern void config_load         (void);
 extern void config_load_defaults(void);
 extern void config_load_charsets(void);
+extern bool config_load_next_charset(void);
+#ifdef FEATURE_BUS_JOBS
+extern void config_queue_charsets(void);
+extern bool config_charsets_pending(void);
+#endif
 extern void config_save         (void);
 extern bool config_flash_write  (void* flash_address, uint8_t* data, uint32_t size);
 extern void config_font_update  (void);
@@ -33,6 +33,10 @@ SOFTWARE.
 #include "applebus/buffers.h"
 #include "fonts/textfont.h"
 #include "menu/menu.h"
+#include "render/render_osd.h"
+#include "applebus/abus_timing.h"
+#include "applebus/bus_trace.h"
+#include "applebus/mockingboard.h"
 #ifdef APPLE_MODEL_IIPLUS
 #include "videx_vterm.h"
 #endif
@@ -104,12 +108,17 @@ void device_write(uint_fast8_t reg, uint_fast8_t data)
     // soft-monochrome color setting
     case 0x1:
         if (data & 0x03)
+        {
             color_mode = (data & 0x3)-1;
+            render_osd_toast(OSD_MSG_COLOR_MODE, color_mode);
+        }
         //0x30
         if(data & 0x40)
             SET_IFLAG(1, IFLAGS_FORCED_MONO);
         if(data & 0x80)
             SET_IFLAG(0, IFLAGS_FORCED_MONO);
+        if (data & 0xC0)
+            render_osd_toast(OSD_MSG_FORCED_MONO, IS_IFLAG(IFLAGS_FORCED_MONO) ? 1 : 0);
         break;
 
     // select custom font rom to be written
@@ -123,7 +132,12 @@ void device_write(uint_fast8_t reg, uint_fast8_t data)
                 {
                     invalid_fonts &= ~(1 << custom_rom_font_nr);
                     config_font_update();
+#ifdef FEATURE_OSD
+                    // confirm without drawing into the Apple's text page
+                    render_osd_toast(OSD_MSG_FONT_SAVED, 0);
+#else
                     menuShowSaved();
+#endif
                     // need to reload both charsets (updated font may be actively selected)
                     reload_charsets = 3;
                 }
@@ -164,6 +178,7 @@ void device_write(uint_fast8_t reg, uint_fast8_t data)
             // load a standard alternate character ROM
             cfg_local_charset = data;
             reload_charsets = 1;
+            render_osd_toast(OSD_MSG_CHARSET, data);
         }
         break;
 
@@ -175,6 +190,7 @@ void device_write(uint_fast8_t reg, uint_fast8_t data)
             cfg_alt_charset = data;
             reload_charsets = 2;
             language_switch_enabled = true;
+            render_osd_toast(OSD_MSG_ALT_CHARSET, data);
         }
         else
         {
@@ -209,6 +225,43 @@ void device_write(uint_fast8_t reg, uint_fast8_t data)
         }
         break;
 
+#ifdef FEATURE_BUS_TIMING
+    // select the bus timing profile (0: automatic, 1..3: for buses of up to 1..3MHz)
+    case 0xA:
+        abus_timing_select(data);
+        break;
+#endif
+
+#ifdef FEATURE_BUS_TRACE
+    // bus trace: 0 stops, 1..5 arm with a trigger (see bus_trace_trigger_t), 0x10 exports to flash
+    case 0xB:
+        if (data == 0x10)
+        {
+            if (bus_trace_export())
+                render_osd_toast(OSD_MSG_TRACE_EXPORTED, 0);
+        }
+        else
+            bus_trace_arm(data);
+        break;
+
+    // bus trace trigger address range: first (low, high), last (low, high)
+    case 0xC:
+        bus_trace_set_range(data);
+        break;
+
+    // bus trace: words recorded after the trigger, in 1/256 of the ring
+    case 0xD:
+        bus_trace_set_post(data);
+        break;
+#endif
+
+#ifdef FEATURE_MOCKINGBOARD
+    // slot of the Mockingboard (1..7), 0 disables the Mockingboard audio
+    case 0xE:
+        mockingboard_set_slot(data);
+        break;
+#endif
+
     default:
         break;
     }
@@ -229,19 +282,23 @@ void execute_device_command(uint_fast8_t cmd)
         case 0x00:
             // reset to the default configuration
             config_load_defaults();
+            render_osd_toast(OSD_MSG_DEFAULTS_RESTORED, 0);
             break;
         case 0x01:
             // reset to the saved configuration
             config_load();
+            render_osd_toast(OSD_MSG_CONFIG_LOADED, 0);
             break;
         case 0x02:
             // save the current configuration
             config_save();
+            render_osd_toast(OSD_MSG_CONFIG_SAVED, 0);
             break;
         case 0x10 ... (0x10+MAX_FONT_COUNT):
             // load a standard alternate character ROM
             cfg_local_charset = cmd - 0x10;
             reload_charsets = 1;
+            render_osd_toast(OSD_MSG_CHARSET, cfg_local_charset);
             break;
         default:
             break;
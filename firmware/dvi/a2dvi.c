@@ -25,6 +25,7 @@ SOFTWARE.
 #include <stdlib.h>
 #include "pico/stdlib.h"
 #include "hardware/clocks.h"
+#include "hardware/irq.h"
 
 #include "a2dvi.h"
 #include "dvi.h"
@@ -33,7 +34,9 @@ SOFTWARE.
 #include "dvi_timing.h"
 #include "render/render.h"
 #include "util/dmacopy.h"
+#include "util/cycles.h"
 #include "config/config.h"
+#include "applebus/buffers.h"
 
 // clock/DVI configuration
 #define DVI_TIMING        dvi_timing_640x480p_60hz
@@ -41,6 +44,117 @@ SOFTWARE.
 
 struct dvi_inst dvi0;
 
+#ifdef FEATURE_DVI_IRQ_CORE1
+// handshake: core 0 configured the DVI output, core 1 registered the DMA IRQ
+static volatile bool a2dvi_irq_request;
+static volatile bool a2dvi_irq_ready;
+#endif
+
+#ifdef FEATURE_DVI_STATS
+volatile uint32_t dvi_irq_jitter;
+volatile uint32_t dvi_irq_max_cycles;
+volatile uint32_t dvi_late_lines;
+volatile uint32_t render_idle_percent;
+
+static irq_handler_t a2dvi_dvi_irq;
+static uint32_t      a2dvi_irq_count;
+static uint32_t      a2dvi_irq_last;
+static uint32_t      a2dvi_irq_min_interval;
+static uint32_t      a2dvi_irq_max_interval;
+static uint32_t      a2dvi_irq_max;
+
+static uint32_t      render_wait_us;
+static uint32_t      render_stats_time;
+
+// Wraps the DVI DMA IRQ handler: measures its duration and the spread of the intervals between
+// IRQs (one per scanline), in CPU cycles of the core handling the IRQ.
+static void __time_critical_func(a2dvi_irq_stats)(void)
+{
+    const uint32_t start = cycle_counter_now();
+    const uint32_t late  = dvi0.late_scanline_ctr;
+
+    a2dvi_dvi_irq();
+
+    const uint32_t cycles   = cycle_counter_since(start);
+    const uint32_t interval = cycle_counter_between(a2dvi_irq_last, start);
+    a2dvi_irq_last = start;
+
+    if (dvi0.late_scanline_ctr > late)
+        dvi_late_lines++;
+    if (cycles > a2dvi_irq_max)
+        a2dvi_irq_max = cycles;
+    if (interval < a2dvi_irq_min_interval)
+        a2dvi_irq_min_interval = interval;
+    if (interval > a2dvi_irq_max_interval)
+        a2dvi_irq_max_interval = interval;
+
+    // publish the results once per DVI_STATS_IRQS
+    if (++a2dvi_irq_count >= DVI_STATS_IRQS)
+    {
+        dvi_irq_jitter     = a2dvi_irq_max_interval - a2dvi_irq_min_interval;
+        dvi_irq_max_cycles = a2dvi_irq_max;
+        a2dvi_irq_count        = 0;
+        a2dvi_irq_max          = 0;
+        a2dvi_irq_min_interval = CYCLE_COUNTER_MASK;
+        a2dvi_irq_max_interval = 0;
+    }
+}
+
+// Get a free scanline buffer, accounting the time the render core had to wait for it.
+void DELAYED_COPY_CODE(dvi_wait_scanline)(uint32_t** pTmdsbuf)
+{
+    if (queue_try_remove_u32(&dvi0.q_tmds_free, pTmdsbuf))
+        return;
+    const uint32_t start = time_us_32();
+    queue_remove_blocking_u32(&dvi0.q_tmds_free, pTmdsbuf);
+    render_wait_us += time_us_32() - start;
+}
+
+// Called by the render core after each frame.
+void DELAYED_COPY_CODE(a2dvi_stats_frame)(void)
+{
+    if (frame_counter % DVI_STATS_FRAMES)
+        return;
+    const uint32_t now = time_us_32();
+    const uint32_t elapsed = now - render_stats_time;
+    render_stats_time = now;
+    if (elapsed)
+        render_idle_percent = (uint32_t)((render_wait_us * 100ull) / elapsed);
+    render_wait_us = 0;
+}
+#endif
+
+// register the DVI DMA IRQ on the calling core
+static void a2dvi_register_irq(void)
+{
+    dvi_register_irqs_this_core(&dvi0, DMA_IRQ_0);
+
+#ifdef FEATURE_DVI_STATS
+    // the cycle counter is private to each core
+    cycle_counter_init();
+    a2dvi_irq_min_interval = CYCLE_COUNTER_MASK;
+
+    // put the measurement wrapper in front of the DVI library's handler
+    a2dvi_dvi_irq = irq_get_exclusive_handler(DMA_IRQ_0);
+    irq_remove_handler(DMA_IRQ_0, a2dvi_dvi_irq);
+    irq_set_exclusive_handler(DMA_IRQ_0, a2dvi_irq_stats);
+#endif
+}
+
+#ifdef FEATURE_DVI_IRQ_CORE1
+// Called by core 1 before it starts processing the bus: waits until core 0 has configured the
+// DVI output (a few milliseconds after start-up), then takes over its DMA IRQ.
+void a2dvi_irq_core1_init(void)
+{
+    while (!a2dvi_irq_request)
+    {
+        tight_loop_contents();
+    }
+    a2dvi_register_irq();
+    a2dvi_irq_ready = true;
+}
+#endif
+
 static void a2dvi_init()
 {
     // wait a bit, until the raised core VCC has settled
@@ -62,7 +176,18 @@ void DELAYED_COPY_CODE(a2dvi_loop)()
     dvi0.ser_cfg = DVI_SERIAL_CONFIG;
     dvi_init(&dvi0, next_striped_spin_lock_num(), next_striped_spin_lock_num());
     dvi0.scanline_emulation = true;
-    dvi_register_irqs_this_core(&dvi0, DMA_IRQ_0);
+#ifdef FEATURE_DVI_IRQ_CORE1
+    // the bus core handles the DMA IRQ, so it does not preempt the renderer
+    a2dvi_irq_request = true;
+    while (!a2dvi_irq_ready)
+    {
+        tight_loop_contents();
+    }
+#else
+    // default: the render core handles the DMA IRQ, as it always did. Neither core was measured to be
+    // the better choice yet (FEATURE_DVI_STATS on hardware), so the default is left unchanged.
+    a2dvi_register_irq();
+#endif
     dvi_start(&dvi0);
 
     // start DVI output
@@ -24,4 +24,24 @@ SOFTWARE.
 
 #pragma once
 
+#include <stdint.h>
+
 void a2dvi_loop(void);
+
+#ifdef FEATURE_DVI_IRQ_CORE1
+// the bus core handles the DVI DMA IRQ (see a2dvi_loop)
+void a2dvi_irq_core1_init(void);
+#endif
+
+#ifdef FEATURE_DVI_STATS
+// DVI statistics, to compare the DMA IRQ on core 0 or core 1 (shown on the debug page)
+#define DVI_STATS_IRQS   (525*60) // IRQs per measurement: one second of scanlines
+#define DVI_STATS_FRAMES 60       // frames per render idle time measurement
+
+extern volatile uint32_t dvi_irq_jitter;      // spread of the intervals between IRQs (CPU cycles)
+extern volatile uint32_t dvi_irq_max_cycles;  // longest IRQ (CPU cycles)
+extern volatile uint32_t dvi_late_lines;      // scanlines which were not rendered in time
+extern volatile uint32_t render_idle_percent; // share of time the render core waited for free buffers
+
+void a2dvi_stats_frame(void);
+#endif
@@ -31,9 +31,17 @@ extern struct dvi_inst dvi0;
 #define DVI_WORDS_PER_CHANNEL (640/2)
 #define DVI_APPLE2_XOFS       ((640/2-560/2)/2)
 
+#ifdef FEATURE_DVI_STATS
+// accounts the time waiting for a free buffer, see a2dvi.c
+extern void dvi_wait_scanline(uint32_t** pTmdsbuf);
+#define dvi_get_scanline(tmdsbuf)  \
+    uint32_t* tmdsbuf;\
+    dvi_wait_scanline(&tmdsbuf);
+#else
 #define dvi_get_scanline(tmdsbuf)  \
     uint32_t* tmdsbuf;\
     queue_remove_blocking_u32(&dvi0.q_tmds_free, &tmdsbuf);
+#endif
 
 #define dvi_scanline_rgb(tmdsbuf, tmdsbuf_red, tmdsbuf_green, tmdsbuf_blue) \
         uint32_t *tmdsbuf_blue  = tmdsbuf+DVI_APPLE2_XOFS; \
@@ -48,7 +56,18 @@ extern struct dvi_inst dvi0;
         destbuf[i+2*DVI_WORDS_PER_CHANNEL] = srcbuf[i+2*DVI_WORDS_PER_CHANNEL]; \
     }
 
+#ifdef FEATURE_ROW_CACHE
+// Row cache: while a cache line is being (re-)rendered, each sent scanline is also stored there
+extern uint32_t* row_cache_capture;
+extern void row_cache_store(const uint32_t* tmdsbuf);
+#define dvi_capture_scanline(tmdsbuf) \
+    if (row_cache_capture) row_cache_store(tmdsbuf);
+#else
+#define dvi_capture_scanline(tmdsbuf)
+#endif
+
 #define dvi_send_scanline(tmdsbuf) \
+    dvi_capture_scanline(tmdsbuf) \
     queue_add_blocking_u32(&dvi0.q_tmds_valid, &tmdsbuf);
 
 // DVI TMDS encoding data (Transition-Minimized Differential Signaling)
@@ -29,6 +29,13 @@ SOFTWARE.
 #include "applebus/abus.h"
 #include "applebus/buffers.h"
 #include "config/config.h"
+#include "applebus/switch_profiler.h"
+#include "applebus/bus_jobs.h"
+#include "applebus/bus_stats.h"
+#include "applebus/bus_trace.h"
+#include "dvi/a2dvi.h"
+#include "render/render.h"
+#include "render/render_tasks.h"
 #include "fonts/textfont.h"
 #include "menu.h"
 
@@ -288,7 +295,7 @@ void DELAYED_COPY_CODE(menuShowTest)()
 
             uint line = y >> 1;
             uint16_t address = 0x400+((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40)+x;
-            apple_memory[address] = (apple_memory[address] & mask) | color;
+            APPLE_MEM(address) = (APPLE_MEM(address) & mask) | color;
         }
     }
 
@@ -318,6 +325,46 @@ void int2str(uint32_t value, char* pStrBuf, uint32_t digits)
     pStrBuf[digits]=0;
 }
 
+#ifdef FEATURE_SWITCH_PROFILER
+static void menuShowProfileRow(uint8_t x1, uint8_t x2, uint8_t y, const char* pName, uint32_t average, uint32_t maximum)
+{
+    char s[16];
+    printXY(x1, y, pName, PRINTMODE_NORMAL);
+    int2str(average, s, 7);
+    printXY(x2, y, s, PRINTMODE_NORMAL);
+    int2str(maximum, s, 7);
+    printXY(x2+8, y, s, PRINTMODE_NORMAL);
+}
+
+// soft-switch statistics per frame (over the most recent frames) and the most frequently used switches
+static void menuShowSwitchProfile(uint8_t x1, uint8_t x2)
+{
+    switch_profile_t average, maximum;
+    switch_profiler_summary(&average, &maximum);
+
+    printXY(x2, 12, "    AVG     MAX", PRINTMODE_NORMAL);
+    menuShowProfileRow(x1, x2, 13, "PAGE FLIPS:",    average.page_flips,        maximum.page_flips);
+    menuShowProfileRow(x1, x2, 14, "MODE CHANGES:",  average.mode_changes,      maximum.mode_changes);
+    menuShowProfileRow(x1, x2, 15, "MID-FRAME:",     average.mid_frame_changes, maximum.mid_frame_changes);
+    menuShowProfileRow(x1, x2, 16, "SHOWN WRITES:",  average.shown_writes,      maximum.shown_writes);
+    menuShowProfileRow(x1, x2, 17, "HIDDEN WRITES:", average.hidden_writes,     maximum.hidden_writes);
+
+    uint8_t registers[3];
+    uint32_t count = switch_profiler_hot_registers(registers, 3);
+    printXY(x1, 19, "HOT SWITCHES:", PRINTMODE_NORMAL);
+    for (uint32_t i=0;i<count;i++)
+    {
+        char s[5];
+        s[0] = 0x80|'C';
+        s[1] = 0x80|'0';
+        s[2] = 0x80|"0123456789ABCDEF"[registers[i] >> 4];
+        s[3] = 0x80|"0123456789ABCDEF"[registers[i] & 0xf];
+        s[4] = 0;
+        printXY(x2+1+i*5, 19, s, PRINTMODE_NORMAL);
+    }
+}
+#endif
+
 void menuShowDebug()
 {
     menuShowFrame();
@@ -339,6 +386,21 @@ void menuShowDebug()
         printXY(X2+1,4, s, PRINTMODE_NORMAL);
 
         // show statistics
+#ifdef FEATURE_BUS_JOBS
+        // share of the bus core's time used by jobs (%), longest job step (CPU cycles)
+        printXY(X1, 2, "BUS JOBS:", PRINTMODE_NORMAL);
+        int2str(bus_job_load, s, 7);
+        printXY(X2, 2, s, PRINTMODE_NORMAL);
+        int2str(bus_job_max_cycles, s, 7);
+        printXY(X2+8, 2, s, PRINTMODE_NORMAL);
+#endif
+
+#ifdef FEATURE_BUS_FILTER
+        printXY(X1, 5, "FILTERED READS:", PRINTMODE_NORMAL);
+        int2str(bus_filtered_counter, s, 14);
+        printXY(X2, 5, s, PRINTMODE_NORMAL);
+#endif
+
         printXY(X1, 6, "BUS CYCLES:", PRINTMODE_NORMAL);
         int2str(bus_counter, s, 14);
         printXY(X2, 6, s, PRINTMODE_NORMAL);
@@ -363,6 +425,36 @@ void menuShowDebug()
         int2str(devicerom_counter, s, 14);
         printXY(X2,11, s, PRINTMODE_NORMAL);
 
+#ifdef FEATURE_SWITCH_PROFILER
+        menuShowSwitchProfile(X1, X2);
+#endif
+
+#ifdef FEATURE_DVI_STATS
+        // DMA IRQ: interval spread and longest IRQ (CPU cycles)
+        printXY(X1, 1, "DVI IRQ JIT/MAX:", PRINTMODE_NORMAL);
+        int2str(dvi_irq_jitter, s, 7);
+        printXY(X2, 1, s, PRINTMODE_NORMAL);
+        int2str(dvi_irq_max_cycles, s, 7);
+        printXY(X2+8, 1, s, PRINTMODE_NORMAL);
+
+        // render core: idle time (%) and scanlines not ready in time
+        printXY(X1,21, "RENDER IDLE/LATE:", PRINTMODE_NORMAL);
+        int2str(render_idle_percent, s, 7);
+        printXY(X2,21, s, PRINTMODE_NORMAL);
+        int2str(dvi_late_lines, s, 7);
+        printXY(X2+8,21, s, PRINTMODE_NORMAL);
+#endif
+
+#if defined(FEATURE_FRAME_SNAPSHOT) && !defined(FEATURE_TEST)
+        // longest frame snapshot (us) for 40/80 column text, HIRES and DHGR (test builds show the boot time instead)
+        printXY(X1,18, "SNAPSHOT US:", PRINTMODE_NORMAL);
+        for (uint i=0;i<RENDER_SNAPSHOT_KINDS;i++)
+        {
+            int2str(render_snapshot_us[i], s, 4);
+            printXY(X1+13+i*5, 18, s, PRINTMODE_NORMAL);
+        }
+#endif
+
 #ifdef FEATURE_TEST
         printXY(X1,18, "BOOT TIME:", PRINTMODE_NORMAL);
         int2str(boot_time, s, 14);
@@ -371,6 +463,222 @@ void menuShowDebug()
     }
 }
 
+#ifdef FEATURE_BUS_STATS
+// second debug page ('B' on the debug page): bus core utilization of the most recent 100000 bus words
+static void menuShowBusStats()
+{
+    menuShowFrame();
+
+    const uint8_t X1 = 5;
+    const uint8_t X2 = X1+17;
+    char s[16];
+
+    centerY(2, "BUS CORE STATISTICS", PRINTMODE_NORMAL);
+
+    printXY(X1, 4, "BUSY/IDLE (%):", PRINTMODE_NORMAL);
+    const uint32_t busy = (bus_stats.busy_percent > 100) ? 100 : bus_stats.busy_percent;
+    int2str(busy, s, 7);
+    printXY(X2, 4, s, PRINTMODE_NORMAL);
+    int2str(100-busy, s, 7);
+    printXY(X2+8, 4, s, PRINTMODE_NORMAL);
+
+    // processing time per bus word (CPU cycles)
+    printXY(X1, 5, "AVG/MAX CYCLES:", PRINTMODE_NORMAL);
+    int2str(bus_stats.avg_cycles, s, 7);
+    printXY(X2, 5, s, PRINTMODE_NORMAL);
+    int2str(bus_stats.max_cycles, s, 7);
+    printXY(X2+8, 5, s, PRINTMODE_NORMAL);
+
+    printXY(X1, 6, "PEAK CYCLES:", PRINTMODE_NORMAL);
+    int2str(bus_stats_peak_cycles, s, 14);
+    printXY(X2, 6, s, PRINTMODE_NORMAL);
+
+    // RX FIFO level before each read: words already waiting mean the bus core falls behind
+    printXY(X1, 8, "FIFO LEVEL:", PRINTMODE_NORMAL);
+    printXY(X2, 8, "  WORDS       %", PRINTMODE_NORMAL);
+    const uint32_t words = bus_stats.words;
+    for (uint i=0;i<BUS_STATS_FIFO_LEVELS;i++)
+    {
+        const uint32_t count = bus_stats.fifo_levels[i];
+        int2str(i, s, 1);
+        printXY(X1+2, 9+i, s, PRINTMODE_NORMAL);
+        int2str(count, s, 7);
+        printXY(X2, 9+i, s, PRINTMODE_NORMAL);
+        int2str((words) ? (uint32_t)((count * 100ull) / words) : 0, s, 7);
+        printXY(X2+8, 9+i, s, PRINTMODE_NORMAL);
+    }
+}
+#endif
+
+// render core tasks ('T' on the debug page): slice times of the tasks run after each frame
+static void menuShowRenderTasks()
+{
+    menuShowFrame();
+
+    const uint8_t X1 = 1;
+    char s[16];
+
+    centerY(2, "RENDER CORE TASKS", PRINTMODE_NORMAL);
+    // all times in microseconds
+    printXY(X1, 4, "TASK    BUDGET   MAX SLICES OVER DEFER", PRINTMODE_NORMAL);
+
+    const uint32_t cycles_per_us = (render_tasks_cycles_per_us) ? render_tasks_cycles_per_us : 1;
+    for (uint i=0;i<render_tasks_count;i++)
+    {
+        const render_task_t* pTask = render_tasks[i];
+        const uint8_t y = 5+i;
+        printXY(X1, y, pTask->name, PRINTMODE_NORMAL);
+        int2str(pTask->budget_us, s, 6);
+        printXY(X1+8, y, s, PRINTMODE_NORMAL);
+        int2str(pTask->max_cycles / cycles_per_us, s, 6);
+        printXY(X1+14, y, s, PRINTMODE_NORMAL);
+        int2str(pTask->slices, s, 7);
+        printXY(X1+20, y, s, PRINTMODE_NORMAL);
+        int2str(pTask->overruns, s, 5);
+        printXY(X1+27, y, s, PRINTMODE_NORMAL);
+        int2str(pTask->deferred, s, 6);
+        printXY(X1+32, y, s, PRINTMODE_NORMAL);
+    }
+
+    printXY(X1, 6+RENDER_TASKS_MAX, "MAX PER FRAME:", PRINTMODE_NORMAL);
+    int2str(render_tasks_max_cycles / cycles_per_us, s, 6);
+    printXY(X1+14, 6+RENDER_TASKS_MAX, s, PRINTMODE_NORMAL);
+    printXY(X1, 7+RENDER_TASKS_MAX, "VBLANK:", PRINTMODE_NORMAL);
+    int2str(RENDER_VBLANK_US, s, 6);
+    printXY(X1+14, 7+RENDER_TASKS_MAX, s, PRINTMODE_NORMAL);
+}
+
+#ifdef FEATURE_BUS_TRACE
+#define TRACE_VIEW_ROWS 16
+
+// page of the bus trace viewer currently shown (-1: none)
+static int32_t TraceViewerPage = -1;
+
+static void int2hexstr(uint32_t value, char* pStrBuf, uint32_t digits)
+{
+    for (int32_t i=digits-1;i>=0;i--)
+    {
+        pStrBuf[i] = 0x80|"0123456789ABCDEF"[value & 0xf];
+        value >>= 4;
+    }
+    pStrBuf[digits]=0;
+}
+
+// bus trace viewer ('V' on the debug page): the records of the capture, numbered relative to the trigger
+static void menuShowBusTrace(int32_t page)
+{
+    menuShowFrame();
+
+    char s[16];
+    printXY(1, 2, "BUS TRACE:", PRINTMODE_NORMAL);
+    printXY(12, 2, bus_trace_state(), PRINTMODE_NORMAL);
+    printXY(23, 2, "TRIGGER:", PRINTMODE_NORMAL);
+    printXY(32, 2, bus_trace_trigger_name(), PRINTMODE_NORMAL);
+    printXY(1, 3, "     #  CYCLES R/W ADDR DATA", PRINTMODE_NORMAL);
+
+    const int32_t trigger = bus_trace_trigger_record();
+    for (uint32_t i=0;i<TRACE_VIEW_ROWS;i++)
+    {
+        const uint32_t record = page*TRACE_VIEW_ROWS+i;
+        bus_trace_record_t r;
+        if (!bus_trace_get(record, &r))
+            break;
+        const uint32_t row = 4+i;
+
+        const int32_t number = (trigger >= 0) ? (int32_t) record - trigger : (int32_t) record;
+        int2str((number < 0) ? -number : number, &s[1], 5);
+        s[0] = 0x80|((number < 0) ? '-' : ' ');
+        printXY(1, row, s, PRINTMODE_NORMAL);
+
+        int2str(r.cycles, s, 6);
+        printXY(8, row, s, PRINTMODE_NORMAL);
+
+        printXY(16, row, ACCESS_WRITE(r.value) ? "W" : "R", PRINTMODE_NORMAL);
+        int2hexstr(ADDRESS_BUS(r.value), s, 4);
+        printXY(19, row, s, PRINTMODE_NORMAL);
+        // read cycles only carry data with FEATURE_READ_DATA
+        if (ACCESS_WRITE(r.value) || ACCESS_READ_DATA(r.value))
+        {
+            int2hexstr(BUS_DATA(r.value), s, 2);
+            printXY(25, row, s, PRINTMODE_NORMAL);
+        }
+        if (CARD_DEVSEL(r.value))
+            printXY(28, row, "DEV", PRINTMODE_NORMAL);
+        if ((int32_t) record == trigger)
+            printXY(32, row, "<TRIG", PRINTMODE_INVERSE);
+    }
+
+    printXY(1, 21, "J/K PAGE  A ARM  S STOP  X EXPORT", PRINTMODE_NORMAL);
+    TraceViewerPage = page;
+}
+#endif
+
+// Keys on the debug page and its sub pages. Returns true when a page was shown.
+static bool menuDebugPageKey(char key)
+{
+    // uppercase
+    if ((key>='a')&&(key<='z'))
+    {
+        key = (key-'a')+'A';
+    }
+
+#ifdef FEATURE_BUS_TRACE
+    const int32_t page = TraceViewerPage;
+    TraceViewerPage = -1;
+    switch(key)
+    {
+        case 'V':
+        {
+            // start at the trigger's page
+            const int32_t trigger = bus_trace_trigger_record();
+            menuShowBusTrace((trigger > 0) ? trigger/TRACE_VIEW_ROWS : 0);
+            return true;
+        }
+        case 'K': // fall-through
+        case 21:  // RIGHT
+            if (page < 0)
+                break;
+            menuShowBusTrace(((uint32_t)(page+1)*TRACE_VIEW_ROWS < bus_trace_count()) ? page+1 : page);
+            return true;
+        case 'J': // fall-through
+        case 8:   // LEFT
+            if (page < 0)
+                break;
+            menuShowBusTrace((page > 0) ? page-1 : 0);
+            return true;
+        case 'A':
+        case 'S':
+        case 'X':
+            if (page < 0)
+                break;
+            if (key == 'A')
+                bus_trace_rearm();
+            else
+            if (key == 'S')
+                bus_trace_arm(BUS_TRACE_STOP);
+            else
+                bus_trace_export();
+            menuShowBusTrace(0);
+            return true;
+        default:
+            break;
+    }
+#endif
+#ifdef FEATURE_BUS_STATS
+    if (key == 'B')
+    {
+        menuShowBusStats();
+        return true;
+    }
+#endif
+    if (key == 'T')
+    {
+        menuShowRenderTasks();
+        return true;
+    }
+    return false;
+}
+
 bool DELAYED_COPY_CODE(menuDoSelection)(bool increase)
 {
     switch(CurrentMenu)
@@ -669,6 +977,13 @@ void DELAYED_COPY_CODE(menuShow)(char key)
     if (IgnoreNextKeypress)
     {
         IgnoreNextKeypress = false;
+        // sub pages of the debug page
+        if ((CurrentMenu == 15)&&(menuDebugPageKey(key)))
+        {
+            IgnoreNextKeypress = true;
+            abus_clear_fifo();
+            return;
+        }
     }
     else
     if (menuCheckKeys(key))
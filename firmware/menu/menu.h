@@ -43,6 +43,11 @@ void showTitle(TPrintMode PrintMode);
 void menuShow(char key);
 void menuShowSaved(void);
 
+// names of the configuration values, also used for OSD toasts
+extern const char* MenuColorMode[];
+extern const char* MenuForcedMono[];
+extern const char* MenuFontNames[];
+
 #ifdef FEATURE_TEST
 void menuShowDebug();
 #endif
@@ -27,13 +27,192 @@ SOFTWARE.
 #include <stdlib.h>
 #include "applebus/buffers.h"
 #include "config/config.h"
+#include "applebus/switch_profiler.h"
+#include "applebus/abus_timing.h"
+#include "dvi/a2dvi.h"
+#include "usb/usb_stream.h"
+#include "audio/audio.h"
+#include "render_tasks.h"
 
 #include "render.h"
 
 bool mono_rendering = false;
 
+uint32_t DELAYED_COPY_DATA(render_frame_switches) = SOFTSW_TEXT_MODE;
+uint32_t DELAYED_COPY_DATA(render_frame_flags)    = IFLAGS_V7_MODE3;
+
+const volatile uint8_t* DELAYED_COPY_DATA(render_text_pages)[4] =
+{
+    apple_memory   + SHADOW_OFFSET(0x0400), apple_memory   + SHADOW_OFFSET(0x0800),
+    private_memory + SHADOW_OFFSET(0x0400), private_memory + SHADOW_OFFSET(0x0800)
+};
+const volatile uint8_t* DELAYED_COPY_DATA(render_hgr_pages)[4] =
+{
+    apple_memory   + SHADOW_OFFSET(0x2000), apple_memory   + SHADOW_OFFSET(0x4000),
+    private_memory + SHADOW_OFFSET(0x2000), private_memory + SHADOW_OFFSET(0x4000)
+};
+
+#ifdef FEATURE_BUS_JOBS
+static bool charsets_loading = false;
+#endif
+
+render_line_kernel_t DELAYED_COPY_DATA(render_lores_line);
+render_line_kernel_t DELAYED_COPY_DATA(render_hires_line);
+render_line_kernel_t DELAYED_COPY_DATA(render_dhgr_line);
+render_line_kernel_t DELAYED_COPY_DATA(render_dhgr_mono_line);
+render_line_kernel_t DELAYED_COPY_DATA(render_dgr_line);
+
+#ifdef FEATURE_ASM_KERNELS
+uint32_t DELAYED_COPY_DATA(tmds_mono_nibbles)[3*16*8];
+
+static void render_init_mono_nibbles()
+{
+    for (uint cmode=0;cmode<3;cmode++)
+    {
+        const uint32_t* tmds_pair = &tmds_mono_pixel_pair[cmode*12];
+        for (uint nibble=0;nibble<16;nibble++)
+        {
+            uint32_t* pEntry = &tmds_mono_nibbles[(cmode*16+nibble)*8];
+            uint first  = nibble & 3;
+            uint second = nibble >> 2;
+            pEntry[0] = tmds_pair[first +8];
+            pEntry[1] = tmds_pair[second+8];
+            pEntry[2] = tmds_pair[first +4];
+            pEntry[3] = tmds_pair[second+4];
+            pEntry[4] = tmds_pair[first +0];
+            pEntry[5] = tmds_pair[second+0];
+            pEntry[6] = 0;
+            pEntry[7] = 0;
+        }
+    }
+}
+#endif
+
+// color configuration the current kernels were selected for
+static uint32_t kernel_config = 0xffffffff;
+
+void DELAYED_COPY_CODE(render_select_kernels)()
+{
+    uint32_t config = (mono_rendering << 8) | color_mode;
+    if (config == kernel_config)
+        return;
+    kernel_config = config;
+
+    uint kernel = (mono_rendering) ? 1+color_mode : RENDER_KERNEL_COLOR;
+    render_lores_line     = lores_line_kernels[kernel];
+    render_hires_line     = hires_line_kernels[kernel];
+    render_dhgr_line      = dhgr_line_kernels[kernel];
+    render_dhgr_mono_line = dhgr_line_kernels[1+color_mode];
+    render_dgr_line       = dgr_line_kernels[color_mode];
+}
+
+// applied before each frame rather than as a render task, which could leave frames with stale colors
+static void DELAYED_COPY_CODE(render_apply_colors)(void)
+{
+    dvi0.scanline_emulation = (internal_flags & IFLAGS_SCANLINEEMU) != 0;
+
+    mono_rendering = (soft_switches & SOFTSW_MONOCHROME)||(internal_flags & IFLAGS_FORCED_MONO);
+    render_select_kernels();
+}
+
+static bool DELAYED_COPY_CODE(render_task_flasher)(void)
+{
+    update_text_flasher();
+    return false;
+}
+
+static bool DELAYED_COPY_CODE(render_task_charsets)(void)
+{
+#ifdef FEATURE_BUS_JOBS
+    // the bus core copies the character sets: drop the cached lines once it is done
+    if (charsets_loading && !config_charsets_pending())
+    {
+        charsets_loading = false;
+#ifdef FEATURE_ROW_CACHE
+        render_cache_invalidate();
+#endif
+    }
+    if (display_list.text_mode && reload_charsets && !charsets_loading)
+    {
+        config_queue_charsets();
+        charsets_loading = true;
+    }
+    return false;
+#else
+    // one character set per slice: each is a 2KB copy from flash
+    if (display_list.text_mode && reload_charsets)
+    {
+        const bool more = config_load_next_charset();
+#ifdef FEATURE_ROW_CACHE
+        render_cache_invalidate();
+#endif
+        return more;
+    }
+    return false;
+#endif
+}
+
+static bool DELAYED_COPY_CODE(render_task_machine)(void)
+{
+    // machine auto-detection is kept off the bus core: runs every few frames, and right after a reset
+    if (current_machine == MACHINE_AUTO)
+    {
+        config_detect_machine();
+    }
+    return false;
+}
+
+#ifdef FEATURE_USB_STREAM
+static bool DELAYED_COPY_CODE(render_task_usb)(void)
+{
+    usb_stream_frame();
+    return false;
+}
+#endif
+
+// deferred work after each frame, in order of priority (see render_tasks.h)
+static render_task_t DELAYED_COPY_DATA(render_task_list)[] =
+{
+    // name        slice                budget_us period                 trigger
+    { "FLASHER",  render_task_flasher,  10,      1,                     NULL },
+    { "CHARSETS", render_task_charsets, 300,     1,                     NULL },
+    { "MACHINE",  render_task_machine,  100,     MACHINE_DETECT_FRAMES, &machine_detect_request },
+#ifdef FEATURE_BUS_TIMING
+    { "TIMING",   abus_timing_calibrate, 50,     60,                    &abus_timing_request },
+#endif
+#ifdef FEATURE_MOCKINGBOARD
+    { "AUDIO",    audio_slice,          200,     1,                     NULL },
+#endif
+#ifdef FEATURE_USB_STREAM
+    { "USB",      render_task_usb,      150,     1,                     NULL },
+#endif
+};
+
 void DELAYED_COPY_CODE(render_init)()
 {
+#ifdef FEATURE_ASM_KERNELS
+    render_init_mono_nibbles();
+#endif
+#ifdef FEATURE_ROW_CACHE
+    render_cache_init();
+#endif
+#ifdef FEATURE_OSD
+    render_osd_init();
+#endif
+#ifdef FEATURE_MOCKINGBOARD
+    audio_init();
+#endif
+#ifdef FEATURE_USB_STREAM
+    usb_stream_init();
+#endif
+    render_select_kernels();
+
+    render_tasks_init();
+    for (uint i=0;i<sizeof(render_task_list)/sizeof(render_task_list[0]);i++)
+    {
+        render_tasks_register(&render_task_list[i]);
+    }
+
     // clear status lines
     for (uint i=0;i<sizeof(status_line)/4;i++)
     {
@@ -56,65 +235,29 @@ void DELAYED_COPY_CODE(render_loop)()
         }
 #endif
 
-        {
-            render_debug(true);
-
-            switch(soft_switches & SOFTSW_MODE_MASK)
-            {
-                case 0:
-                    if(soft_switches & SOFTSW_DGR)
-                    {
-                        render_dgr();
-                    }
-                    else
-                    {
-                        render_lores();
-                    }
-                    break;
-                case SOFTSW_MIX_MODE:
-                    if((soft_switches & (SOFTSW_80COL | SOFTSW_DGR)) == (SOFTSW_80COL | SOFTSW_DGR))
-                    {
-                        render_mixed_dgr();
-                    }
-                    else
-                    {
-                        render_mixed_lores();
-                    }
-                    break;
-                case SOFTSW_HIRES_MODE:
-                    if(soft_switches & SOFTSW_DGR)
-                    {
-                        render_dhgr();
-                    }
-                    else
-                    {
-                        render_hires();
-                    }
-                    break;
-                case SOFTSW_HIRES_MODE|SOFTSW_MIX_MODE:
-                    if((soft_switches & (SOFTSW_80COL | SOFTSW_DGR)) == (SOFTSW_80COL | SOFTSW_DGR))
-                    {
-                        render_mixed_dhgr();
-                    }
-                    else
-                    {
-                        render_mixed_hires();
-                    }
-                    break;
-                default:
-                    render_text();
-                    break;
-            }
+        render_debug(true);
 
-        }
+        render_apply_colors();
+#ifdef FEATURE_FRAME_SNAPSHOT
+        render_snapshot_frame();
+#endif
+        render_compile_frame(&display_list);
+        render_execute_frame(&display_list);
 
         render_debug(false);
 
-        update_text_flasher();
+#ifdef FEATURE_OSD
+        render_osd_frame();
+#endif
 
-        dvi0.scanline_emulation = (internal_flags & IFLAGS_SCANLINEEMU) != 0;
+#ifdef FEATURE_SWITCH_PROFILER
+        switch_profiler_frame();
+#endif
+#ifdef FEATURE_DVI_STATS
+        a2dvi_stats_frame();
+#endif
 
-        mono_rendering = (soft_switches & SOFTSW_MONOCHROME)||(internal_flags & IFLAGS_FORCED_MONO);
+        render_tasks_run();
 
         frame_counter++;
     }
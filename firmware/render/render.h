@@ -31,25 +31,202 @@ SOFTWARE.
 
 extern bool mono_rendering;
 
-extern void render_loop();
+// Line kernels are split into a color kernel and monochrome kernels, so the inner loops
+// do not branch on color settings. render_loop() only swaps the pointers when the color
+// settings change.
+typedef void (*render_line_kernel_t)(bool p2, uint line);
+typedef void (*render_text40_kernel_t)(const uint8_t *page, unsigned int line);
+typedef void (*render_text80_kernel_t)(const uint8_t *page_a, const uint8_t *page_b, unsigned int line);
 
-extern void update_text_flasher();
-extern void render_text();
-extern void render_mixed_text();
-extern void render_text40_line(const uint8_t *page, unsigned int line, uint8_t color_mode);
-extern void render_color_text40_line(unsigned int line);
+// kernel variants: index 0 is the color kernel, 1+color_mode the monochrome kernels
+#define RENDER_KERNEL_COLOR    0
+#define RENDER_KERNEL_VARIANTS (1+3)
+
+extern render_line_kernel_t   lores_line_kernels[RENDER_KERNEL_VARIANTS];
+extern render_line_kernel_t   hires_line_kernels[RENDER_KERNEL_VARIANTS];
+extern render_line_kernel_t   dhgr_line_kernels[RENDER_KERNEL_VARIANTS];
+extern render_line_kernel_t   dgr_line_kernels[3];          // monochrome only, per color_mode
+extern render_text40_kernel_t text40_line_kernels[5];       // per color_mode, 3: black, 4: red (debug lines)
+extern render_text80_kernel_t text80_line_kernels[3];       // per color_mode
+
+// currently selected kernels
+extern render_line_kernel_t render_lores_line;
+extern render_line_kernel_t render_hires_line;
+extern render_line_kernel_t render_dhgr_line;
+extern render_line_kernel_t render_dhgr_mono_line;
+extern render_line_kernel_t render_dgr_line;
+
+// Instantiate the monochrome entry points of a line kernel, one per color mode. The kernel
+// must be an inline function taking the color mode as its last parameter. All entry points
+// share one copy of the kernel: a copy per color mode took 18KB more RAM and was not faster
+// (within 3% per mode, text40 up to 48% slower; tools/cycle_model.py modes).
+#define RENDER_MONO_KERNELS(kernel) \
+    static void DELAYED_COPY_CODE(kernel##_any)(bool p2, uint line, uint cmode) { kernel(p2, line, cmode); } \
+    static void DELAYED_COPY_CODE(kernel##_white)(bool p2, uint line) { kernel##_any(p2, line, COLOR_MODE_BW);    } \
+    static void DELAYED_COPY_CODE(kernel##_green)(bool p2, uint line) { kernel##_any(p2, line, COLOR_MODE_GREEN); } \
+    static void DELAYED_COPY_CODE(kernel##_amber)(bool p2, uint line) { kernel##_any(p2, line, COLOR_MODE_AMBER); }
+
+extern void render_select_kernels();
+
+#ifdef FEATURE_ASM_KERNELS
+// TMDS data for a nibble of monochrome dots (two pixel pairs): blue[2], green[2], red[2], padding[2]
+extern uint32_t tmds_mono_nibbles[3*16*8];
+
+// assembly kernels, see render_kernels.S
+extern void render_hires_mono_asm(const uint8_t* line_mem, uint32_t* tmdsbuf_blue, const uint32_t* nibbles, const uint16_t* dot_patterns);
+extern void render_dhgr_mono_asm(const uint8_t* line_mema, const uint8_t* line_memb, uint32_t* tmdsbuf_blue, const uint32_t* nibbles);
+extern void render_text80_mono_asm(const uint32_t* dots, uint32_t* tmdsbuf_blue, const uint32_t* nibbles);
+#endif
+
+#ifdef FEATURE_VIDEO_PLANES
+#include "applebus/video_planes.h"
+
+// Expand a video plane line (20 words of 28 monochrome dots) into a scanline.
+static __force_inline void render_mono_plane_line(const uint32_t* plane_line, uint32_t* tmdsbuf, uint cmode)
+{
+#ifdef FEATURE_ASM_KERNELS
+    render_text80_mono_asm(plane_line, tmdsbuf+DVI_APPLE2_XOFS, &tmds_mono_nibbles[cmode*16*8]);
+#else
+    const uint32_t* tmds_pair = &tmds_mono_pixel_pair[cmode*12];
+    dvi_scanline_rgb(tmdsbuf, tmdsbuf_red, tmdsbuf_green, tmdsbuf_blue);
+
+    for (uint i=0;i<VIDEO_PLANE_WORDS;i++)
+    {
+        uint32_t dots = plane_line[i];
+        for (uint j=0;j<14;j++)
+        {
+            const uint32_t* pTmds = &tmds_pair[dots&0x3];
+            *(tmdsbuf_red++)   = pTmds[0];
+            *(tmdsbuf_green++) = pTmds[4];
+            *(tmdsbuf_blue++)  = pTmds[8];
+            dots >>= 2;
+        }
+    }
+#endif
+}
+#endif
+
+// Indexed-color stage: kernels for modes without a fused TMDS kernel decode Apple
+// memory into 4-bit color indexes for the 280 double pixels of a line, packed 8 per
+// word, which render_expand_indexed() then converts to TMDS data. The fused kernels
+// remain for the common modes: the expand step alone takes about 90% of the cycles of
+// a whole fused DHGR color line (tools/cycle_model.py indexed), so only the Video-7
+// foreground/background HIRES mode uses this stage.
+#define RENDER_INDEX_WORDS (560/2/8)
+
+extern uint32_t render_line_indexes[RENDER_INDEX_WORDS];
+extern void     render_expand_indexed(const uint32_t* indexes, uint32_t* tmdsbuf, const uint32_t* palette);
+
+// Display list: render_compile_frame() translates the video mode at frame start into a
+// short list of ops, each running one kernel over a range of text rows/graphics lines.
+// render_execute_frame() then only iterates the ops. With FEATURE_MIDFRAME_SPLITS, a frame
+// whose video mode was switched at specific scanlines is compiled into ops per line range.
+enum
+{
+    RENDER_OP_TEXT40,       // rows of 40 column text
+    RENDER_OP_TEXT80,       // rows of 80 column text
+    RENDER_OP_COLOR_TEXT40, // rows of Video-7 color text
+    RENDER_OP_LORES,        // rows of LORES graphics
+    RENDER_OP_DGR,          // rows of double LORES graphics
+    RENDER_OP_HIRES,        // lines of HIRES graphics
+    RENDER_OP_DHGR,         // lines of double HIRES graphics
+    RENDER_OP_COUNT
+};
+
+typedef struct
+{
+    uint8_t        op;      // RENDER_OP_*
+    uint8_t        first;   // first text row or graphics line
+    uint8_t        count;   // number of text rows or graphics lines
+    union
+    {
+        render_line_kernel_t   line;
+        render_text40_kernel_t text40;
+        render_text80_kernel_t text80;
+    } kernel;
+    const uint8_t* page_a;  // text ops only
+    const uint8_t* page_b;  // 80 column text only
+    int8_t         page2;   // graphics ops: display page (0/1), or RENDER_PAGE_LIVE
+} render_op_t;
 
-extern void render_lores();
-extern void render_mixed_lores();
+// graphics ops without mid-frame splits sample PAGE2 per line, so page flips take effect immediately
+#define RENDER_PAGE_LIVE (-1)
 
-extern void render_hires();
-extern void render_mixed_hires();
+// two ops per video mode (graphics + mixed text), for up to 8 modes per frame with mid-frame splits
+#define RENDER_MAX_OPS 16
 
-extern void render_dhgr();
-extern void render_mixed_dhgr();
+typedef struct
+{
+    uint8_t     count;
+    bool        text_mode;  // text rows shown (charset reloads wait for them)
+    render_op_t ops[RENDER_MAX_OPS];
+} render_display_list_t;
 
-extern void render_dgr();
-extern void render_mixed_dgr();
+extern render_display_list_t display_list;
+
+// Video mode and pages of the current frame: render_compile_frame() samples soft_switches/internal_flags
+// once per frame, and the kernels read the video pages through these pointers ([page], +2 for the aux
+// bank). They point to the shadow memory, or with FEATURE_FRAME_SNAPSHOT to the copies of the displayed
+// pages which render_snapshot_frame() takes at frame start, so the bus core cannot tear a frame.
+extern uint32_t render_frame_switches;
+extern uint32_t render_frame_flags;
+extern const volatile uint8_t* render_text_pages[4];
+extern const volatile uint8_t* render_hgr_pages[4];
+
+#ifdef FEATURE_FRAME_SNAPSHOT
+#include "applebus/dirty_rows.h"
+
+// snapshot kinds, by the amount of memory copied
+enum
+{
+    RENDER_SNAPSHOT_TEXT40, // 1KB text/LORES
+    RENDER_SNAPSHOT_TEXT80, // 2KB 80 column text/DGR
+    RENDER_SNAPSHOT_HIRES,  // 8KB HIRES (+1KB in mixed mode)
+    RENDER_SNAPSHOT_DHGR,   // 16KB DHGR (+2KB in mixed mode)
+    RENDER_SNAPSHOT_KINDS
+};
+
+// maximum cost of a frame's snapshot per kind, in microseconds (shown on the debug page)
+extern uint32_t render_snapshot_us[RENDER_SNAPSHOT_KINDS];
+#ifdef FEATURE_DIRTY_ROWS
+// rows written during the previous frame, collected by the snapshot (used by the row cache)
+extern dirty_rows_t render_snapshot_dirty;
+#endif
+
+extern void render_snapshot_frame(void);
+#endif
+
+#ifdef FEATURE_ROW_CACHE
+// Row cache (PICO2): frames of monochrome (white or green) text, HIRES and DHGR keep every encoded
+// line. Only lines whose source rows were written (see FEATURE_DIRTY_ROWS), text rows with flashing
+// characters when the flasher toggles, or all lines when the mode, palette or character set change,
+// are rendered again. The DMA reads the other lines directly from the cache.
+extern volatile uint_fast32_t text_flasher_mask;
+
+extern void render_cache_init(void);
+extern void render_cache_invalidate(void);
+extern bool render_cache_begin_frame(const render_display_list_t* dl);
+extern void render_cache_execute_op(const render_op_t* pOp);
+#endif
+
+#ifdef FEATURE_OSD
+#include "render_osd.h"
+
+extern void render_osd_init(void);
+extern void render_osd_frame(void);
+extern void render_osd_clip(render_display_list_t* dl);
+extern void render_osd_band(void);
+#endif
+
+extern void render_compile_frame(render_display_list_t* dl);
+extern void render_execute_frame(const render_display_list_t* dl);
+
+extern void render_loop();
+
+extern void update_text_flasher();
+extern void render_text40_line(const uint8_t *page, unsigned int line, uint8_t color_mode);
+extern void render_color_text40_line(unsigned int line);
+extern void render_dhgr_v7fb_line(bool p2, uint line);
 
 extern void render_debug(bool top);
 
@@ -0,0 +1,266 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <string.h>
+#include "applebus/buffers.h"
+#include "applebus/dirty_rows.h"
+#include "config/config.h"
+#include "render.h"
+
+#ifdef FEATURE_ROW_CACHE
+
+// Encoded lines are stored with a stride of 300 words: 280 words of Apple pixels, followed by 20
+// black words which serve as the right border of this line and the left border of the next one.
+// So the DMA reads each line (DVI_WORDS_PER_CHANNEL words, from its left border) in place.
+#define ROW_CACHE_STRIDE (DVI_WORDS_PER_CHANNEL-DVI_APPLE2_XOFS)
+#define ROW_CACHE_WORDS  (192*ROW_CACHE_STRIDE+DVI_APPLE2_XOFS)
+
+static uint32_t row_cache[ROW_CACHE_WORDS];
+static uint32_t row_cache_black[DVI_WORDS_PER_CHANNEL];
+
+// per line: op and display page the cached line was rendered for (0: invalid)
+static uint8_t  row_cache_tag[192];
+#define ROW_CACHE_TAG(op, page) (0x80 | ((page) << 4) | (op))
+
+uint32_t*       row_cache_capture;   // next cache line to store, while re-rendering
+
+static bool     row_cache_active;
+static uint32_t row_cache_key = 0xffffffff;
+static uint32_t row_cache_generation;
+static uint32_t row_cache_flasher;
+static uintptr_t row_cache_line_tags; // DVI_MONO_LINE_* tags of the lines queued in this frame
+
+// rows and lines written since the previous frame
+static dirty_rows_t row_cache_dirty;
+
+void DELAYED_COPY_CODE(render_cache_init)(void)
+{
+    for (uint i=0;i<ROW_CACHE_WORDS;i++)
+        row_cache[i] = TMDS_SYMBOL_0_0;
+    for (uint i=0;i<DVI_WORDS_PER_CHANNEL;i++)
+        row_cache_black[i] = TMDS_SYMBOL_0_0;
+    memset(row_cache_tag, 0, sizeof(row_cache_tag));
+    dvi0.mono_black = row_cache_black;
+}
+
+// drop all cached lines (e.g. the character set was reloaded)
+void DELAYED_COPY_CODE(render_cache_invalidate)(void)
+{
+    row_cache_generation++;
+}
+
+void DELAYED_COPY_CODE(row_cache_store)(const uint32_t* tmdsbuf)
+{
+    // all lanes of a monochrome white or green line carry the same dots as the green lane
+    const uint32_t* pGreen = tmdsbuf + DVI_WORDS_PER_CHANNEL + DVI_APPLE2_XOFS;
+    uint32_t* pCache = row_cache_capture + DVI_APPLE2_XOFS;
+    for (uint i=0;i<560/2;i++)
+        pCache[i] = pGreen[i];
+    row_cache_capture += ROW_CACHE_STRIDE;
+}
+
+// is there a flashing character in the given text row?
+static bool DELAYED_COPY_CODE(render_cache_row_flashes)(const volatile uint8_t* page, uint row)
+{
+    const volatile uint8_t* line_buf = page + ((row & 0x7) << 7) + (((row >> 3) & 0x3) * 40);
+    for (uint col=0;col<40;col++)
+    {
+        if ((line_buf[col] & 0xc0) == 0x40)
+            return true;
+    }
+    return false;
+}
+
+// mark the text rows with flashing characters as dirty
+static void DELAYED_COPY_CODE(render_cache_flash_rows)(void)
+{
+    if (render_frame_switches & SOFTSW_ALTCHAR)
+        return; // no flashing characters
+    for (uint page=0;page<2;page++)
+    {
+        for (uint bank=0;bank<2;bank++)
+        {
+            for (uint row=0;row<24;row++)
+            {
+                if (render_cache_row_flashes(render_text_pages[bank*2+page], row))
+                    row_cache_dirty.text[page][bank] |= 1u << row;
+            }
+        }
+    }
+}
+
+// Drop the cached lines whose source rows were written. This also covers lines which are not
+// rendered in this frame (e.g. the HIRES lines hidden by mixed mode text).
+static void DELAYED_COPY_CODE(render_cache_expire)(void)
+{
+    for (uint line=0;line<192;line++)
+    {
+        const uint8_t tag = row_cache_tag[line];
+        if (tag == 0)
+            continue;
+        const uint op   = tag & 0x0f;
+        const uint page = (tag >> 4) & 1;
+        uint32_t dirty;
+        if ((op == RENDER_OP_TEXT40)||(op == RENDER_OP_TEXT80))
+        {
+            dirty = row_cache_dirty.text[page][DIRTY_BANK_MAIN];
+            if (op == RENDER_OP_TEXT80)
+                dirty |= row_cache_dirty.text[page][DIRTY_BANK_AUX];
+            dirty >>= line/8;
+        }
+        else
+        {
+            dirty = row_cache_dirty.hires[page][DIRTY_BANK_MAIN][line >> 5];
+            if (op == RENDER_OP_DHGR)
+                dirty |= row_cache_dirty.hires[page][DIRTY_BANK_AUX][line >> 5];
+            dirty >>= line & 31;
+        }
+        if (dirty & 1)
+            row_cache_tag[line] = 0;
+    }
+}
+
+// can the op be served from the cache? Only white/green monochrome text, HIRES and DHGR ops.
+static bool DELAYED_COPY_CODE(render_cache_op_supported)(const render_op_t* pOp)
+{
+    switch(pOp->op)
+    {
+        case RENDER_OP_TEXT40:
+            return (pOp->kernel.text40 == text40_line_kernels[color_mode]);
+        case RENDER_OP_TEXT80:
+            return (pOp->kernel.text80 == text80_line_kernels[color_mode]);
+        case RENDER_OP_HIRES:
+            return (pOp->kernel.line == hires_line_kernels[1+color_mode]);
+        case RENDER_OP_DHGR:
+            return (pOp->kernel.line == dhgr_line_kernels[1+color_mode]);
+        default:
+            return false;
+    }
+}
+
+// Decide whether this frame is rendered through the cache, and collect the lines to re-render.
+bool DELAYED_COPY_CODE(render_cache_begin_frame)(const render_display_list_t* dl)
+{
+#ifdef FEATURE_FRAME_SNAPSHOT
+    // the frame snapshot already acknowledged the written rows
+    row_cache_dirty = render_snapshot_dirty;
+#else
+    // always acknowledge the written rows, so the bitmaps only cover the time since the previous frame
+    dirty_rows_snapshot(&row_cache_dirty);
+#endif
+
+    // text is monochrome in all modes, graphics only with monochrome rendering (see render_cache_op_supported)
+    bool active = (color_mode <= COLOR_MODE_GREEN);
+    for (uint i=0;(i<dl->count)&&(active);i++)
+    {
+        active = render_cache_op_supported(&dl->ops[i]);
+    }
+
+    // settings which affect every cached line
+    const uint32_t key = (row_cache_generation << 8) | (color_mode << 4) |
+                         ((render_frame_switches & SOFTSW_ALTCHAR) ? 2 : 0) | ((language_switch) ? 1 : 0);
+    if ((!active)||(!row_cache_active)||(key != row_cache_key))
+    {
+        memset(row_cache_tag, 0, sizeof(row_cache_tag));
+        row_cache_key = key;
+    }
+    row_cache_active = active;
+    if (!active)
+        return false;
+
+    if (row_cache_flasher != text_flasher_mask)
+    {
+        row_cache_flasher = text_flasher_mask;
+        render_cache_flash_rows();
+    }
+
+    render_cache_expire();
+
+    // the lanes are queued with each line: lines of the previous frame may still be waiting
+    row_cache_line_tags = DVI_MONO_LINE_TAG | ((color_mode == COLOR_MODE_BW) ? DVI_MONO_LINE_ALL_LANES : 0);
+    return true;
+}
+
+static inline void render_cache_send_line(uint line)
+{
+    uint32_t* tmdsbuf = (uint32_t*)((uintptr_t)&row_cache[line*ROW_CACHE_STRIDE] | row_cache_line_tags);
+    queue_add_blocking_u32(&dvi0.q_tmds_valid, &tmdsbuf);
+}
+
+void DELAYED_COPY_CODE(render_cache_execute_op)(const render_op_t* pOp)
+{
+    const uint end = pOp->first + pOp->count;
+    switch(pOp->op)
+    {
+        case RENDER_OP_TEXT40:
+        case RENDER_OP_TEXT80:
+        {
+            const uint page = (pOp->page_a == (const uint8_t*) render_text_pages[1]) ? 1 : 0;
+            const uint8_t tag = ROW_CACHE_TAG(pOp->op, page);
+            for (uint row=pOp->first;row<end;row++)
+            {
+                const uint line = row*8;
+                if (row_cache_tag[line] == tag)
+                {
+                    for (uint i=0;i<8;i++)
+                        render_cache_send_line(line+i);
+                    continue;
+                }
+
+                row_cache_capture = &row_cache[line*ROW_CACHE_STRIDE];
+                if (pOp->op == RENDER_OP_TEXT80)
+                    pOp->kernel.text80(pOp->page_a, pOp->page_b, row);
+                else
+                    pOp->kernel.text40(pOp->page_a, row);
+                row_cache_capture = NULL;
+                memset(&row_cache_tag[line], tag, 8);
+            }
+            break;
+        }
+        default:
+        {
+            // HIRES and DHGR lines
+            for (uint line=pOp->first;line<end;line++)
+            {
+                const uint page = (pOp->page2 == RENDER_PAGE_LIVE) ?
+                    (((soft_switches & (SOFTSW_80STORE | SOFTSW_PAGE_2)) == SOFTSW_PAGE_2) ? 1 : 0) : pOp->page2;
+                const uint8_t tag = ROW_CACHE_TAG(pOp->op, page);
+                if (row_cache_tag[line] == tag)
+                {
+                    render_cache_send_line(line);
+                    continue;
+                }
+
+                row_cache_capture = &row_cache[line*ROW_CACHE_STRIDE];
+                pOp->kernel.line(page, line);
+                row_cache_capture = NULL;
+                row_cache_tag[line] = tag;
+            }
+            break;
+        }
+    }
+}
+
+#endif // FEATURE_ROW_CACHE
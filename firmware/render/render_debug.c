@@ -25,6 +25,7 @@ SOFTWARE.
 #include <stdlib.h>
 #include "applebus/buffers.h"
 #include "config/config.h"
+#include "applebus/abus_timing.h"
 
 #include "render.h"
 
@@ -45,6 +46,34 @@ void DELAYED_COPY_CODE(copy_str)(uint8_t* dest, const char* pMsg)
     }
 }
 
+// short display list op names for the debug lines
+static const char* DELAYED_COPY_DATA(render_op_names)[RENDER_OP_COUNT] =
+{
+    "T40", "T80", "CT40", "GR", "DGR", "HGR", "DHGR"
+};
+
+// show the frame's display list: op name, first line and line count (hex)
+static void DELAYED_COPY_CODE(render_debug_display_list)(uint8_t* line)
+{
+    copy_str(&line[0], "DL");
+    uint x = 3;
+    for (uint i=0;(i<display_list.count)&&(x+11<=40);i++)
+    {
+        const render_op_t* pOp = &display_list.ops[i];
+        const char* pName = render_op_names[pOp->op];
+        while (*pName)
+        {
+            line[x++] = 0x80|*(pName++);
+        }
+        line[x++] = 0x80|':';
+        int2hex(&line[x], pOp->first, 2);
+        x += 2;
+        line[x++] = 0x80|'+';
+        int2hex(&line[x], pOp->count, 2);
+        x += 3;
+    }
+}
+
 void DELAYED_COPY_CODE(render_debug)(bool top)
 {
     if (!IS_IFLAG(IFLAGS_DEBUG_LINES))
@@ -156,8 +185,8 @@ void DELAYED_COPY_CODE(render_debug)(bool top)
     else
     {
         /*0123456789012345678901234567890123456789
-         *PC:1234 S:123 ZP:12              OV:1234
-         *   80STR AUXR AUXW AUXZ C3ROM CXROM IOUD
+         *DL HGR:00+A0 T40:14+04
+         *PC:1234 S:123 ZP:12 A1 1023K E00 OV:1234
          */
         uint8_t* line1 = &status_line[80];
         uint8_t* line2 = &status_line[120];
@@ -170,6 +199,8 @@ void DELAYED_COPY_CODE(render_debug)(bool top)
                 ((uint32_t*)line1)[i] = 0xA0A0A0A0;
             }
 
+            render_debug_display_list(line1);
+
             // program counter
             copy_str(&line2[0], "PC:");
             int2hex(&line2[3], last_address_pc, 4);
@@ -182,6 +213,21 @@ void DELAYED_COPY_CODE(render_debug)(bool top)
             copy_str(&line2[14], "ZP:");
             int2hex(&line2[17], last_address_zp, 2);
 
+#ifdef FEATURE_BUS_TIMING
+            // bus timing profile (A: automatic, T: fixed), bus frequency and anomalies
+            line2[20] = 0x80|((bus_timing_profile == ABUS_TIMING_AUTO) ? 'A' : 'T');
+            line2[21] = 0x80|('0'+bus_timing_active);
+            uint32_t khz = bus_clock_khz;
+            for (uint i=0;i<4;i++)
+            {
+                line2[26-i] = 0x80|('0'+(khz % 10));
+                khz /= 10;
+            }
+            line2[27] = 0x80|'K';
+            line2[29] = 0x80|'E';
+            int2hex(&line2[30], (bus_anomaly_counter > 0xff) ? 0xff : bus_anomaly_counter, 2);
+#endif
+
             if (IS_IFLAG(IFLAGS_TEST))
             {
                 copy_str(&line2[33], "OV:");
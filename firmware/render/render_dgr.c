@@ -29,8 +29,6 @@ SOFTWARE.
 #include "config/config.h"
 #include "render.h"
 
-#define PAGE2SEL ((soft_switches & (SOFTSW_80STORE | SOFTSW_PAGE_2)) == SOFTSW_PAGE_2)
-
 uint8_t DELAYED_COPY_DATA(dgr_dot_pattern)[32] = {
     0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
     0x08, 0x19, 0x2A, 0x3B, 0x4C, 0x5D, 0x6E, 0x7F,
@@ -38,10 +36,9 @@ uint8_t DELAYED_COPY_DATA(dgr_dot_pattern)[32] = {
     0x22, 0x66, 0x2A, 0x6E, 0x33, 0x77, 0x3B, 0x7F,
 };
 
-static void render_dgr_line(bool p2, uint line);
-
-static void DELAYED_COPY_CODE(render_dgr_line)(bool p2, uint line)
+static __force_inline void render_dgr_line_mono(bool p2, uint line, uint cmode)
 {
+    const uint32_t* tmds_pair = &tmds_mono_pixel_pair[cmode*12];
     // Construct two scanlines for the two different colored cells at the same time
     dvi_get_scanline(tmdsbuf1);
     dvi_scanline_rgb(tmdsbuf1, tmdsbuf1_red, tmdsbuf1_green, tmdsbuf1_blue);
@@ -49,8 +46,8 @@ static void DELAYED_COPY_CODE(render_dgr_line)(bool p2, uint line)
     dvi_get_scanline(tmdsbuf2);
     dvi_scanline_rgb(tmdsbuf2, tmdsbuf2_red, tmdsbuf2_green, tmdsbuf2_blue);
 
-    const uint8_t *line_bufa = (const uint8_t *)((p2 ? text_p2 : text_p1) + ((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40));
-    const uint8_t *line_bufb = (const uint8_t *)((p2 ? text_p4 : text_p3) + ((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40));
+    const uint8_t *line_bufa = (const uint8_t *)(render_text_pages[p2] + ((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40));
+    const uint8_t *line_bufb = (const uint8_t *)(render_text_pages[2+p2] + ((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40));
 
     uint i = 0;
     uint_fast8_t dotc = 0;
@@ -60,7 +57,6 @@ static void DELAYED_COPY_CODE(render_dgr_line)(bool p2, uint line)
 #endif
     {
         uint32_t pattern1=0, pattern2=0;
-        uint8_t color_offset = color_mode*12;
 
         while(i < 40)
         {
@@ -78,15 +74,15 @@ static void DELAYED_COPY_CODE(render_dgr_line)(bool p2, uint line)
             // Consume pixels
             while(dotc >= 2)
             {
-                uint32_t offset = color_offset + (pattern1 & 3);
-                *(tmdsbuf1_red++)   = tmds_mono_pixel_pair[offset+0];
-                *(tmdsbuf1_green++) = tmds_mono_pixel_pair[offset+4];
-                *(tmdsbuf1_blue++)  = tmds_mono_pixel_pair[offset+8];
-
-                offset = color_offset + (pattern2 & 3);
-                *(tmdsbuf2_red++)   = tmds_mono_pixel_pair[offset+0];
-                *(tmdsbuf2_green++) = tmds_mono_pixel_pair[offset+4];
-                *(tmdsbuf2_blue++)  = tmds_mono_pixel_pair[offset+8];
+                const uint32_t* pTmds = &tmds_pair[pattern1 & 3];
+                *(tmdsbuf1_red++)   = pTmds[0];
+                *(tmdsbuf1_green++) = pTmds[4];
+                *(tmdsbuf1_blue++)  = pTmds[8];
+
+                pTmds = &tmds_pair[pattern2 & 3];
+                *(tmdsbuf2_red++)   = pTmds[0];
+                *(tmdsbuf2_green++) = pTmds[4];
+                *(tmdsbuf2_blue++)  = pTmds[8];
                 pattern1 >>= 2;
                 pattern2 >>= 2;
                 dotc -= 2;
@@ -177,18 +173,12 @@ static void DELAYED_COPY_CODE(render_dgr_line)(bool p2, uint line)
     dvi_send_scanline(tmdsbuf2);
 }
 
-void DELAYED_COPY_CODE(render_dgr)()
-{
-    for(uint line=0; line < 24; line++) {
-        render_dgr_line(PAGE2SEL, line);
-    }
-}
+RENDER_MONO_KERNELS(render_dgr_line_mono)
 
-void DELAYED_COPY_CODE(render_mixed_dgr)()
+// DGR is currently always rendered in monochrome, using the selected monochrome color
+render_line_kernel_t DELAYED_COPY_DATA(dgr_line_kernels)[3] =
 {
-    for(uint line=0; line < 20; line++) {
-        render_dgr_line(PAGE2SEL, line);
-    }
-
-    render_mixed_text();
-}
+    render_dgr_line_mono_white,
+    render_dgr_line_mono_green,
+    render_dgr_line_mono_amber
+};
@@ -38,102 +38,122 @@ uint8_t DELAYED_COPY_DATA(tmds_dhgr_lores_mapping)[16] =
     9*3 /*9:HVIOLET*/, 11*3 /*11:LBLUE*/, 13*3 /*13:PINK*/,    15*3 /*15:WHITE*/
 };
 
-#define PAGE2SEL ((soft_switches & (SOFTSW_80STORE | SOFTSW_PAGE_2)) == SOFTSW_PAGE_2)
-
 
 static inline uint dhgr_line_to_mem_offset(uint line)
 {
     return ((line & 0x07) << 10) | ((line & 0x38) << 4) | (((line & 0xc0) >> 6) * 40);
 }
 
-static void DELAYED_COPY_CODE(render_dhgr_line)(bool p2, uint line, bool mono)
+static __force_inline void render_dhgr_line_mono(bool p2, uint line, uint cmode)
 {
      // Construct scanline
     dvi_get_scanline(tmdsbuf);
-    dvi_scanline_rgb(tmdsbuf, tmdsbuf_red, tmdsbuf_green, tmdsbuf_blue);
 
-    const uint8_t *line_mema = (const uint8_t *)((p2 ? hgr_p2 : hgr_p1) + dhgr_line_to_mem_offset(line));
-    const uint8_t *line_memb = (const uint8_t *)((p2 ? hgr_p4 : hgr_p3) + dhgr_line_to_mem_offset(line));
+#ifdef FEATURE_VIDEO_PLANES
+    // the bus core already merged the aux/main dots
+    render_mono_plane_line(&dhgr_plane[p2][line*VIDEO_PLANE_WORDS], tmdsbuf, cmode);
+#else
+    const uint8_t *line_mema = (const uint8_t *)(render_hgr_pages[p2] + dhgr_line_to_mem_offset(line));
+    const uint8_t *line_memb = (const uint8_t *)(render_hgr_pages[2+p2] + dhgr_line_to_mem_offset(line));
+
+#ifdef FEATURE_ASM_KERNELS
+    render_dhgr_mono_asm(line_mema, line_memb, tmdsbuf+DVI_APPLE2_XOFS, &tmds_mono_nibbles[cmode*16*8]);
+#else
+    const uint32_t* tmds_pair = &tmds_mono_pixel_pair[cmode*12];
+    dvi_scanline_rgb(tmdsbuf, tmdsbuf_red, tmdsbuf_green, tmdsbuf_blue);
 
     // DHGR is weird. Video-7 just makes it weirder. Nuff said.
     uint32_t dots = 0;
     uint_fast8_t dotc = 0;
     uint i = 0;
 
-    if(mono)
+    while(i < 40)
     {
-        uint8_t color_offset = color_mode*12;
-        while(i < 40)
+        // Load in as many subpixels as possible
+        while((dotc < 28) && (i < 40))
         {
-            // Load in as many subpixels as possible
-            while((dotc < 28) && (i < 40))
-            {
-                dots |= (line_memb[i] & 0x7f) << dotc;
-                dotc += 7;
-                dots |= (line_mema[i] & 0x7f) << dotc;
-                dotc += 7;
-                i++;
-            }
+            dots |= (line_memb[i] & 0x7f) << dotc;
+            dotc += 7;
+            dots |= (line_mema[i] & 0x7f) << dotc;
+            dotc += 7;
+            i++;
+        }
 
-            // Consume pixels
-            while(dotc)
-            {
-                uint32_t offset = color_offset + (dots & 0x3);
-                *(tmdsbuf_red++)   = tmds_mono_pixel_pair[offset+0];
-                *(tmdsbuf_green++) = tmds_mono_pixel_pair[offset+4];
-                *(tmdsbuf_blue++)  = tmds_mono_pixel_pair[offset+8];
-                dots >>= 2;
+        // Consume pixels
+        while(dotc)
+        {
+            const uint32_t* pTmds = &tmds_pair[dots & 0x3];
+            *(tmdsbuf_red++)   = pTmds[0];
+            *(tmdsbuf_green++) = pTmds[4];
+            *(tmdsbuf_blue++)  = pTmds[8];
+            dots >>= 2;
 
-                dotc -= 2;
-            }
+            dotc -= 2;
         }
     }
-#if 0
-    else
-    if((internal_flags & IFLAGS_VIDEO7) && ((soft_switches & (SOFTSW_80STORE | SOFTSW_80COL)) == (SOFTSW_80STORE)))
-    {
-        int j;
+#endif
+#endif // FEATURE_VIDEO_PLANES
 
-        // Video 7 F/B HiRes
-        while(i < 40)
-        {
-            dots = (line_mema[i] & 0x7f);
-            color1 = lores_palette[(line_memb[i] >> 4) & 0xF];
-            color2 = lores_palette[(line_memb[i] >> 0) & 0xF];
-            i++;
+    // send buffer
+    dvi_send_scanline(tmdsbuf);
+}
 
-            dots |= (line_mema[i] & 0x7f) << 7;
-            color3 = lores_palette[(line_memb[i] >> 4) & 0xF];
-            color4 = lores_palette[(line_memb[i] >> 0) & 0xF];
-            i++;
+RENDER_MONO_KERNELS(render_dhgr_line_mono)
 
-            for(j = 0; j < 3; j++)
-            {
-                pixeldata = ((dots & 1) ? (color1) : (color2)) | THEN_EXTEND_1;
-                dots >>= 1;
-                pixeldata |= (((dots & 1) ? (color1) : (color2)) | THEN_EXTEND_1) << 16;
-                dots >>= 1;
-                sl->data[sl_pos++] = pixeldata;
-            }
+#ifdef FEATURE_VIDEO_PLANES
+static void DELAYED_COPY_CODE(render_dhgr_line_color)(bool p2, uint line)
+{
+     // Construct scanline
+    dvi_get_scanline(tmdsbuf);
+    dvi_scanline_rgb(tmdsbuf, tmdsbuf_red, tmdsbuf_green, tmdsbuf_blue);
 
-            pixeldata = ((dots & 1) ? (color1) : (color2)) | THEN_EXTEND_1;
-            dots >>= 1;
-            pixeldata |= (((dots & 1) ? (color3) : (color4)) | THEN_EXTEND_1) << 16;
-            dots >>= 1;
-            sl->data[sl_pos++] = pixeldata;
+    // the bus core already merged the aux/main dots: 7 colors per word
+    const uint32_t* plane_line = &dhgr_plane[p2][line*VIDEO_PLANE_WORDS];
 
-            for(j = 0; j < 3; j++)
-            {
-                pixeldata = ((dots & 1) ? (color3) : (color4)) | THEN_EXTEND_1;
-                dots >>= 1;
-                pixeldata |= (((dots & 1) ? (color3) : (color4)) | THEN_EXTEND_1) << 16;
-                dots >>= 1;
-                sl->data[sl_pos++] = pixeldata;
-            }
+    for (uint i=0;i<VIDEO_PLANE_WORDS;i++)
+    {
+        uint32_t dots = plane_line[i];
+        for (uint j=0;j<7;j++)
+        {
+            // map HGR dot values to 16 color (RGB LORES) palette
+            const uint32_t* pTmds = &tmds_lorescolor[tmds_dhgr_lores_mapping[dots&0xf]];
+            uint32_t r = pTmds[0];
+            uint32_t g = pTmds[1];
+            uint32_t b = pTmds[2];
+
+            // add 4 pixels (two double pixels)
+            *(tmdsbuf_red++)   = r;
+            *(tmdsbuf_red++)   = r;
+
+            *(tmdsbuf_green++) = g;
+            *(tmdsbuf_green++) = g;
+
+            *(tmdsbuf_blue++)  = b;
+            *(tmdsbuf_blue++)  = b;
+            dots >>= 4;
         }
     }
-    else
-    if((internal_flags & IFLAGS_VIDEO7) && ((internal_flags & IFLAGS_V7_MODE3) == IFLAGS_V7_MODE2))
+
+    // send buffer
+    dvi_send_scanline(tmdsbuf);
+}
+#else
+static void DELAYED_COPY_CODE(render_dhgr_line_color)(bool p2, uint line)
+{
+     // Construct scanline
+    dvi_get_scanline(tmdsbuf);
+    dvi_scanline_rgb(tmdsbuf, tmdsbuf_red, tmdsbuf_green, tmdsbuf_blue);
+
+    const uint8_t *line_mema = (const uint8_t *)(render_hgr_pages[p2] + dhgr_line_to_mem_offset(line));
+    const uint8_t *line_memb = (const uint8_t *)(render_hgr_pages[2+p2] + dhgr_line_to_mem_offset(line));
+
+    // DHGR is weird. Video-7 just makes it weirder. Nuff said.
+    uint32_t dots = 0;
+    uint_fast8_t dotc = 0;
+    uint i = 0;
+
+#if 0
+    if((render_frame_flags & IFLAGS_VIDEO7) && ((render_frame_flags & IFLAGS_V7_MODE3) == IFLAGS_V7_MODE2))
     {
         // 160x192 Video-7
         while(i < 40)
@@ -161,7 +181,7 @@ static void DELAYED_COPY_CODE(render_dhgr_line)(bool p2, uint line, bool mono)
         }
     }
     else
-    if((internal_flags & (IFLAGS_VIDEO7 | IFLAGS_V7_MODE3)) == (IFLAGS_VIDEO7 | IFLAGS_V7_MODE1))
+    if((render_frame_flags & (IFLAGS_VIDEO7 | IFLAGS_V7_MODE3)) == (IFLAGS_VIDEO7 | IFLAGS_V7_MODE1))
     {
         // Video-7 Mixed B&W/RGB
         while(i < 40)
@@ -287,8 +307,8 @@ static void DELAYED_COPY_CODE(render_dhgr_line)(bool p2, uint line, bool mono)
             }
         }
     }
-#endif
     else
+#endif
     {
         while(i < 40)
         {
@@ -348,27 +368,53 @@ static void DELAYED_COPY_CODE(render_dhgr_line)(bool p2, uint line, bool mono)
     // send buffer
     dvi_send_scanline(tmdsbuf);
 }
+#endif // FEATURE_VIDEO_PLANES
 
-void DELAYED_COPY_CODE(render_dhgr)()
+// Video-7 foreground/background HIRES: 280 dots per line, each byte of the main memory
+// provides 7 dots, the matching byte of the aux memory their colors (foreground in the
+// upper, background in the lower nibble). Decoded to color indexes, since the colors
+// change per byte.
+void DELAYED_COPY_CODE(render_dhgr_v7fb_line)(bool p2, uint line)
 {
-    bool mono = mono_rendering;
-    if((internal_flags & IFLAGS_VIDEO7) && ((internal_flags & IFLAGS_V7_MODE3) == IFLAGS_V7_MODE0)) {
-        mono = true;
-    }
-    for(uint line=0; line < 192; line++) {
-        render_dhgr_line(PAGE2SEL, line, mono);
-    }
-}
+     // Construct scanline
+    dvi_get_scanline(tmdsbuf);
 
-void DELAYED_COPY_CODE(render_mixed_dhgr)()
-{
-    bool mono = mono_rendering;
-    if((internal_flags & IFLAGS_VIDEO7) && ((internal_flags & IFLAGS_V7_MODE3) == IFLAGS_V7_MODE0)) {
-        mono = true;
-    }
-    for(uint line=0; line < 160; line++) {
-        render_dhgr_line(PAGE2SEL, line, mono);
+    const uint8_t *line_mema = (const uint8_t *)(render_hgr_pages[p2] + dhgr_line_to_mem_offset(line));
+    const uint8_t *line_memb = (const uint8_t *)(render_hgr_pages[2+p2] + dhgr_line_to_mem_offset(line));
+
+    uint32_t* indexes = render_line_indexes;
+    uint32_t pixels = 0;
+    uint_fast8_t pixelc = 0;
+
+    for (uint i=0;i<40;i++)
+    {
+        uint32_t dots       = line_mema[i];
+        const uint32_t bg   = line_memb[i] & 0xf;
+        const uint32_t diff = (line_memb[i] >> 4) ^ bg;
+
+        for (uint j=0;j<7;j++)
+        {
+            // shift in from the top, so the first pixel ends up in the lowest nibble
+            pixels = (pixels >> 4) | ((bg ^ (diff & -(dots & 1))) << 28);
+            dots >>= 1;
+            if (++pixelc == 8)
+            {
+                *(indexes++) = pixels;
+                pixelc = 0;
+            }
+        }
     }
 
-    render_mixed_text();
+    render_expand_indexed(render_line_indexes, tmdsbuf, tmds_lorescolor);
+
+    // send buffer
+    dvi_send_scanline(tmdsbuf);
 }
+
+render_line_kernel_t DELAYED_COPY_DATA(dhgr_line_kernels)[RENDER_KERNEL_VARIANTS] =
+{
+    render_dhgr_line_color,
+    render_dhgr_line_mono_white,
+    render_dhgr_line_mono_green,
+    render_dhgr_line_mono_amber
+};
@@ -0,0 +1,302 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "applebus/buffers.h"
+#include "config/config.h"
+#include "applebus/switch_events.h"
+
+#include "render.h"
+
+#define PAGE2SEL(switches) (((switches) & (SOFTSW_80STORE | SOFTSW_PAGE_2)) == SOFTSW_PAGE_2)
+
+// first graphics line showing text in mixed mode
+#define MIXED_TEXT_LINE 160
+
+render_display_list_t DELAYED_COPY_DATA(display_list);
+
+static inline render_op_t* render_add_op(render_display_list_t* dl, uint8_t op, uint first, uint count, int8_t page2)
+{
+    render_op_t* pOp = &dl->ops[dl->count++];
+    pOp->op          = op;
+    pOp->first       = first;
+    pOp->count       = count;
+    pOp->kernel.line = NULL;
+    pOp->page_a      = NULL;
+    pOp->page_b      = NULL;
+    pOp->page2       = page2;
+    return pOp;
+}
+
+static void DELAYED_COPY_CODE(render_compile_text)(render_display_list_t* dl, uint32_t switches, uint first_row, uint end_row, uint8_t cmode)
+{
+    if((render_frame_flags & IFLAGS_VIDEO7) && ((switches & (SOFTSW_80STORE | SOFTSW_80COL | SOFTSW_DGR)) == (SOFTSW_80STORE | SOFTSW_DGR)))
+    {
+        render_add_op(dl, RENDER_OP_COLOR_TEXT40, first_row, end_row-first_row, RENDER_PAGE_LIVE);
+        return;
+    }
+
+    const bool page2 = PAGE2SEL(switches);
+    render_op_t* pOp;
+    if(switches & SOFTSW_80COL)
+    {
+        // 80 column mode rendering
+        pOp = render_add_op(dl, RENDER_OP_TEXT80, first_row, end_row-first_row, RENDER_PAGE_LIVE);
+        pOp->kernel.text80 = text80_line_kernels[cmode];
+        pOp->page_b = (const uint8_t *)render_text_pages[2+page2];
+    }
+    else
+    {
+        // 40 column mode rendering
+        pOp = render_add_op(dl, RENDER_OP_TEXT40, first_row, end_row-first_row, RENDER_PAGE_LIVE);
+        pOp->kernel.text40 = text40_line_kernels[cmode];
+    }
+    pOp->page_a = (const uint8_t *)render_text_pages[page2];
+}
+
+static render_line_kernel_t DELAYED_COPY_CODE(render_dhgr_kernel)(uint32_t switches)
+{
+    // Video7 mode 0 forces monochrome rendering
+    if((render_frame_flags & IFLAGS_VIDEO7) && ((render_frame_flags & IFLAGS_V7_MODE3) == IFLAGS_V7_MODE0)) {
+        return render_dhgr_mono_line;
+    }
+    // Video-7 foreground/background HIRES (80STORE on, 80COL off)
+    if((!mono_rendering) && (render_frame_flags & IFLAGS_VIDEO7) && ((switches & (SOFTSW_80STORE | SOFTSW_80COL)) == SOFTSW_80STORE)) {
+        return render_dhgr_v7fb_line;
+    }
+    return render_dhgr_line;
+}
+
+// Compile the ops for the display lines [first, end) in the video mode given by 'switches'. Text and
+// LORES are rendered in rows of 8 lines, so 'first' and 'end' must be row aligned where they apply.
+static void DELAYED_COPY_CODE(render_compile_range)(render_display_list_t* dl, uint32_t switches, uint first, uint end, int8_t page2)
+{
+    // the lower 4 text rows in mixed mode are always white, unless monochrome rendering is active
+    const uint8_t mixed_cmode = (mono_rendering) ? color_mode : 0;
+    // end of the graphics part in mixed mode
+    const uint split = (first > MIXED_TEXT_LINE) ? first : ((end < MIXED_TEXT_LINE) ? end : MIXED_TEXT_LINE);
+
+    switch(switches & SOFTSW_MODE_MASK)
+    {
+        case 0:
+            if(switches & SOFTSW_DGR)
+            {
+                render_add_op(dl, RENDER_OP_DGR, first/8, (end-first)/8, page2)->kernel.line = render_dgr_line;
+            }
+            else
+            {
+                render_add_op(dl, RENDER_OP_LORES, first/8, (end-first)/8, page2)->kernel.line = render_lores_line;
+            }
+            break;
+        case SOFTSW_MIX_MODE:
+            if (split > first)
+            {
+                if((switches & (SOFTSW_80COL | SOFTSW_DGR)) == (SOFTSW_80COL | SOFTSW_DGR))
+                {
+                    render_add_op(dl, RENDER_OP_DGR, first/8, (split-first)/8, page2)->kernel.line = render_dgr_line;
+                }
+                else
+                {
+                    render_add_op(dl, RENDER_OP_LORES, first/8, (split-first)/8, page2)->kernel.line = render_lores_line;
+                }
+            }
+            if (end > split)
+                render_compile_text(dl, switches, split/8, end/8, mixed_cmode);
+            break;
+        case SOFTSW_HIRES_MODE:
+            if(switches & SOFTSW_DGR)
+            {
+                render_add_op(dl, RENDER_OP_DHGR, first, end-first, page2)->kernel.line = render_dhgr_kernel(switches);
+            }
+            else
+            {
+                render_add_op(dl, RENDER_OP_HIRES, first, end-first, page2)->kernel.line = render_hires_line;
+            }
+            break;
+        case SOFTSW_HIRES_MODE|SOFTSW_MIX_MODE:
+            if (split > first)
+            {
+                if((switches & (SOFTSW_80COL | SOFTSW_DGR)) == (SOFTSW_80COL | SOFTSW_DGR))
+                {
+                    render_add_op(dl, RENDER_OP_DHGR, first, split-first, page2)->kernel.line = render_dhgr_kernel(switches);
+                }
+                else
+                {
+                    render_add_op(dl, RENDER_OP_HIRES, first, split-first, page2)->kernel.line = render_hires_line;
+                }
+            }
+            if (end > split)
+                render_compile_text(dl, switches, split/8, end/8, mixed_cmode);
+            break;
+        default:
+            render_compile_text(dl, switches, first/8, end/8, color_mode);
+            break;
+    }
+}
+
+#ifdef FEATURE_MIDFRAME_SPLITS
+// true when the given display line is rendered line by line (HIRES graphics) rather than in rows
+static inline bool render_is_line_mode(uint32_t switches, uint line)
+{
+    if ((switches & (SOFTSW_TEXT_MODE | SOFTSW_HIRES_MODE)) != SOFTSW_HIRES_MODE)
+        return false;
+    return ((switches & SOFTSW_MIX_MODE) == 0) || (line < MIXED_TEXT_LINE);
+}
+
+// Compile a frame whose video mode changed at the given scanlines. Splits next to text or LORES
+// rows are moved to the nearest row boundary.
+static void DELAYED_COPY_CODE(render_compile_splits)(render_display_list_t* dl, const switch_split_t* pSplits, uint count)
+{
+    uint32_t switches = pSplits[0].old_switches;
+    uint first = 0;
+    for (uint i=0;i<=count;i++)
+    {
+        uint end = APPLE_VISIBLE_LINES;
+        if (i < count)
+        {
+            end = pSplits[i].line;
+            if ((end > 0) && !(render_is_line_mode(switches, end-1) && render_is_line_mode(pSplits[i].new_switches, end)))
+            {
+                // Text and LORES kernels only render whole rows of 8 lines: round to the nearest row
+                // boundary, so at most 4 lines show the mode of the neighbouring part (a split in the
+                // middle of a row, at its line 4, moves to the row's end). Without rounding, a split
+                // inside a text row would have to drop or repeat part of that row.
+                end = (end+4) & ~7;
+            }
+            if (end < first)
+                end = first;
+        }
+        if (end > first)
+        {
+            render_compile_range(dl, switches, first, end, PAGE2SEL(switches));
+            first = end;
+        }
+        if (i < count)
+            switches = pSplits[i].new_switches;
+    }
+}
+#endif
+
+void DELAYED_COPY_CODE(render_compile_frame)(render_display_list_t* dl)
+{
+    dl->count     = 0;
+    dl->text_mode = false;
+
+#ifndef FEATURE_FRAME_SNAPSHOT
+    // otherwise sampled consistently by render_snapshot_frame()
+    render_frame_switches = soft_switches;
+    render_frame_flags    = internal_flags;
+#endif
+
+#ifdef FEATURE_MIDFRAME_SPLITS
+    // every video mode may need two ops
+    switch_split_t splits[RENDER_MAX_OPS/2-1];
+    const uint count = switch_events_frame(splits, RENDER_MAX_OPS/2-1);
+    if (count)
+    {
+        render_compile_splits(dl, splits, count);
+    }
+    else
+#endif
+    {
+        const uint32_t switches = render_frame_switches;
+#ifdef FEATURE_FRAME_SNAPSHOT
+        // only the page displayed at frame start was copied: no page flips within the frame
+        render_compile_range(dl, switches, 0, APPLE_VISIBLE_LINES, PAGE2SEL(switches));
+#else
+        render_compile_range(dl, switches, 0, APPLE_VISIBLE_LINES, RENDER_PAGE_LIVE);
+#endif
+    }
+
+    // text shown in any part of the frame (also with splits)
+    for (uint i=0;i<dl->count;i++)
+    {
+        const uint8_t op = dl->ops[i].op;
+        if ((op == RENDER_OP_TEXT40)||(op == RENDER_OP_TEXT80)||(op == RENDER_OP_COLOR_TEXT40))
+            dl->text_mode = true;
+    }
+
+#ifdef FEATURE_OSD
+    render_osd_clip(dl);
+#endif
+}
+
+void DELAYED_COPY_CODE(render_execute_frame)(const render_display_list_t* dl)
+{
+#ifdef FEATURE_ROW_CACHE
+    const bool cached = render_cache_begin_frame(dl);
+#endif
+    for (uint i=0;i<dl->count;i++)
+    {
+        const render_op_t* pOp = &dl->ops[i];
+#ifdef FEATURE_ROW_CACHE
+        if (cached)
+        {
+            render_cache_execute_op(pOp);
+            continue;
+        }
+#endif
+        const uint end = pOp->first + pOp->count;
+        switch(pOp->op)
+        {
+            case RENDER_OP_TEXT40:
+            {
+                const render_text40_kernel_t kernel = pOp->kernel.text40;
+                for (uint row=pOp->first;row<end;row++)
+                {
+                    kernel(pOp->page_a, row);
+                }
+                break;
+            }
+            case RENDER_OP_TEXT80:
+            {
+                const render_text80_kernel_t kernel = pOp->kernel.text80;
+                for (uint row=pOp->first;row<end;row++)
+                {
+                    kernel(pOp->page_a, pOp->page_b, row);
+                }
+                break;
+            }
+            case RENDER_OP_COLOR_TEXT40:
+                for (uint row=pOp->first;row<end;row++)
+                {
+                    render_color_text40_line(row);
+                }
+                break;
+            default:
+            {
+                // graphics modes: page 2 is still selected per line, so page flips take effect mid-frame
+                const render_line_kernel_t kernel = pOp->kernel.line;
+                for (uint line=pOp->first;line<end;line++)
+                {
+                    kernel((pOp->page2 == RENDER_PAGE_LIVE) ? PAGE2SEL(soft_switches) : pOp->page2, line);
+                }
+                break;
+            }
+        }
+    }
+#ifdef FEATURE_OSD
+    // the lines the display list was clipped for
+    render_osd_band();
+#endif
+}
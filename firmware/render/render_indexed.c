@@ -0,0 +1,69 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <pico/stdlib.h>
+#include "config/config.h"
+#include "render.h"
+
+// Scratch buffer for one line of color indexes, shared by all indexed-color kernels
+// (which only run on the render core).
+uint32_t DELAYED_COPY_DATA(render_line_indexes)[RENDER_INDEX_WORDS];
+
+// Expand a line of 280 packed 4-bit color indexes (8 double pixels per word, first
+// pixel in the lowest nibble) into TMDS data. 'palette' holds 16 RGB TMDS triples,
+// in the same layout as tmds_lorescolor.
+void DELAYED_COPY_CODE(render_expand_indexed)(const uint32_t* indexes, uint32_t* tmdsbuf, const uint32_t* palette)
+{
+    dvi_scanline_rgb(tmdsbuf, tmdsbuf_red, tmdsbuf_green, tmdsbuf_blue);
+
+    for (uint w=0;w<RENDER_INDEX_WORDS;w++)
+    {
+        uint32_t pixels = indexes[w];
+        const uint32_t* pTmds = &palette[(pixels & 0xf)*3];
+
+        if (pixels == (pixels & 0xf) * 0x11111111)
+        {
+            // 8 double pixels of the same color (common for backgrounds): single lookup
+            const uint32_t r = pTmds[0];
+            const uint32_t g = pTmds[1];
+            const uint32_t b = pTmds[2];
+            for (uint i=0;i<8;i++)
+            {
+                *(tmdsbuf_red++)   = r;
+                *(tmdsbuf_green++) = g;
+                *(tmdsbuf_blue++)  = b;
+            }
+            continue;
+        }
+
+        for (uint i=0;i<8;i++)
+        {
+            pTmds = &palette[(pixels & 0xf)*3];
+            *(tmdsbuf_red++)   = pTmds[0];
+            *(tmdsbuf_green++) = pTmds[1];
+            *(tmdsbuf_blue++)  = pTmds[2];
+            pixels >>= 4;
+        }
+    }
+}
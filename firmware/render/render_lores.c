@@ -50,32 +50,35 @@ uint16_t DELAYED_COPY_DATA(lores_dot_pattern)[16] =
     0x3fff
 };
 
-static void render_lores_line(bool p2, uint line);
-
-#define PAGE2SEL ((soft_switches & (SOFTSW_80STORE | SOFTSW_PAGE_2)) == SOFTSW_PAGE_2)
-
-void DELAYED_COPY_CODE(render_lores)()
+static __force_inline void render_lores_send(uint32_t* tmdsbuf1, uint32_t* tmdsbuf2)
 {
-    for(uint line=0; line < 24; line++)
+    // repeat this line 3 more times (4x in total)
+    for (uint yrepeat=0;yrepeat<3;yrepeat++)
     {
-        render_lores_line(PAGE2SEL, line);
+        dvi_get_scanline(tmdsbufRepeat);
+        dvi_copy_scanline(tmdsbufRepeat, tmdsbuf1);
+        // send copied buffer
+        dvi_send_scanline(tmdsbufRepeat);
     }
-}
-
+    // send original buffer
+    dvi_send_scanline(tmdsbuf1);
 
-void DELAYED_COPY_CODE(render_mixed_lores)()
-{
-    for(uint line=0; line < 20; line++)
+    // repeat this line 3 more times (4x in total)
+    for (uint yrepeat=0;yrepeat<3;yrepeat++)
     {
-        render_lores_line(PAGE2SEL, line);
+        dvi_get_scanline(tmdsbufRepeat);
+        dvi_copy_scanline(tmdsbufRepeat, tmdsbuf2);
+        // send copied buffer
+        dvi_send_scanline(tmdsbufRepeat);
     }
 
-    render_mixed_text();
+    // send original buffer
+    dvi_send_scanline(tmdsbuf2);
 }
 
-
-static void DELAYED_COPY_CODE(render_lores_line)(bool p2, uint line)
+static __force_inline void render_lores_line_mono(bool p2, uint line, uint cmode)
 {
+    const uint32_t* tmds_pair = &tmds_mono_pixel_pair[cmode*12];
     // Construct two scanlines for the two different colored cells at the same time
     dvi_get_scanline(tmdsbuf1);
     dvi_scanline_rgb(tmdsbuf1, tmdsbuf1_red, tmdsbuf1_green, tmdsbuf1_blue);
@@ -83,87 +86,84 @@ static void DELAYED_COPY_CODE(render_lores_line)(bool p2, uint line)
     dvi_get_scanline(tmdsbuf2);
     dvi_scanline_rgb(tmdsbuf2, tmdsbuf2_red, tmdsbuf2_green, tmdsbuf2_blue);
 
-    const uint8_t *line_buf = (const uint8_t *)((p2 ? text_p2 : text_p1) + ((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40));
+    const uint8_t *line_buf = (const uint8_t *)(render_text_pages[p2] + ((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40));
 
-    if(mono_rendering)
+    for(uint i = 0; i < 40; i+=2)
     {
-        uint8_t color_offset = color_mode*12;
-        for(uint i = 0; i < 40; i+=2)
+        uint32_t pattern1  = lores_dot_pattern[line_buf[i] & 0xf];
+        pattern1 |= lores_dot_pattern[line_buf[i+1] & 0xf] << 14;
+
+        uint32_t pattern2  = lores_dot_pattern[(line_buf[i] >> 4) & 0xf];
+        pattern2 |= lores_dot_pattern[(line_buf[i+1] >> 4) & 0xf] << 14;
+
+        for(uint j = 0; j < 14; j++)
         {
-            uint32_t pattern1  = lores_dot_pattern[line_buf[i] & 0xf];
-            pattern1 |= lores_dot_pattern[line_buf[i+1] & 0xf] << 14;
-
-            uint32_t pattern2  = lores_dot_pattern[(line_buf[i] >> 4) & 0xf];
-            pattern2 |= lores_dot_pattern[(line_buf[i+1] >> 4) & 0xf] << 14;
-
-            for(uint j = 0; j < 14; j++)
-            {
-                uint32_t offset = color_offset + (pattern1 & 0x3);
-                *(tmdsbuf1_red++)   = tmds_mono_pixel_pair[offset+0];
-                *(tmdsbuf1_green++) = tmds_mono_pixel_pair[offset+4];
-                *(tmdsbuf1_blue++)  = tmds_mono_pixel_pair[offset+8];
-                pattern1 >>= 2;
-
-                offset = color_offset + (pattern2 & 0x3);
-                *(tmdsbuf2_red++)   = tmds_mono_pixel_pair[offset+0];
-                *(tmdsbuf2_green++) = tmds_mono_pixel_pair[offset+4];
-                *(tmdsbuf2_blue++)  = tmds_mono_pixel_pair[offset+8];
-                pattern2 >>= 2;
-            }
+            const uint32_t* pTmds = &tmds_pair[pattern1 & 0x3];
+            *(tmdsbuf1_red++)   = pTmds[0];
+            *(tmdsbuf1_green++) = pTmds[4];
+            *(tmdsbuf1_blue++)  = pTmds[8];
+            pattern1 >>= 2;
+
+            pTmds = &tmds_pair[pattern2 & 0x3];
+            *(tmdsbuf2_red++)   = pTmds[0];
+            *(tmdsbuf2_green++) = pTmds[4];
+            *(tmdsbuf2_blue++)  = pTmds[8];
+            pattern2 >>= 2;
         }
     }
-    else
+
+    render_lores_send(tmdsbuf1, tmdsbuf2);
+}
+
+RENDER_MONO_KERNELS(render_lores_line_mono)
+
+static void DELAYED_COPY_CODE(render_lores_line_color)(bool p2, uint line)
+{
+    // Construct two scanlines for the two different colored cells at the same time
+    dvi_get_scanline(tmdsbuf1);
+    dvi_scanline_rgb(tmdsbuf1, tmdsbuf1_red, tmdsbuf1_green, tmdsbuf1_blue);
+
+    dvi_get_scanline(tmdsbuf2);
+    dvi_scanline_rgb(tmdsbuf2, tmdsbuf2_red, tmdsbuf2_green, tmdsbuf2_blue);
+
+    const uint8_t *line_buf = (const uint8_t *)(render_text_pages[p2] + ((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40));
+
+    for(uint i = 0; i < 40; i++)
     {
-        for(uint i = 0; i < 40; i++)
+        uint32_t color1 = line_buf[i] & 0xf;
+        uint32_t color2 = (line_buf[i] >> 4) & 0xf;
+
+        // Each lores pixel is 7 hires pixels, or 14 VGA pixels wide
+        uint32_t* pTmds = &tmds_lorescolor[color1*3];
+        uint32_t r = pTmds[0];
+        uint32_t g = pTmds[1];
+        uint32_t b = pTmds[2];
+        for (uint j = 0; j < 7; j++)
         {
-            uint32_t color1 = line_buf[i] & 0xf;
-            uint32_t color2 = (line_buf[i] >> 4) & 0xf;
-
-            // Each lores pixel is 7 hires pixels, or 14 VGA pixels wide
-            uint32_t* pTmds = &tmds_lorescolor[color1*3];
-            uint32_t r = pTmds[0];
-            uint32_t g = pTmds[1];
-            uint32_t b = pTmds[2];
-            for (uint j = 0; j < 7; j++)
-            {
-                *(tmdsbuf1_red++)   = r;
-                *(tmdsbuf1_green++) = g;
-                *(tmdsbuf1_blue++)  = b;
-            }
-
-            pTmds = &tmds_lorescolor[color2*3];
-            r = pTmds[0];
-            g = pTmds[1];
-            b = pTmds[2];
-            for (uint j = 0; j < 7; j++)
-            {
-                *(tmdsbuf2_red++)   = r;
-                *(tmdsbuf2_green++) = g;
-                *(tmdsbuf2_blue++)  = b;
-            }
+            *(tmdsbuf1_red++)   = r;
+            *(tmdsbuf1_green++) = g;
+            *(tmdsbuf1_blue++)  = b;
         }
-    }
 
-    // repeat this line 3 more times (4x in total)
-    for (uint yrepeat=0;yrepeat<3;yrepeat++)
-    {
-        dvi_get_scanline(tmdsbufRepeat);
-        dvi_copy_scanline(tmdsbufRepeat, tmdsbuf1);
-        // send copied buffer
-        dvi_send_scanline(tmdsbufRepeat);
-    }
-    // send original buffer
-    dvi_send_scanline(tmdsbuf1);
-
-    // repeat this line 3 more times (4x in total)
-    for (uint yrepeat=0;yrepeat<3;yrepeat++)
-    {
-        dvi_get_scanline(tmdsbufRepeat);
-        dvi_copy_scanline(tmdsbufRepeat, tmdsbuf2);
-        // send copied buffer
-        dvi_send_scanline(tmdsbufRepeat);
+        pTmds = &tmds_lorescolor[color2*3];
+        r = pTmds[0];
+        g = pTmds[1];
+        b = pTmds[2];
+        for (uint j = 0; j < 7; j++)
+        {
+            *(tmdsbuf2_red++)   = r;
+            *(tmdsbuf2_green++) = g;
+            *(tmdsbuf2_blue++)  = b;
+        }
     }
 
-    // send original buffer
-    dvi_send_scanline(tmdsbuf2);
+    render_lores_send(tmdsbuf1, tmdsbuf2);
 }
+
+render_line_kernel_t DELAYED_COPY_DATA(lores_line_kernels)[RENDER_KERNEL_VARIANTS] =
+{
+    render_lores_line_color,
+    render_lores_line_mono_white,
+    render_lores_line_mono_green,
+    render_lores_line_mono_amber
+};
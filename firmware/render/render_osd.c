@@ -0,0 +1,231 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <string.h>
+#include <pico/stdlib.h>
+#include "applebus/buffers.h"
+#include "applebus/switch_events.h"
+#include "config/config.h"
+#include "fonts/textfont.h"
+#include "menu/menu.h"
+
+#include "render.h"
+
+#ifdef FEATURE_OSD
+
+// OSD box colors (LORES palette): white text on dark blue
+#define OSD_COLOR_FG 15
+#define OSD_COLOR_BG 2
+
+// Toast requests: one slot per core, only ever written by its own core with a single word store
+// (sequence number << 16 | message << 8 | argument), so no cross-core read-modify-write is needed.
+static volatile uint32_t osd_request[2];
+
+// render core: the text (Apple screen codes) currently shown (no rows: hidden)
+static uint8_t  osd_text[OSD_ROWS][OSD_COLUMNS];
+static uint32_t osd_ack[2];
+static uint32_t osd_end_frame;
+static uint     osd_rows;
+static uint32_t osd_overflows;
+
+// render core: lines of the OSD band in the current frame
+static uint     osd_lines;
+
+// encoded foreground/background pixels for each nibble of a glyph row: 4 words per lane (red, green, blue)
+static uint32_t osd_nibbles[16][3][4];
+
+// toast texts: title and the table of the argument's names (NULL: no value shown)
+typedef struct
+{
+    const char*  pTitle;
+    const char** pValues;
+    uint8_t      value_count;
+} osd_message_text_t;
+
+static osd_message_text_t DELAYED_COPY_DATA(osd_messages)[OSD_MSG_COUNT] =
+{
+    [OSD_MSG_COLOR_MODE]        = {"MONOCHROME COLOR",     MenuColorMode,  COLOR_MODE_AMBER+1},
+    [OSD_MSG_FORCED_MONO]       = {"COLOR MODES",          MenuForcedMono, 2},
+    [OSD_MSG_FONT_SAVED]        = {"FONT SAVED",           NULL,           0},
+    [OSD_MSG_CHARSET]           = {"CHARACTER SET",        MenuFontNames,  MAX_FONT_COUNT},
+    [OSD_MSG_ALT_CHARSET]       = {"US CHARACTER SET",     MenuFontNames,  MAX_FONT_COUNT},
+    [OSD_MSG_TRACE_EXPORTED]    = {"BUS TRACE EXPORTED",   NULL,           0},
+    [OSD_MSG_DEFAULTS_RESTORED] = {"DEFAULTS RESTORED",    NULL,           0},
+    [OSD_MSG_CONFIG_LOADED]     = {"CONFIGURATION LOADED", NULL,           0},
+    [OSD_MSG_CONFIG_SAVED]      = {"SAVED",                NULL,           0},
+    [OSD_MSG_BUS_OVERFLOW]      = {"BUS FIFO OVERFLOW",    NULL,           0},
+};
+
+// Called by either core. Cheap enough for the bus core's register writes.
+void __time_critical_func(render_osd_toast)(osd_message_t message, uint8_t arg)
+{
+    const uint core = get_core_num();
+    const uint32_t sequence = (osd_request[core] >> 16) + 1;
+    osd_request[core] = (sequence << 16) | ((uint32_t)message << 8) | arg;
+}
+
+// render core: format a toast into the OSD text and show it
+static void DELAYED_COPY_CODE(render_osd_show)(uint message, uint arg)
+{
+    if ((message == OSD_MSG_NONE)||(message >= OSD_MSG_COUNT))
+        return;
+
+    const osd_message_text_t* pText = &osd_messages[message];
+    char msg[OSD_COLUMNS-2+1];
+    uint len = 0;
+    const char* pTitle = pText->pTitle;
+    while ((*pTitle)&&(len < sizeof(msg)-1))
+        msg[len++] = *(pTitle++);
+    if (pText->pValues)
+    {
+        const char* pValue = (arg < pText->value_count) ? pText->pValues[arg] : "?";
+        const char* pSeparator = ": ";
+        while ((*pSeparator)&&(len < sizeof(msg)-1))
+            msg[len++] = *(pSeparator++);
+        while ((*pValue)&&(len < sizeof(msg)-1))
+            msg[len++] = *(pValue++);
+    }
+
+    // centered in the bar
+    memset(osd_text[0], 0xA0, OSD_COLUMNS);
+    uint8_t* pOsd = &osd_text[0][(OSD_COLUMNS-len)/2];
+    for (uint i=0;i<len;i++)
+        pOsd[i] = 0x80|msg[i];
+
+    osd_rows      = 1;
+    osd_end_frame = frame_counter + OSD_TOAST_FRAMES;
+}
+
+void DELAYED_COPY_CODE(render_osd_init)(void)
+{
+    osd_overflows = bus_overflow_counter;
+
+    for (uint nibble=0;nibble<16;nibble++)
+    {
+        for (uint i=0;i<4;i++)
+        {
+            const uint color = (nibble & (1u << i)) ? OSD_COLOR_FG : OSD_COLOR_BG;
+            for (uint lane=0;lane<3;lane++)
+                osd_nibbles[nibble][lane][i] = tmds_lorescolor[color*3+lane];
+        }
+    }
+}
+
+// Called after each frame, so the text never changes while render_osd_band() reads it: takes new
+// requests, hides expired boxes and raises warnings.
+void DELAYED_COPY_CODE(render_osd_frame)(void)
+{
+    bool shown = false;
+    for (uint core=0;core<2;core++)
+    {
+        const uint32_t request = osd_request[core];
+        if (request != osd_ack[core])
+        {
+            osd_ack[core] = request;
+            render_osd_show((request >> 8) & 0xff, request & 0xff);
+            shown = true;
+        }
+    }
+
+    // performance warning: the bus core lost cycles. Does not replace another message.
+    const uint32_t overflows = bus_overflow_counter;
+    if ((overflows > osd_overflows)&&(osd_rows == 0)&&(!shown))
+    {
+        render_osd_show(OSD_MSG_BUS_OVERFLOW, 0);
+        shown = true;
+    }
+    osd_overflows = overflows;
+
+    if ((!shown)&&(osd_rows)&&((int32_t)(frame_counter - osd_end_frame) >= 0))
+    {
+        osd_rows = 0;
+    }
+}
+
+// Clip the display list at the top of the OSD band (the bottom rows of the screen): the band's lines
+// are rendered by render_osd_band() instead, so neither the kernels nor the lines above it pay for the OSD.
+void DELAYED_COPY_CODE(render_osd_clip)(render_display_list_t* dl)
+{
+    osd_lines = osd_rows*8;
+    if (osd_lines == 0)
+        return;
+
+    const uint band = APPLE_VISIBLE_LINES - osd_lines;
+    for (uint i=0;i<dl->count;i++)
+    {
+        render_op_t* pOp = &dl->ops[i];
+        // graphics ops count lines, all others count rows of 8 lines
+        const uint first = ((pOp->op == RENDER_OP_HIRES)||(pOp->op == RENDER_OP_DHGR)) ? band : band/8;
+        if (pOp->first + pOp->count <= first)
+            continue;
+        if (pOp->first < first)
+        {
+            // the band starts within this op
+            pOp->count = first-pOp->first;
+            i++;
+        }
+        dl->count = i;
+        return;
+    }
+}
+
+// Send the lines of the OSD band: the text in white on dark blue, across the width of the Apple screen.
+// Each glyph row is copied from the encoded nibbles, 4 and 3 pixels per character.
+void DELAYED_COPY_CODE(render_osd_band)(void)
+{
+    for (uint line=0;line<osd_lines;line++)
+    {
+        const uint glyph_line = line & 7;
+        const uint8_t* pText = osd_text[line >> 3];
+
+        dvi_get_scanline(tmdsbuf);
+        dvi_scanline_rgb(tmdsbuf, tmdsbuf_red, tmdsbuf_green, tmdsbuf_blue);
+
+        for (uint col=0;col<OSD_COLUMNS;col++)
+        {
+            const uint bits = character_rom[((uint)pText[col] << 3) | glyph_line];
+            const uint32_t (*pLow)[4]  = osd_nibbles[bits & 0xf];
+            const uint32_t (*pHigh)[4] = osd_nibbles[(bits >> 4) & 0x7];
+            for (uint i=0;i<4;i++)
+            {
+                tmdsbuf_red[i]   = pLow[0][i];
+                tmdsbuf_green[i] = pLow[1][i];
+                tmdsbuf_blue[i]  = pLow[2][i];
+            }
+            for (uint i=0;i<3;i++)
+            {
+                tmdsbuf_red[4+i]   = pHigh[0][i];
+                tmdsbuf_green[4+i] = pHigh[1][i];
+                tmdsbuf_blue[4+i]  = pHigh[2][i];
+            }
+            tmdsbuf_red   += 7;
+            tmdsbuf_green += 7;
+            tmdsbuf_blue  += 7;
+        }
+        dvi_send_scanline(tmdsbuf);
+    }
+}
+
+#endif // FEATURE_OSD
@@ -0,0 +1,67 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// On-screen display (FEATURE_OSD): a small text plane of up to 4 rows of 40 columns, shown as a
+// bar over the bottom rows of the Apple screen for a few seconds, in any video mode. The render loop
+// sends the bar's lines itself instead of the video mode's, so the Apple's video memory is never
+// touched and the kernels do not test for the OSD. Toasts may be
+// requested from either core: the request only posts a message id (and its argument), the render
+// core formats the text between frames.
+#define OSD_ROWS    4
+#define OSD_COLUMNS 40
+
+// frames a toast remains visible
+#define OSD_TOAST_FRAMES 120
+
+typedef enum
+{
+    OSD_MSG_NONE = 0,
+    OSD_MSG_COLOR_MODE,         // argument: color_mode
+    OSD_MSG_FORCED_MONO,        // argument: 1 if forced monochrome
+    OSD_MSG_FONT_SAVED,
+    OSD_MSG_CHARSET,            // argument: font number
+    OSD_MSG_ALT_CHARSET,        // argument: font number
+    OSD_MSG_TRACE_EXPORTED,
+    OSD_MSG_DEFAULTS_RESTORED,
+    OSD_MSG_CONFIG_LOADED,
+    OSD_MSG_CONFIG_SAVED,
+    OSD_MSG_BUS_OVERFLOW,
+    OSD_MSG_COUNT
+} osd_message_t;
+
+#ifdef FEATURE_OSD
+
+extern void render_osd_toast(osd_message_t message, uint8_t arg);
+
+#else
+
+static inline void render_osd_toast(osd_message_t message, uint8_t arg) {}
+
+#endif
@@ -0,0 +1,184 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <string.h>
+#include <pico/stdlib.h>
+#include <hardware/sync.h>
+#include "applebus/buffers.h"
+#include "config/config.h"
+
+#include "render.h"
+
+#ifdef FEATURE_FRAME_SNAPSHOT
+
+// Frame snapshot: at frame start, the render core reads soft_switches/internal_flags under the bus
+// core's seqlock and copies the displayed video pages into its own buffers, so a frame never shows
+// half old, half new memory or mixed video modes. Each buffer holds one page of one memory bank and
+// is tagged with that page. While the page stays on screen, only the rows written during the previous
+// frame are copied again (with FEATURE_DIRTY_ROWS). The DMA is reserved for the DVI output while the
+// display runs (see dmacopy_disable_dma), so the copies use the CPU.
+// Only the page displayed at frame start is copied, so mid-frame splits (which may flip pages) are not
+// supported.
+
+#ifdef FEATURE_MIDFRAME_SPLITS
+#error FEATURE_FRAME_SNAPSHOT cannot be combined with FEATURE_MIDFRAME_SPLITS
+#endif
+
+#define SNAPSHOT_NONE (-1)
+
+static uint8_t snapshot_text[2][0x400];    // [bank]
+static uint8_t snapshot_hgr[2][0x2000];    // [bank]
+static int8_t  snapshot_text_page[2] = {SNAPSHOT_NONE, SNAPSHOT_NONE};
+static int8_t  snapshot_hgr_page[2]  = {SNAPSHOT_NONE, SNAPSHOT_NONE};
+
+uint32_t render_snapshot_us[RENDER_SNAPSHOT_KINDS];
+
+#ifdef FEATURE_DIRTY_ROWS
+dirty_rows_t render_snapshot_dirty;
+#endif
+
+static const volatile uint8_t* const snapshot_text_live[4] = {
+    apple_memory   + SHADOW_OFFSET(0x0400), apple_memory   + SHADOW_OFFSET(0x0800),
+    private_memory + SHADOW_OFFSET(0x0400), private_memory + SHADOW_OFFSET(0x0800)
+};
+static const volatile uint8_t* const snapshot_hgr_live[4] = {
+    apple_memory   + SHADOW_OFFSET(0x2000), apple_memory   + SHADOW_OFFSET(0x4000),
+    private_memory + SHADOW_OFFSET(0x2000), private_memory + SHADOW_OFFSET(0x4000)
+};
+
+static inline uint snapshot_hires_offset(uint line)
+{
+    return ((line & 0x07) << 10) | ((line & 0x38) << 4) | (((line & 0xc0) >> 6) * 40);
+}
+
+// read soft_switches and internal_flags consistently, retrying while the bus core changes them
+static void DELAYED_COPY_CODE(render_snapshot_switches)(void)
+{
+    uint32_t seq, switches, flags;
+    do
+    {
+        seq = soft_switches_seq;
+        __dmb();
+        switches = soft_switches;
+        flags    = internal_flags;
+        __dmb();
+    } while ((seq & 1) || (seq != soft_switches_seq));
+
+    render_frame_switches = switches;
+    render_frame_flags    = flags;
+}
+
+static void DELAYED_COPY_CODE(render_snapshot_text)(uint page, uint bank)
+{
+    const uint8_t* live = (const uint8_t*) snapshot_text_live[bank*2+page];
+    uint8_t* copy = snapshot_text[bank];
+#ifdef FEATURE_DIRTY_ROWS
+    if (snapshot_text_page[bank] == (int8_t) page)
+    {
+        for (uint32_t dirty = render_snapshot_dirty.text[page][bank];dirty;dirty &= dirty-1)
+        {
+            const uint row = __builtin_ctz(dirty);
+            const uint offset = ((row & 0x7) << 7) + ((row >> 3) * 40);
+            memcpy(&copy[offset], &live[offset], 40);
+        }
+    }
+    else
+#endif
+    {
+        memcpy(copy, live, sizeof(snapshot_text[0]));
+        snapshot_text_page[bank] = page;
+    }
+    render_text_pages[bank*2+page] = copy;
+}
+
+static void DELAYED_COPY_CODE(render_snapshot_hgr)(uint page, uint bank)
+{
+    const uint8_t* live = (const uint8_t*) snapshot_hgr_live[bank*2+page];
+    uint8_t* copy = snapshot_hgr[bank];
+#ifdef FEATURE_DIRTY_ROWS
+    if (snapshot_hgr_page[bank] == (int8_t) page)
+    {
+        for (uint w=0;w<DIRTY_HIRES_WORDS;w++)
+        {
+            for (uint32_t dirty = render_snapshot_dirty.hires[page][bank][w];dirty;dirty &= dirty-1)
+            {
+                const uint offset = snapshot_hires_offset(w*32 + __builtin_ctz(dirty));
+                memcpy(&copy[offset], &live[offset], 40);
+            }
+        }
+    }
+    else
+#endif
+    {
+        memcpy(copy, live, sizeof(snapshot_hgr[0]));
+        snapshot_hgr_page[bank] = page;
+    }
+    render_hgr_pages[bank*2+page] = copy;
+}
+
+void DELAYED_COPY_CODE(render_snapshot_frame)(void)
+{
+    const uint32_t start = time_us_32();
+
+    render_snapshot_switches();
+#ifdef FEATURE_DIRTY_ROWS
+    dirty_rows_snapshot(&render_snapshot_dirty);
+#endif
+
+    // pages which are not copied in this frame are read from the shadow memory
+    for (uint i=0;i<4;i++)
+    {
+        render_text_pages[i] = snapshot_text_live[i];
+        render_hgr_pages[i]  = snapshot_hgr_live[i];
+    }
+
+    const uint32_t switches = render_frame_switches;
+    const uint page = ((switches & (SOFTSW_80STORE | SOFTSW_PAGE_2)) == SOFTSW_PAGE_2) ? 1 : 0;
+    // the aux bank is shown by 80 column text, DGR, DHGR and the Video-7 modes
+    const uint banks = (switches & (SOFTSW_80COL | SOFTSW_DGR)) ? 2 : 1;
+    const bool hires = ((switches & (SOFTSW_TEXT_MODE | SOFTSW_HIRES_MODE)) == SOFTSW_HIRES_MODE);
+    const bool text  = (!hires) || (switches & SOFTSW_MIX_MODE);
+
+    // a buffer which is skipped for a frame misses that frame's dirty rows: copy it fully next time
+    for (uint bank=0;bank<2;bank++)
+    {
+        if (text && (bank < banks))
+            render_snapshot_text(page, bank);
+        else
+            snapshot_text_page[bank] = SNAPSHOT_NONE;
+        if (hires && (bank < banks))
+            render_snapshot_hgr(page, bank);
+        else
+            snapshot_hgr_page[bank] = SNAPSHOT_NONE;
+    }
+
+    const uint kind = (hires) ? ((banks == 2) ? RENDER_SNAPSHOT_DHGR   : RENDER_SNAPSHOT_HIRES) :
+                                ((banks == 2) ? RENDER_SNAPSHOT_TEXT80 : RENDER_SNAPSHOT_TEXT40);
+    const uint32_t us = time_us_32() - start;
+    if (us > render_snapshot_us[kind])
+        render_snapshot_us[kind] = us;
+}
+
+#endif // FEATURE_FRAME_SNAPSHOT
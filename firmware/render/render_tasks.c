@@ -0,0 +1,106 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <pico/stdlib.h>
+#include <hardware/clocks.h>
+#include "applebus/buffers.h"
+#include "config/config.h"
+#include "util/cycles.h"
+#include "render_tasks.h"
+
+render_task_t* DELAYED_COPY_DATA(render_tasks)[RENDER_TASKS_MAX];
+uint32_t       DELAYED_COPY_DATA(render_tasks_count);
+uint32_t       DELAYED_COPY_DATA(render_tasks_cycles_per_us);
+uint32_t       DELAYED_COPY_DATA(render_tasks_max_cycles);
+
+static uint32_t render_vblank_cycles;
+
+// Called on the render core: the cycle counter is private to each core.
+void DELAYED_COPY_CODE(render_tasks_init)(void)
+{
+    cycle_counter_init();
+
+    render_tasks_cycles_per_us = clock_get_hz(clk_sys) / 1000000;
+    render_vblank_cycles       = RENDER_VBLANK_US * render_tasks_cycles_per_us;
+}
+
+// Tasks run in the order of their registration.
+void DELAYED_COPY_CODE(render_tasks_register)(render_task_t* pTask)
+{
+    if (render_tasks_count >= RENDER_TASKS_MAX)
+        return;
+    pTask->pending = false;
+    pTask->budget  = pTask->budget_us * render_tasks_cycles_per_us;
+    render_tasks[render_tasks_count++] = pTask;
+}
+
+// Called once per frame, after its last scanline was queued.
+void DELAYED_COPY_CODE(render_tasks_run)(void)
+{
+    const uint32_t start = cycle_counter_now();
+
+    for (uint32_t i=0;i<render_tasks_count;i++)
+    {
+        render_task_t* pTask = render_tasks[i];
+        if (((frame_counter % pTask->period) == 0) || ((pTask->pTrigger) && (*pTask->pTrigger)))
+            pTask->pending = true;
+    }
+
+    // round-robin over the pending tasks, until they are done or the time is used up
+    bool progress = true;
+    while (progress)
+    {
+        progress = false;
+        for (uint32_t i=0;i<render_tasks_count;i++)
+        {
+            render_task_t* pTask = render_tasks[i];
+            if (!pTask->pending)
+                continue;
+            const uint32_t used = cycle_counter_since(start);
+            if (used + pTask->budget > render_vblank_cycles)
+                continue;
+
+            const uint32_t slice_start = cycle_counter_now();
+            pTask->pending = pTask->run();
+            const uint32_t cycles = cycle_counter_since(slice_start);
+
+            pTask->slices++;
+            if (cycles > pTask->budget)
+                pTask->overruns++;
+            if (cycles > pTask->max_cycles)
+                pTask->max_cycles = cycles;
+            progress = true;
+        }
+    }
+
+    for (uint32_t i=0;i<render_tasks_count;i++)
+    {
+        if (render_tasks[i]->pending)
+            render_tasks[i]->deferred++;
+    }
+
+    const uint32_t cycles = cycle_counter_since(start);
+    if (cycles > render_tasks_max_cycles)
+        render_tasks_max_cycles = cycles;
+}
@@ -0,0 +1,65 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Cooperative task scheduler of the render core.
+// Deferred work (character set reloads, machine detection, audio synthesis, the USB stream...)
+// runs as registered tasks once a frame's last scanline was queued, while the DVI output drains the
+// queued scanlines and the vertical blanking interval. Tasks run in slices: a slice returns true while
+// the task has more work, and is called again as long as the frame's time allows. A slice is only
+// started when the task's budget still fits into the remaining time, otherwise the task continues
+// after the next frame, so no task can delay the first scanline of the next frame.
+#define RENDER_TASKS_MAX  8
+#define RENDER_VBLANK_US  1000 // 45 blank lines of 31.8us, minus a safety margin
+
+typedef bool (*render_task_func_t)(void);
+
+typedef struct
+{
+    const char*        name;
+    render_task_func_t run;        // runs one slice, returns true while more slices are pending
+    uint32_t           budget_us;  // maximum time of a slice
+    uint32_t           period;     // frames between activations (1: every frame)
+    const volatile bool* pTrigger; // also activates the task after any frame while set (NULL: none)
+    // state and statistics, maintained by the scheduler
+    bool               pending;
+    uint32_t           budget;     // budget_us in CPU cycles
+    uint32_t           slices;
+    uint32_t           overruns;   // slices which took longer than the budget
+    uint32_t           deferred;   // frames after which the task was still pending
+    uint32_t           max_cycles; // longest slice
+} render_task_t;
+
+extern render_task_t* render_tasks[RENDER_TASKS_MAX];
+extern uint32_t       render_tasks_count;
+extern uint32_t       render_tasks_cycles_per_us;
+extern uint32_t       render_tasks_max_cycles; // longest time spent on tasks after a frame
+
+extern void render_tasks_init(void);
+extern void render_tasks_register(render_task_t* pTask);
+extern void render_tasks_run(void);
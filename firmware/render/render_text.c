@@ -33,8 +33,6 @@ SOFTWARE.
 
 #include "render.h"
 
-#define PAGE2SEL ((soft_switches & (SOFTSW_80STORE | SOFTSW_PAGE_2)) == SOFTSW_PAGE_2)
-
 volatile uint_fast32_t text_flasher_mask = 0;
 static uint64_t next_flash_tick = 0;
 
@@ -64,7 +62,7 @@ static inline uint_fast8_t char_text_bits(uint_fast8_t ch, uint_fast8_t glyph_li
 {
     uint_fast8_t bits, invert;
 
-    if((ch & 0x80) || (soft_switches & SOFTSW_ALTCHAR))
+    if((ch & 0x80) || (render_frame_switches & SOFTSW_ALTCHAR))
     {
         // normal / mousetext character
         invert = 0x00;
@@ -80,9 +78,10 @@ static inline uint_fast8_t char_text_bits(uint_fast8_t ch, uint_fast8_t glyph_li
     return (bits ^ invert) & 0x7f;
 }
 
-void DELAYED_COPY_CODE(render_text40_line)(const uint8_t *page, unsigned int line, uint8_t color_mode)
+static __force_inline void render_text40_line_mono(const uint8_t *page, unsigned int line, const uint32_t* tmds_fg)
 {
     const uint8_t *line_buf = (const uint8_t *)(page + ((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40));
+    const uint32_t* tmds_bg = &tmds_mono_double_pixel[3*3]; // black
 
     for(uint glyph_line=0; glyph_line < 8; glyph_line++)
     {
@@ -99,12 +98,10 @@ void DELAYED_COPY_CODE(render_text40_line)(const uint8_t *page, unsigned int lin
             // Translate bits into a pair of pixels
             for(int i=0; i < 14; i++)
             {
-                uint8_t color_offset = color_mode*3;
-                if ((bits & 1)==0)
-                    color_offset = 3*3;
-                *(tmdsbuf_blue++)  = tmds_mono_double_pixel[color_offset + 2];
-                *(tmdsbuf_green++) = tmds_mono_double_pixel[color_offset + 1];
-                *(tmdsbuf_red++)   = tmds_mono_double_pixel[color_offset + 0];
+                const uint32_t* pTmds = (bits & 1) ? tmds_fg : tmds_bg;
+                *(tmdsbuf_blue++)  = pTmds[2];
+                *(tmdsbuf_green++) = pTmds[1];
+                *(tmdsbuf_red++)   = pTmds[0];
                 bits >>= 1;
             }
         }
@@ -112,6 +109,36 @@ void DELAYED_COPY_CODE(render_text40_line)(const uint8_t *page, unsigned int lin
     }
 }
 
+// one text40 entry point per color mode, sharing one copy of the kernel (see RENDER_MONO_KERNELS)
+static void DELAYED_COPY_CODE(render_text40_line_any)(const uint8_t *page, unsigned int line, const uint32_t* tmds_fg)
+{
+    render_text40_line_mono(page, line, tmds_fg);
+}
+
+#define TEXT40_KERNEL(name, cmode) \
+    static void DELAYED_COPY_CODE(render_text40_line_##name)(const uint8_t *page, unsigned int line) \
+    { render_text40_line_any(page, line, &tmds_mono_double_pixel[(cmode)*3]); }
+
+TEXT40_KERNEL(white, COLOR_MODE_BW)
+TEXT40_KERNEL(green, COLOR_MODE_GREEN)
+TEXT40_KERNEL(amber, COLOR_MODE_AMBER)
+TEXT40_KERNEL(black, 3)
+TEXT40_KERNEL(red,   4)
+
+render_text40_kernel_t DELAYED_COPY_DATA(text40_line_kernels)[5] =
+{
+    render_text40_line_white,
+    render_text40_line_green,
+    render_text40_line_amber,
+    render_text40_line_black,
+    render_text40_line_red
+};
+
+void DELAYED_COPY_CODE(render_text40_line)(const uint8_t *page, unsigned int line, uint8_t color_mode)
+{
+    text40_line_kernels[color_mode](page, line);
+}
+
 #define ADD_LORES_PIXEL(color) { \
     uint32_t* pTmds = &tmds_lorescolor[color*3]; \
     *(tmdsbuf_red++)   = pTmds[0]; \
@@ -121,8 +148,8 @@ void DELAYED_COPY_CODE(render_text40_line)(const uint8_t *page, unsigned int lin
 
 void DELAYED_COPY_CODE(render_color_text40_line)(unsigned int line)
 {
-    const uint8_t *line_buf = (const uint8_t *)(text_p1 + ((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40));
-    const uint8_t *color_buf = (const uint8_t *)(text_p3 + ((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40));
+    const uint8_t *line_buf = (const uint8_t *)(render_text_pages[0] + ((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40));
+    const uint8_t *color_buf = (const uint8_t *)(render_text_pages[2] + ((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40));
 
     for(uint glyph_line=0; glyph_line < 8; glyph_line++)
     {
@@ -155,13 +182,35 @@ void DELAYED_COPY_CODE(render_color_text40_line)(unsigned int line)
     }
 }
 
-void DELAYED_COPY_CODE(render_text80_line)(const uint8_t *page_a, const uint8_t *page_b, unsigned int line, uint8_t color_mode)
+static __force_inline void render_text80_line_mono(const uint8_t *page_a, const uint8_t *page_b, unsigned int line, uint cmode)
 {
     uint line_offset = ((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40);
     const uint8_t *line_buf_a = (const uint8_t *) (page_a + line_offset);
     const uint8_t *line_buf_b = (const uint8_t *) (page_b + line_offset);
 
-    uint8_t color_offset = color_mode*12;
+#ifdef FEATURE_ASM_KERNELS
+    const uint32_t* tmds_nibbles = &tmds_mono_nibbles[cmode*16*8];
+    uint32_t dots[20];
+
+    for(uint glyph_line=0; glyph_line < 8; glyph_line++)
+    {
+        dvi_get_scanline(tmdsbuf);
+
+        for(uint col=0; col < 40; col+=2)
+        {
+            // Grab 28 pixels from the next four characters
+            uint32_t bits;
+            bits  = char_text_bits(line_buf_b[col],   glyph_line);
+            bits |= char_text_bits(line_buf_a[col],   glyph_line) << 7;
+            bits |= char_text_bits(line_buf_b[col+1], glyph_line) << 14;
+            bits |= char_text_bits(line_buf_a[col+1], glyph_line) << 21;
+            dots[col/2] = bits;
+        }
+        render_text80_mono_asm(dots, tmdsbuf+DVI_APPLE2_XOFS, tmds_nibbles);
+        dvi_send_scanline(tmdsbuf);
+    }
+#else
+    const uint32_t* tmds_pair = &tmds_mono_pixel_pair[cmode*12];
 
     for(uint glyph_line=0; glyph_line < 8; glyph_line++)
     {
@@ -179,86 +228,35 @@ void DELAYED_COPY_CODE(render_text80_line)(const uint8_t *page_a, const uint8_t
             // Translate each pair of bits into a pair of pixels
             for(int i=0; i < 7; i++)
             {
-                char symbol = (bits&3) + color_offset;
-                *(tmdsbuf_blue++)  = tmds_mono_pixel_pair[symbol+8];
-                *(tmdsbuf_green++) = tmds_mono_pixel_pair[symbol+4];
-                *(tmdsbuf_red++)   = tmds_mono_pixel_pair[symbol+0];
+                const uint32_t* pTmds = &tmds_pair[bits&3];
+                *(tmdsbuf_blue++)  = pTmds[8];
+                *(tmdsbuf_green++) = pTmds[4];
+                *(tmdsbuf_red++)   = pTmds[0];
                 bits >>= 2;
             }
         }
         dvi_send_scanline(tmdsbuf);
     }
+#endif
 }
 
-void DELAYED_COPY_CODE(render_mixed_text)()
+// one text80 entry point per color mode, sharing one copy of the kernel
+static void DELAYED_COPY_CODE(render_text80_line_any)(const uint8_t *page_a, const uint8_t *page_b, unsigned int line, uint cmode)
 {
-    if((internal_flags & IFLAGS_VIDEO7) && ((soft_switches & (SOFTSW_80STORE | SOFTSW_80COL | SOFTSW_DGR)) == (SOFTSW_80STORE | SOFTSW_DGR)))
-    {
-        for(uint line=20; line < 24; line++)
-        {
-            render_color_text40_line(line);
-        }
-    }
-    else
-    {
-        const bool page2 = PAGE2SEL;
-        const uint8_t *pageA = (const uint8_t *)(page2 ? text_p2 : text_p1);
-        uint8_t cmode = (mono_rendering) ? color_mode : 0; /* white */
-
-        if(soft_switches & SOFTSW_80COL)
-        {
-            // 80 column mode rendering
-            const uint8_t *pageB = (const uint8_t *)(page2 ? text_p4 : text_p3);
-            for(uint line=20; line < 24; line++)
-            {
-                render_text80_line(pageA, pageB, line, cmode);
-            }
-        }
-        else
-        {
-            // 40 column mode rendering
-            for(uint line=20; line < 24; line++)
-            {
-                render_text40_line(pageA, line, cmode);
-            }
-        }
-    }
+    render_text80_line_mono(page_a, page_b, line, cmode);
 }
 
-void DELAYED_COPY_CODE(render_text)()
-{
-    const bool page2 = PAGE2SEL;
-    const uint8_t *pageA = (const uint8_t *)(page2 ? text_p2 : text_p1);
+#define TEXT80_KERNEL(name, cmode) \
+    static void DELAYED_COPY_CODE(render_text80_line_##name)(const uint8_t *page_a, const uint8_t *page_b, unsigned int line) \
+    { render_text80_line_any(page_a, page_b, line, cmode); }
 
-    if((internal_flags & IFLAGS_VIDEO7) && ((soft_switches & (SOFTSW_80STORE | SOFTSW_80COL | SOFTSW_DGR)) == (SOFTSW_80STORE | SOFTSW_DGR)))
-    {
-        for(uint line=0; line < 24; line++)
-        {
-            render_color_text40_line(line);
-        }
-    }
-    else
-    {
-        if(soft_switches & SOFTSW_80COL)
-        {
-            // 80 column mode rendering
-            const uint8_t *pageB = (const uint8_t *)(page2 ? text_p4 : text_p3);
-            for(uint line=0; line < 24; line++)
-            {
-                render_text80_line(pageA, pageB, line, color_mode);
-            }
-        }
-        else
-        {
-            // 40 column mode rendering
-            for(uint line=0; line < 24; line++)
-            {
-                render_text40_line(pageA, line, color_mode);
-            }
-        }
-    }
-    if (reload_charsets)
-    {
-        config_load_charsets();
-    }
-}
+TEXT80_KERNEL(white, COLOR_MODE_BW)
+TEXT80_KERNEL(green, COLOR_MODE_GREEN)
+TEXT80_KERNEL(amber, COLOR_MODE_AMBER)
+
+render_text80_kernel_t DELAYED_COPY_DATA(text80_line_kernels)[3] =
+{
+    render_text80_line_white,
+    render_text80_line_green,
+    render_text80_line_amber
+};
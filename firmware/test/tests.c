@@ -183,7 +183,7 @@ void setLoresPixel(uint16_t x, uint8_t y, bool page2, uint8_t color)
 
      uint line = y >> 1;
      uint16_t address = 0x400+((line & 0x7) << 7) + (((line >> 3) & 0x3) * 40)+x;
-     apple_memory[address] = (apple_memory[address] & mask) | color;
+     APPLE_MEM(address) = (APPLE_MEM(address) & mask) | color;
 }
 
 void setLoresTestPattern(uint lines)
@@ -615,8 +615,7 @@ void test_loop()
 
     while (1)
     {
-        current_machine = MACHINE_IIE;
-        internal_flags |= IFLAGS_IIE_REGS;
+        set_machine(MACHINE_IIE);
 
         // test text modes
         test40columns_color();
@@ -0,0 +1,53 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// TinyUSB configuration of the USB streaming channel (FEATURE_USB_STREAM): a single CDC interface.
+
+#ifndef CFG_TUSB_MCU
+    #error CFG_TUSB_MCU must be defined (by the PICO_SDK)
+#endif
+
+#ifndef CFG_TUSB_OS
+    #define CFG_TUSB_OS OPT_OS_PICO
+#endif
+
+#define CFG_TUSB_RHPORT0_MODE   OPT_MODE_DEVICE
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+#define CFG_TUD_CDC             1
+#define CFG_TUD_MSC             0
+#define CFG_TUD_HID             0
+#define CFG_TUD_MIDI            0
+#define CFG_TUD_VENDOR          0
+
+// host requests are single characters
+#define CFG_TUD_CDC_RX_BUFSIZE  64
+// holds one frame's worth of the stream (USB_STREAM_FRAME_BYTES)
+#define CFG_TUD_CDC_TX_BUFSIZE  2048
+// TinyUSB only starts the next IN transfer from tud_task(), which runs once per frame. So a single
+// transfer must carry a whole frame's worth of the stream (the RP2040's USB driver splits it into
+// 64 byte packets). With 64 bytes, the stream was limited to 64 bytes per frame (~3.8KB/s).
+#define CFG_TUD_CDC_EP_BUFSIZE  2048
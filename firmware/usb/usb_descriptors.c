@@ -0,0 +1,118 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string.h>
+#include "usb_stream.h"
+
+#ifdef FEATURE_USB_STREAM
+#include "tusb.h"
+
+// USB descriptors of the streaming channel: one CDC interface (a serial port on the host).
+#define USB_VID 0x2E8A // Raspberry Pi
+#define USB_PID 0x000A // Pico SDK CDC device
+
+enum
+{
+    USB_ITF_CDC = 0,
+    USB_ITF_CDC_DATA,
+    USB_ITF_TOTAL
+};
+
+#define USB_EP_CDC_NOTIFY 0x81
+#define USB_EP_CDC_OUT    0x02
+#define USB_EP_CDC_IN     0x82
+
+#define USB_CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_CDC_DESC_LEN)
+
+static const tusb_desc_device_t usb_device_descriptor =
+{
+    .bLength            = sizeof(tusb_desc_device_t),
+    .bDescriptorType    = TUSB_DESC_DEVICE,
+    .bcdUSB             = 0x0200,
+    // IAD, required by the CDC interface pair
+    .bDeviceClass       = TUSB_CLASS_MISC,
+    .bDeviceSubClass    = MISC_SUBCLASS_COMMON,
+    .bDeviceProtocol    = MISC_PROTOCOL_IAD,
+    .bMaxPacketSize0    = CFG_TUD_ENDPOINT0_SIZE,
+    .idVendor           = USB_VID,
+    .idProduct          = USB_PID,
+    .bcdDevice          = 0x0100,
+    .iManufacturer      = 1,
+    .iProduct           = 2,
+    .iSerialNumber      = 3,
+    .bNumConfigurations = 1
+};
+
+static const uint8_t usb_config_descriptor[] =
+{
+    TUD_CONFIG_DESCRIPTOR(1, USB_ITF_TOTAL, 0, USB_CONFIG_TOTAL_LEN, 0, 100),
+    TUD_CDC_DESCRIPTOR(USB_ITF_CDC, 4, USB_EP_CDC_NOTIFY, 8, USB_EP_CDC_OUT, USB_EP_CDC_IN, 64)
+};
+
+static const char* usb_strings[] =
+{
+    NULL,                // 0: language, see below
+    "A2DVI",             // 1: manufacturer
+    "A2DVI " FW_VERSION, // 2: product
+    "0",                 // 3: serial number
+    "A2DVI Stream"       // 4: CDC interface
+};
+
+const uint8_t* tud_descriptor_device_cb(void)
+{
+    return (const uint8_t*) &usb_device_descriptor;
+}
+
+const uint8_t* tud_descriptor_configuration_cb(uint8_t index)
+{
+    (void) index;
+    return usb_config_descriptor;
+}
+
+const uint16_t* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+{
+    static uint16_t descriptor[32];
+    (void) langid;
+
+    uint chars = 1;
+    if (index == 0)
+    {
+        descriptor[1] = 0x0409; // English
+    }
+    else
+    {
+        if (index >= sizeof(usb_strings)/sizeof(usb_strings[0]))
+            return NULL;
+        const char* str = usb_strings[index];
+        chars = strlen(str);
+        if (chars > 31)
+            chars = 31;
+        for (uint i=0;i<chars;i++)
+            descriptor[1+i] = str[i];
+    }
+    descriptor[0] = (TUSB_DESC_STRING << 8) | (2*chars + 2);
+    return descriptor;
+}
+
+#endif // FEATURE_USB_STREAM
@@ -0,0 +1,323 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <string.h>
+#include <pico/stdlib.h>
+#include <hardware/irq.h>
+#include "applebus/buffers.h"
+#include "applebus/bus_stats.h"
+#include "applebus/bus_trace.h"
+#include "applebus/mockingboard.h"
+#include "audio/audio.h"
+#include "config/config.h"
+#include "dvi/a2dvi.h"
+#include "usb_stream.h"
+
+#ifdef FEATURE_USB_STREAM
+#include "tusb.h"
+
+// the host tool relies on the packet layout
+typedef char usb_stream_header_size_check[(sizeof(usb_stream_header_t) == 12) - 1];
+// one USB transfer per frame must carry the frame's budget (see tusb_config.h)
+typedef char usb_stream_transfer_size_check[((CFG_TUD_CDC_EP_BUFSIZE >= USB_STREAM_FRAME_BYTES) && (CFG_TUD_CDC_TX_BUFSIZE >= USB_STREAM_FRAME_BYTES)) - 1];
+
+// transfer in progress, sent in steps over several frames
+typedef enum
+{
+    USB_XFER_NONE,
+    USB_XFER_TRACE, // steps: header, values, deltas
+    USB_XFER_VIDEO  // steps: header, text main/aux, HIRES main/aux, end
+} usb_stream_xfer_t;
+
+#define USB_VIDEO_SEGMENTS 4
+
+static usb_stream_xfer_t usb_xfer = USB_XFER_NONE;
+static uint32_t usb_xfer_step;
+static uint32_t usb_xfer_pos;   // record or byte offset within the step
+static uint32_t usb_xfer_count; // trace: records captured when the transfer started
+static uint32_t usb_xfer_page2; // video: page displayed when the transfer started
+
+#ifdef FEATURE_MOCKINGBOARD
+static bool     usb_audio;      // audio streaming requested
+static uint32_t usb_audio_read; // next sample to send
+#endif
+
+static uint8_t  usb_seq;
+static uint32_t usb_budget;     // bytes which may still be queued in this frame
+static uint32_t usb_frame_start;
+static uint32_t usb_dropped;
+
+// Queue a packet, when the rate limit and the USB FIFO allow it. The payload is copied straight from
+// its source into TinyUSB's FIFO.
+static bool DELAYED_COPY_CODE(usb_stream_packet)(uint8_t type, uint32_t arg, const volatile void* pData, uint32_t size)
+{
+    const uint32_t bytes = sizeof(usb_stream_header_t) + size;
+    if ((bytes > usb_budget)||(time_us_32() - usb_frame_start >= USB_STREAM_FRAME_US))
+        return false;
+    if (tud_cdc_write_available() < bytes)
+        return false;
+
+    usb_stream_header_t header;
+    header.magic    = USB_STREAM_MAGIC;
+    header.type     = type;
+    header.seq      = usb_seq++;
+    header.size     = size;
+    header.reserved = 0;
+    header.arg      = arg;
+    tud_cdc_write(&header, sizeof(header));
+    if (size)
+        tud_cdc_write((const void*) pData, size);
+    usb_budget -= bytes;
+    return true;
+}
+
+static void DELAYED_COPY_CODE(usb_stream_counters)(void)
+{
+    usb_stream_counters_t counters;
+    memset(&counters, 0, sizeof(counters));
+    counters.time_us              = time_us_32();
+    counters.frame_counter        = frame_counter;
+    counters.bus_counter          = bus_counter;
+    counters.bus_overflow_counter = bus_overflow_counter;
+    counters.reset_counter        = reset_counter;
+    counters.devicereg_counter    = devicereg_counter;
+    counters.soft_switches        = soft_switches;
+    counters.internal_flags       = internal_flags;
+#ifdef FEATURE_BUS_STATS
+    counters.bus_busy_percent     = bus_stats.busy_percent;
+    counters.bus_max_cycles       = bus_stats.max_cycles;
+#endif
+#ifdef FEATURE_DVI_STATS
+    counters.dvi_late_lines       = dvi_late_lines;
+    counters.render_idle_percent  = render_idle_percent;
+#endif
+#ifdef FEATURE_BUS_TRACE
+    counters.trace_count          = bus_trace_count();
+#endif
+    counters.stream_dropped       = usb_dropped;
+#ifdef FEATURE_MOCKINGBOARD
+    counters.audio_synth_us       = audio_synth_us;
+    counters.audio_dropped        = mockingboard_events_dropped;
+#endif
+
+    if (!usb_stream_packet(USB_STREAM_COUNTERS, 0, &counters, sizeof(counters)))
+        usb_dropped++;
+}
+
+#ifdef FEATURE_BUS_TRACE
+// Send the trace ring, oldest record first. Chunks never wrap around the end of the ring, so every
+// payload is a plain slice of bus_trace_values/bus_trace_deltas.
+static bool DELAYED_COPY_CODE(usb_stream_trace)(void)
+{
+    if (usb_xfer_step == 0)
+    {
+        bus_trace_header_t header;
+        bus_trace_get_header(&header);
+        // the ring changes while the recorder is armed: the host gets an empty trace
+        usb_xfer_count = (bus_trace_armed) ? 0 : header.count;
+        header.count = usb_xfer_count;
+        if (!usb_stream_packet(USB_STREAM_TRACE_HEADER, 0, &header, sizeof(header)))
+            return true;
+        usb_xfer_step = 1;
+        usb_xfer_pos  = 0;
+    }
+
+    while (usb_xfer_step <= 2)
+    {
+        if (bus_trace_armed)
+            return false; // re-armed during the transfer: the ring is being overwritten
+
+        if (usb_xfer_pos >= usb_xfer_count)
+        {
+            usb_xfer_step++;
+            usb_xfer_pos = 0;
+            continue;
+        }
+
+        const uint32_t first = (bus_trace_index - usb_xfer_count + usb_xfer_pos) & (BUS_TRACE_SIZE-1);
+        const uint32_t elem  = (usb_xfer_step == 1) ? sizeof(bus_trace_values[0]) : sizeof(bus_trace_deltas[0]);
+        uint32_t records = usb_xfer_count - usb_xfer_pos;
+        if (records > BUS_TRACE_SIZE - first)
+            records = BUS_TRACE_SIZE - first;
+        if (records > USB_STREAM_CHUNK/elem)
+            records = USB_STREAM_CHUNK/elem;
+
+        const bool sent = (usb_xfer_step == 1) ?
+            usb_stream_packet(USB_STREAM_TRACE_VALUES, usb_xfer_pos, &bus_trace_values[first], records*elem) :
+            usb_stream_packet(USB_STREAM_TRACE_DELTAS, usb_xfer_pos, &bus_trace_deltas[first], records*elem);
+        if (!sent)
+            return true;
+        usb_xfer_pos += records;
+    }
+    return false;
+}
+#endif
+
+// Send the text and HIRES pages displayed when the snapshot started, main and aux memory, straight
+// from the shadow memory. The pages are sent over several frames: the end packet tells the host
+// which frame the snapshot was completed in.
+static bool DELAYED_COPY_CODE(usb_stream_video)(void)
+{
+    if (usb_xfer_step == 0)
+    {
+        usb_stream_video_t video;
+        video.frame_counter  = frame_counter;
+        video.soft_switches  = soft_switches;
+        video.internal_flags = internal_flags;
+        if (!usb_stream_packet(USB_STREAM_VIDEO_HEADER, 0, &video, sizeof(video)))
+            return true;
+        usb_xfer_page2 = ((video.soft_switches & (SOFTSW_80STORE | SOFTSW_PAGE_2)) == SOFTSW_PAGE_2);
+        usb_xfer_step = 1;
+        usb_xfer_pos  = 0;
+    }
+
+    while (usb_xfer_step <= USB_VIDEO_SEGMENTS)
+    {
+        const uint32_t segment = usb_xfer_step-1;
+        const bool     aux     = segment & 1;
+        const uint32_t size    = (segment < 2) ? 0x400 : 0x2000;
+        const uint32_t address = size * (1+usb_xfer_page2) + usb_xfer_pos;
+        if (usb_xfer_pos >= size)
+        {
+            usb_xfer_step++;
+            usb_xfer_pos = 0;
+            continue;
+        }
+
+        const uint8_t* pData = (aux) ? &PRIVATE_MEM(address) : &APPLE_MEM(address);
+        if (!usb_stream_packet(USB_STREAM_VIDEO_DATA, address | (aux << 16), pData, USB_STREAM_CHUNK))
+            return true;
+        usb_xfer_pos += USB_STREAM_CHUNK;
+    }
+
+    return !usb_stream_packet(USB_STREAM_VIDEO_END, frame_counter, NULL, 0);
+}
+
+#ifdef FEATURE_MOCKINGBOARD
+// Send the samples synthesized since the previous frame, straight from the PCM ring.
+static void DELAYED_COPY_CODE(usb_stream_audio)(void)
+{
+    const uint32_t write = audio_pcm_write;
+    if (write - usb_audio_read > AUDIO_PCM_SIZE)
+        usb_audio_read = write - AUDIO_PCM_SIZE; // the host fell behind: samples were overwritten
+    while (usb_audio_read != write)
+    {
+        const uint32_t first = usb_audio_read & (AUDIO_PCM_SIZE-1);
+        uint32_t samples = write - usb_audio_read;
+        if (samples > AUDIO_PCM_SIZE - first)
+            samples = AUDIO_PCM_SIZE - first;
+        if (samples > USB_STREAM_CHUNK/sizeof(audio_pcm[0]))
+            samples = USB_STREAM_CHUNK/sizeof(audio_pcm[0]);
+        if (!usb_stream_packet(USB_STREAM_AUDIO, usb_audio_read, &audio_pcm[first], samples*sizeof(audio_pcm[0])))
+            return;
+        usb_audio_read += samples;
+    }
+}
+#endif
+
+static void DELAYED_COPY_CODE(usb_stream_request)(int32_t request)
+{
+    switch(request)
+    {
+#ifdef FEATURE_MOCKINGBOARD
+        case USB_STREAM_REQ_AUDIO:
+            usb_audio = !usb_audio;
+            usb_audio_read = audio_pcm_write;
+            return;
+#endif
+#ifdef FEATURE_BUS_TRACE
+        case USB_STREAM_REQ_TRACE:
+            usb_xfer = USB_XFER_TRACE;
+            break;
+#endif
+        case USB_STREAM_REQ_VIDEO:
+            usb_xfer = USB_XFER_VIDEO;
+            break;
+        case USB_STREAM_REQ_ABORT:
+            usb_xfer = USB_XFER_NONE;
+            break;
+        default:
+            return;
+    }
+    usb_xfer_step = 0;
+    usb_xfer_pos  = 0;
+}
+
+// Called on the render core: TinyUSB's IRQ is handled by the core which initialized it.
+void usb_stream_init(void)
+{
+    tusb_init();
+    // below the DVI DMA IRQ, which must never be delayed
+    irq_set_priority(USBCTRL_IRQ, PICO_LOWEST_IRQ_PRIORITY);
+}
+
+// Called once per frame on the render core, after the frame was rendered. Transfers which do not
+// fit into the frame's budget continue in the next frame.
+void DELAYED_COPY_CODE(usb_stream_frame)(void)
+{
+    usb_frame_start = time_us_32();
+    usb_budget      = USB_STREAM_FRAME_BYTES;
+    tud_task();
+
+    if (!tud_cdc_connected())
+    {
+        usb_xfer = USB_XFER_NONE;
+#ifdef FEATURE_MOCKINGBOARD
+        usb_audio = false;
+#endif
+        return;
+    }
+
+    while (tud_cdc_available())
+        usb_stream_request(tud_cdc_read_char());
+
+#ifdef FEATURE_MOCKINGBOARD
+    // audio goes first: it must keep up with the synthesis
+    if (usb_audio)
+        usb_stream_audio();
+#endif
+    if ((frame_counter % USB_STREAM_COUNTER_FRAMES) == 0)
+        usb_stream_counters();
+
+    bool busy = false;
+    switch(usb_xfer)
+    {
+#ifdef FEATURE_BUS_TRACE
+        case USB_XFER_TRACE:
+            busy = usb_stream_trace();
+            break;
+#endif
+        case USB_XFER_VIDEO:
+            busy = usb_stream_video();
+            break;
+        default:
+            break;
+    }
+    if (!busy)
+        usb_xfer = USB_XFER_NONE;
+
+    tud_cdc_write_flush();
+}
+
+#endif // FEATURE_USB_STREAM
@@ -0,0 +1,104 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// USB streaming channel (FEATURE_USB_STREAM).
+// A CDC interface on the Pico's USB port streams telemetry, bus traces and the displayed video pages
+// to a host (tools/usb_stream.py). The channel is serviced on the render core, once per frame after
+// the frame was rendered, and never on the bus core. A rate limiter caps the bytes and the time
+// spent per frame, and packets are only queued while the USB FIFO has room, so a slow or missing
+// host never stalls the render loop. Payloads are written directly from the RAM they live in (trace
+// ring, shadow memory, PCM ring): there are no staging buffers.
+#define USB_STREAM_FRAME_BYTES    2048 // bytes queued per frame at most (~120KB/s at 60Hz, see tusb_config.h)
+#define USB_STREAM_FRAME_US       100  // time spent per frame at most
+#define USB_STREAM_CHUNK          512  // maximum payload of a packet
+#define USB_STREAM_COUNTER_FRAMES 30   // frames between telemetry packets
+
+// Packet format (little endian): a header, followed by 'size' bytes of payload.
+#define USB_STREAM_MAGIC 0xA2D5
+
+typedef enum
+{
+    USB_STREAM_COUNTERS     = 1, // usb_stream_counters_t
+    USB_STREAM_TRACE_HEADER = 2, // bus_trace_header_t, starts a trace
+    USB_STREAM_TRACE_VALUES = 3, // raw bus words, 'arg': record number of the first word
+    USB_STREAM_TRACE_DELTAS = 4, // 16bit cycle deltas, 'arg': record number of the first delta
+    USB_STREAM_VIDEO_HEADER = 5, // usb_stream_video_t, starts a video snapshot
+    USB_STREAM_VIDEO_DATA   = 6, // shadow memory, 'arg': Apple address | (aux << 16)
+    USB_STREAM_VIDEO_END    = 7, // no payload, 'arg': frame counter at the end of the snapshot
+    USB_STREAM_AUDIO        = 8, // 16bit stereo samples of the Mockingboard, 'arg': sample number of the first
+} usb_stream_type_t;
+
+typedef struct
+{
+    uint16_t magic;
+    uint8_t  type;          // usb_stream_type_t
+    uint8_t  seq;           // packet sequence number, to detect losses
+    uint16_t size;          // payload size
+    uint16_t reserved;
+    uint32_t arg;
+} usb_stream_header_t;
+
+// Telemetry. Counters of disabled features are zero.
+typedef struct
+{
+    uint32_t time_us;
+    uint32_t frame_counter;
+    uint32_t bus_counter;
+    uint32_t bus_overflow_counter;
+    uint32_t reset_counter;
+    uint32_t devicereg_counter;
+    uint32_t soft_switches;
+    uint32_t internal_flags;
+    uint32_t bus_busy_percent;    // FEATURE_BUS_STATS
+    uint32_t bus_max_cycles;
+    uint32_t dvi_late_lines;      // FEATURE_DVI_STATS
+    uint32_t render_idle_percent;
+    uint32_t trace_count;         // FEATURE_BUS_TRACE: words in the ring
+    uint32_t stream_dropped;      // packets not queued: no room in the USB FIFO
+    uint32_t audio_synth_us;      // FEATURE_MOCKINGBOARD: synthesis time per second of audio
+    uint32_t audio_dropped;       // AY register writes lost
+} usb_stream_counters_t;
+
+// Start of a video snapshot: the displayed pages follow as USB_STREAM_VIDEO_DATA packets.
+typedef struct
+{
+    uint32_t frame_counter;
+    uint32_t soft_switches;
+    uint32_t internal_flags;
+} usb_stream_video_t;
+
+// Host requests (single characters received on the CDC interface)
+#define USB_STREAM_REQ_TRACE 'T' // send the bus trace ring (only while the recorder is stopped)
+#define USB_STREAM_REQ_VIDEO 'V' // send a snapshot of the displayed video pages
+#define USB_STREAM_REQ_ABORT 'X' // abort the current transfer
+#define USB_STREAM_REQ_AUDIO 'A' // start/stop streaming the Mockingboard audio (AUDIO_SAMPLE_RATE)
+
+#ifdef FEATURE_USB_STREAM
+void usb_stream_init(void);
+void usb_stream_frame(void);
+#endif
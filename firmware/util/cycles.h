@@ -0,0 +1,60 @@
+/*
+MIT License
+
+Copyright (c) 2024 Thorsten Brehm
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "pico/stdlib.h"
+#include "hardware/structs/systick.h"
+
+// Per-core CPU cycle counter: each core's SysTick timer runs freely, counting processor clock
+// cycles down through 24 bits (about 130ms at 126MHz). Measured spans must be shorter than that.
+#define CYCLE_COUNTER_MASK 0x00ffffff
+
+// Start the calling core's counter. Every module timing code on that core calls this. A counter
+// which already runs is left alone, so one module's init does not disturb another's measurement.
+static inline void cycle_counter_init(void)
+{
+    if (((systick_hw->csr & 0x7) == 0x5) && (systick_hw->rvr == CYCLE_COUNTER_MASK))
+        return;
+    systick_hw->rvr = CYCLE_COUNTER_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5; // enabled, counting processor clock cycles
+}
+
+static __force_inline uint32_t cycle_counter_now(void)
+{
+    return systick_hw->cvr;
+}
+
+// cycles elapsed from 'start' until 'end' (both from cycle_counter_now)
+static __force_inline uint32_t cycle_counter_between(uint32_t start, uint32_t end)
+{
+    return (start - end) & CYCLE_COUNTER_MASK;
+}
+
+// cycles elapsed since 'start'
+static __force_inline uint32_t cycle_counter_since(uint32_t start)
+{
+    return cycle_counter_between(start, systick_hw->cvr);
+}
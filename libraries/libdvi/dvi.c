@@ -33,6 +33,7 @@ void dvi_init(struct dvi_inst *inst, uint spinlock_tmds_queue, uint spinlock_col
 	}
 	inst->late_scanline_ctr = 0;
 	inst->scanline_emulation = 0;
+	inst->mono_black = NULL;
 	inst->tmds_buf_release_next = NULL;
 	inst->tmds_buf_release = NULL;
 	queue_init_with_spinlock(&inst->q_tmds_valid,   sizeof(void*),  8, spinlock_tmds_queue);
@@ -184,6 +185,20 @@ void __dvi_func(dvi_scanbuf_main_16bpp)(struct dvi_inst *inst) {
 }
 #endif // DISABLED: not used by A2DVI
 
+// Point the active scanline's lanes at a single-lane (monochrome) line or at the black line
+static inline void __attribute__((always_inline)) dvi_update_mono_scanline_dma(struct dvi_inst *inst, uintptr_t tagged_line)
+{
+	const uint32_t *line = (const uint32_t*)(tagged_line & ~DVI_MONO_LINE_TAGS);
+	const uint lanes = (tagged_line & DVI_MONO_LINE_ALL_LANES) ? 0x7 : 0x2; // bit 0: blue/sync lane
+	for (int i = 0; i < N_TMDS_LANES; ++i) {
+		const uint32_t *lane_tmdsbuf = (lanes & (1u << i)) ? line : inst->mono_black;
+		if (i == TMDS_SYNC_LANE)
+			dvi_lane_from_list(&inst->dma_list_active, i)[3].read_addr = lane_tmdsbuf;
+		else
+			dvi_lane_from_list(&inst->dma_list_active, i)[1].read_addr = lane_tmdsbuf;
+	}
+}
+
 static void __dvi_func(dvi_dma_irq_handler)(struct dvi_inst *inst)
 {
 	// Every fourth interrupt marks the start of the horizontal active region. We
@@ -207,7 +222,8 @@ static void __dvi_func(dvi_dma_irq_handler)(struct dvi_inst *inst)
 	{
 		// If we displayed this buffer then it would be in the wrong vertical
 		// position on-screen. Just pass it back.
-		queue_add_blocking_u32(&inst->q_tmds_free, &tmdsbuf);
+		if (!((uintptr_t)tmdsbuf & DVI_MONO_LINE_TAG))
+			queue_add_blocking_u32(&inst->q_tmds_free, &tmdsbuf);
 		--inst->late_scanline_ctr;
 	}
 
@@ -225,7 +241,8 @@ static void __dvi_func(dvi_dma_irq_handler)(struct dvi_inst *inst)
 	{
 		if (inst->timing_state.v_ctr % DVI_VERTICAL_REPEAT == DVI_VERTICAL_REPEAT - 1) {
 			queue_remove_blocking_u32(&inst->q_tmds_valid, &tmdsbuf);
-			inst->tmds_buf_release_next = tmdsbuf;
+			if (!((uintptr_t)tmdsbuf & DVI_MONO_LINE_TAG))
+				inst->tmds_buf_release_next = tmdsbuf;
 		}
 	}
 	else {
@@ -237,6 +254,11 @@ static void __dvi_func(dvi_dma_irq_handler)(struct dvi_inst *inst)
 
 	switch (inst->timing_state.v_state) {
 		case DVI_STATE_ACTIVE:
+			if ((uintptr_t)tmdsbuf & DVI_MONO_LINE_TAG) {
+				dvi_update_mono_scanline_dma(inst, (uintptr_t)tmdsbuf);
+				_dvi_load_dma_op(inst->dma_cfg, &inst->dma_list_active);
+			}
+			else
 			if (tmdsbuf) {
 				dvi_update_scanline_data_dma(inst->timing, tmdsbuf, &inst->dma_list_active);
 				_dvi_load_dma_op(inst->dma_cfg, &inst->dma_list_active);
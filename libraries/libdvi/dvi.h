@@ -19,6 +19,11 @@ extern "C" {
 typedef void (*dvi_callback_t)(void);
 #endif
 
+// Tags in the low bits of queued single-lane (monochrome) line pointers, see dvi_inst.mono_black
+#define DVI_MONO_LINE_TAG       ((uintptr_t)1) // single-lane line
+#define DVI_MONO_LINE_ALL_LANES ((uintptr_t)2) // all lanes read the line, otherwise only the green lane
+#define DVI_MONO_LINE_TAGS      (DVI_MONO_LINE_TAG | DVI_MONO_LINE_ALL_LANES)
+
 struct dvi_inst {
 	// Config ---
 	const struct dvi_timing *timing;
@@ -47,6 +52,14 @@ struct dvi_inst {
 	uint late_scanline_ctr;
 	uint8_t scanline_emulation;
 
+	// Single-lane (monochrome) scanlines, e.g. from a line cache: queued in q_tmds_valid
+	// with DVI_MONO_LINE_TAG set in the pointer. The lanes selected by DVI_MONO_LINE_ALL_LANES
+	// read the line, the others read mono_black. The lanes travel with each queued line, so
+	// lines of the previous frame are still shown correctly after a change of the color mode.
+	// These lines are never passed to q_tmds_free, since they are not owned by the TMDS
+	// buffer pool.
+	const uint32_t *mono_black;
+
 	// Encoded scanlines:
 	queue_t q_tmds_valid;
 	queue_t q_tmds_free;
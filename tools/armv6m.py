@@ -0,0 +1,877 @@
+#!/usr/bin/env python3
+
+# MIT License
+# Copyright (c) 2024 Thorsten Brehm
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Instruction-level model of the RP2040's Cortex-M0+ (ARMv6-M), used by cycle_model.py.
+# Links the firmware's ARM object files (ELF relocatable, e.g. from the CMake build tree) into a flat
+# memory image and runs single functions with cycle counting:
+#  * placement as in scripts/copy_to_ram_custom_rp2040.ld: everything runs from RAM, except the
+#    .flashdata sections (fonts), which stay in flash
+#  * instruction timing of the Cortex-M0+ technical reference manual, with the RP2040's single
+#    cycle multiplier: loads/stores 2, LDM/STM/PUSH/POP 1+N, POP {pc} 3+N, taken branches 2, BL 3
+#  * memory has no wait states. Not modeled: XIP cache misses (counted as flash reads instead),
+#    peripheral wait states and bus contention with the DMA.
+#  * undefined symbols (SDK functions and data) get a 4KB block of zeroed memory each. Calling one
+#    runs its Python hook (see Image.hook), or returns 0 at no cost.
+# The SysTick timer (0xE000E010) counts the model's cycles, so the firmware's own cycle counter
+# (util/cycles.h) works as on the device. SIO spinlocks are always free, the SIO CPUID register
+# returns the core number given to Cpu(). Other peripheral registers read as 0 unless a harness
+# provides them (Cpu.io_reads/io_writes).
+
+import glob
+import os
+import struct
+
+M32 = 0xffffffff
+
+RAM_BASE    = 0x20000000
+RAM_SIZE    = 0x00400000 # generous: the model does not enforce the RP2040's 264KB
+FLASH_BASE  = 0x10000000
+FLASH_SIZE  = 0x00100000
+EXTERN_BASE = 0x20400000 # within BL range of the RAM image
+EXTERN_SIZE = 0x00400000
+EXTERN_BLOCK = 0x1000
+RETURN_ADDR = 0x3ffffff0 # returning here ends Cpu.call()
+
+SYSTICK_CSR = 0xe000e010
+SYSTICK_RVR = 0xe000e014
+SYSTICK_CVR = 0xe000e018
+SIO_CPUID   = 0xd0000000
+SIO_SPINLOCK0 = 0xd0000100
+
+R_ARM_ABS32     = 2
+R_ARM_REL32     = 3
+R_ARM_THM_CALL  = 10
+R_ARM_THM_JUMP24 = 30
+R_ARM_THM_JUMP11 = 102
+R_ARM_THM_JUMP8 = 103
+R_ARM_PREL31    = 42
+R_ARM_V4BX      = 40
+R_ARM_NONE      = 0
+
+SHT_PROGBITS = 1
+SHT_SYMTAB   = 2
+SHT_NOBITS   = 8
+SHT_REL      = 9
+SHF_ALLOC    = 2
+SHN_UNDEF    = 0
+SHN_ABS      = 0xfff1
+SHN_COMMON   = 0xfff2
+STB_LOCAL    = 0
+STB_WEAK     = 2
+STT_FUNC     = 2
+STT_SECTION  = 3
+
+
+class ModelError(Exception):
+    pass
+
+
+class ElfObject:
+    """Sections, symbols and relocations of one ELF32 little endian relocatable object."""
+    def __init__(self, path):
+        self.path = path
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            raise ModelError("%s: not an ELF32 little endian file" % path)
+        (e_type, e_machine, _, _, _, e_shoff, _, _, _, _, e_shentsize, e_shnum, e_shstrndx) = \
+            struct.unpack_from("<HHIIIIIHHHHHH", data, 16)
+        if e_type != 1 or e_machine != 40:
+            raise ModelError("%s: not an ARM relocatable object" % path)
+        self.sections = []
+        for i in range(e_shnum):
+            name, typ, flags, _, offset, size, link, info, align, entsize = \
+                struct.unpack_from("<IIIIIIIIII", data, e_shoff + i*e_shentsize)
+            self.sections.append({"name": name, "type": typ, "flags": flags, "offset": offset,
+                                  "size": size, "link": link, "info": info, "align": max(align, 1),
+                                  "data": data[offset:offset+size] if typ != SHT_NOBITS else None})
+        strtab = self.sections[e_shstrndx]["data"]
+        for s in self.sections:
+            s["name"] = strtab[s["name"]:strtab.index(b"\0", s["name"])].decode()
+        self.symbols = []
+        self.relocations = {} # section index: [(offset, type, symbol index)]
+        for i, s in enumerate(self.sections):
+            if s["type"] == SHT_SYMTAB:
+                names = self.sections[s["link"]]["data"]
+                for o in range(0, s["size"], 16):
+                    st_name, value, size, info, other, shndx = struct.unpack_from("<IIIBBH", s["data"], o)
+                    name = names[st_name:names.index(b"\0", st_name)].decode()
+                    self.symbols.append({"name": name, "value": value, "size": size, "bind": info >> 4,
+                                         "type": info & 15, "shndx": shndx})
+            elif s["type"] == SHT_REL:
+                self.relocations[s["info"]] = [struct.unpack_from("<II", s["data"], o)
+                                               for o in range(0, s["size"], 8)]
+
+    def loaded_sections(self):
+        for i, s in enumerate(self.sections):
+            if (s["flags"] & SHF_ALLOC) and (not s["name"].startswith(".ARM.exidx")) and \
+               (not s["name"].startswith(".ARM.extab")):
+                yield i, s
+
+
+def in_flash(section_name):
+    """Copy-to-RAM binary: only the .flashdata sections remain in flash (see the linker script)."""
+    return section_name.startswith(".flashdata")
+
+
+class Image:
+    """A flat memory image linked from ARM object files."""
+    def __init__(self, paths):
+        self.ram = bytearray(RAM_SIZE)
+        self.flash = bytearray(FLASH_SIZE)
+        self.extern = bytearray(EXTERN_SIZE)
+        self.globals = {}
+        self.locals = {}    # name: [addresses] (static functions/data, may be ambiguous)
+        self.hooks = {}     # address: function(cpu)
+        self.externs = {}   # undefined symbol: address
+        self.symbol_names = {}
+        self.sizes = {}     # section name: bytes
+        self.objects = [ElfObject(p) for p in paths]
+        self._strong = set()
+        self._link()
+
+    def _place(self, size, align, flash):
+        if flash:
+            addr = (self.flash_top + align - 1) & ~(align - 1)
+            self.flash_top = addr + size
+            if self.flash_top > FLASH_BASE + FLASH_SIZE:
+                raise ModelError("flash image too large")
+        else:
+            addr = (self.ram_top + align - 1) & ~(align - 1)
+            self.ram_top = addr + size
+            if self.ram_top > RAM_BASE + RAM_SIZE:
+                raise ModelError("RAM image too large")
+        return addr
+
+    def _link(self):
+        self.ram_top = RAM_BASE
+        self.flash_top = FLASH_BASE
+        self.extern_top = EXTERN_BASE
+        # place the sections
+        for obj in self.objects:
+            obj.addr = {}
+            for i, s in obj.loaded_sections():
+                addr = self._place(s["size"], s["align"], in_flash(s["name"]))
+                obj.addr[i] = addr
+                if s["data"] is not None:
+                    self.write_bytes(addr, s["data"])
+                key = s["name"].split(".")[1] if s["name"].count(".") > 1 else s["name"].lstrip(".")
+                self.sizes[key] = self.sizes.get(key, 0) + s["size"]
+        # symbols: globals first (strong before weak), COMMON symbols get allocated
+        for obj in self.objects:
+            obj.symaddr = []
+            for sym in obj.symbols:
+                addr = None
+                if sym["shndx"] == SHN_COMMON:
+                    if sym["name"] not in self.globals:
+                        self.globals[sym["name"]] = self._place(sym["size"], max(sym["value"], 4), False)
+                    addr = self.globals[sym["name"]]
+                elif sym["shndx"] == SHN_ABS:
+                    addr = sym["value"]
+                elif sym["shndx"] != SHN_UNDEF and sym["shndx"] in obj.addr:
+                    addr = obj.addr[sym["shndx"]] + sym["value"]
+                    if sym["type"] == STT_FUNC:
+                        addr |= 1
+                obj.symaddr.append(addr)
+                if addr is None or not sym["name"] or sym["type"] == STT_SECTION:
+                    continue
+                if sym["bind"] == STB_LOCAL:
+                    self.locals.setdefault(sym["name"], []).append(addr)
+                elif sym["shndx"] == SHN_COMMON:
+                    pass
+                elif sym["bind"] == STB_WEAK:
+                    self.globals.setdefault(sym["name"], addr)
+                else:
+                    if sym["name"] in self._strong:
+                        raise ModelError("duplicate symbol %s" % sym["name"])
+                    self.globals[sym["name"]] = addr
+                    self._strong.add(sym["name"])
+                if not sym["name"].startswith("$"):
+                    self.symbol_names[addr & ~1] = sym["name"]
+        # relocations
+        for obj in self.objects:
+            for i, s in obj.loaded_sections():
+                for offset, info in obj.relocations.get(i, []):
+                    self._relocate(obj, obj.addr[i] + offset, info & 0xff, info >> 8)
+
+    def _symbol(self, obj, index):
+        addr = obj.symaddr[index]
+        if addr is not None:
+            return addr
+        name = obj.symbols[index]["name"]
+        if name in self.globals:
+            return self.globals[name]
+        if name not in self.externs:
+            # undefined: a block of zeroed memory, which also serves as a hook address
+            self.externs[name] = self.extern_top
+            self.symbol_names[self.extern_top] = name
+            self.extern_top += EXTERN_BLOCK
+        return self.externs[name]
+
+    def _relocate(self, obj, place, typ, index):
+        if typ in (R_ARM_NONE, R_ARM_V4BX, R_ARM_PREL31):
+            return
+        sym = obj.symbols[index]
+        S = self._symbol(obj, index)
+        if typ == R_ARM_ABS32:
+            A = self.read32(place)
+            if sym["type"] == STT_FUNC or (S >= EXTERN_BASE and S < EXTERN_BASE + EXTERN_SIZE and self._is_call_target(sym)):
+                S |= 1
+            self.write32(place, (S + A) & M32)
+        elif typ == R_ARM_REL32:
+            A = self.read32(place)
+            self.write32(place, (S + A - place) & M32)
+        elif typ in (R_ARM_THM_CALL, R_ARM_THM_JUMP24):
+            hi, lo = self.read16(place), self.read16(place+2)
+            s = (hi >> 10) & 1
+            i1 = 1 - (((lo >> 13) & 1) ^ s)
+            i2 = 1 - (((lo >> 11) & 1) ^ s)
+            A = (s << 24) | (i1 << 23) | (i2 << 22) | ((hi & 0x3ff) << 12) | ((lo & 0x7ff) << 1)
+            if s:
+                A -= 1 << 25
+            value = ((S & ~1) + A - place) & M32
+            if value >= 0x80000000:
+                value -= 1 << 32
+            if not -(1 << 24) <= value < (1 << 24):
+                raise ModelError("branch out of range to %s" % sym["name"])
+            s = (value >> 24) & 1
+            j1 = (1 - ((value >> 23) & 1)) ^ s
+            j2 = (1 - ((value >> 22) & 1)) ^ s
+            self.write16(place, (hi & 0xf800) | (s << 10) | ((value >> 12) & 0x3ff))
+            self.write16(place+2, (lo & 0xd000) | (j1 << 13) | (j2 << 11) | ((value >> 1) & 0x7ff))
+        elif typ == R_ARM_THM_JUMP11:
+            hw = self.read16(place)
+            A = ((hw & 0x7ff) << 1)
+            if A & 0x800:
+                A -= 0x1000
+            value = (S & ~1) + A - place
+            self.write16(place, (hw & 0xf800) | ((value >> 1) & 0x7ff))
+        elif typ == R_ARM_THM_JUMP8:
+            hw = self.read16(place)
+            A = ((hw & 0xff) << 1)
+            if A & 0x100:
+                A -= 0x200
+            value = (S & ~1) + A - place
+            self.write16(place, (hw & 0xff00) | ((value >> 1) & 0xff))
+        else:
+            raise ModelError("%s: unsupported relocation type %d" % (obj.path, typ))
+
+    @staticmethod
+    def _is_call_target(sym):
+        # undefined symbols referenced by address: function pointers need the Thumb bit. Data
+        # symbols are never called, so the bit only matters for the ones which are.
+        return sym["type"] == STT_FUNC
+
+    # --- symbols
+
+    def sym(self, name):
+        """Address of a global or (unambiguous) static symbol; functions have the Thumb bit set."""
+        if name in self.globals:
+            return self.globals[name]
+        if name in self.externs:
+            return self.externs[name]
+        found = self.locals.get(name, [])
+        if len(found) == 1:
+            return found[0]
+        if not found:
+            raise ModelError("undefined symbol %s" % name)
+        raise ModelError("ambiguous static symbol %s" % name)
+
+    def has(self, name):
+        return (name in self.globals) or (len(self.locals.get(name, [])) == 1)
+
+    def hook(self, name, function):
+        """Run function(cpu) instead of the (undefined) function 'name'. It returns r0 (or None)."""
+        if name in self.globals:
+            addr = self.globals[name]
+        else:
+            if name not in self.externs:
+                self.externs[name] = self.extern_top
+                self.symbol_names[self.extern_top] = name
+                self.extern_top += EXTERN_BLOCK
+            addr = self.externs[name]
+        self.hooks[addr & ~1] = function
+
+    # --- memory
+
+    def region(self, addr):
+        if RAM_BASE <= addr < RAM_BASE + RAM_SIZE:
+            return self.ram, addr - RAM_BASE
+        if FLASH_BASE <= addr < FLASH_BASE + FLASH_SIZE:
+            return self.flash, addr - FLASH_BASE
+        if EXTERN_BASE <= addr < EXTERN_BASE + EXTERN_SIZE:
+            return self.extern, addr - EXTERN_BASE
+        return None, addr
+
+    def read_bytes(self, addr, size):
+        mem, o = self.region(addr)
+        if mem is None:
+            raise ModelError("read from unmapped 0x%08x" % addr)
+        return bytes(mem[o:o+size])
+
+    def write_bytes(self, addr, data):
+        mem, o = self.region(addr)
+        if mem is None:
+            raise ModelError("write to unmapped 0x%08x" % addr)
+        mem[o:o+len(data)] = data
+
+    def read32(self, addr):
+        return struct.unpack("<I", self.read_bytes(addr, 4))[0]
+
+    def read16(self, addr):
+        return struct.unpack("<H", self.read_bytes(addr, 2))[0]
+
+    def write32(self, addr, value):
+        self.write_bytes(addr, struct.pack("<I", value & M32))
+
+    def write16(self, addr, value):
+        self.write_bytes(addr, struct.pack("<H", value & 0xffff))
+
+    def alloc(self, size, align=4):
+        """Zeroed scratch memory in RAM, for test data."""
+        addr = self._place(size, align, False)
+        self.ram[addr-RAM_BASE:addr-RAM_BASE+size] = bytes(size)
+        return addr
+
+
+def object_files(paths):
+    """Object files in the given files/directories (CMake: *.obj, others: *.o)."""
+    found = []
+    for p in paths:
+        if os.path.isdir(p):
+            for ext in ("obj", "o"):
+                found += glob.glob(os.path.join(p, "**", "*." + ext), recursive=True)
+        else:
+            found.append(p)
+    return sorted(found)
+
+
+class Cpu:
+    """ARMv6-M core with Cortex-M0+ cycle counts."""
+    def __init__(self, image, core=0):
+        self.image = image
+        self.core = core
+        self.r = [0]*16
+        self.n = self.z = self.c = self.v = 0
+        self.cycles = 0
+        self.instructions = 0
+        self.flash_reads = 0
+        self.io_reads = {}   # address: value or function(cpu) for peripheral reads
+        self.io_writes = {}  # address: function(cpu, value)
+        self.wfe = None      # function(cpu) called by WFE
+        self.systick_cvr = 0
+        self.systick_at = 0
+        self.decoded = {}
+        self.stack_top = image.alloc(0x2000, 8) + 0x2000
+
+    # --- memory access (loads/stores of the instructions)
+
+    def load(self, addr, size):
+        mem = self.image.ram
+        o = addr - RAM_BASE
+        if 0 <= o < RAM_SIZE:
+            return int.from_bytes(mem[o:o+size], "little")
+        mem, o = self.image.region(addr)
+        if mem is not None:
+            if mem is self.image.flash:
+                self.flash_reads += 1
+            return int.from_bytes(mem[o:o+size], "little")
+        return self.io_read(addr) & ((1 << (8*size)) - 1)
+
+    def store(self, addr, size, value):
+        o = addr - RAM_BASE
+        if 0 <= o < RAM_SIZE:
+            self.image.ram[o:o+size] = (value & ((1 << (8*size)) - 1)).to_bytes(size, "little")
+            return
+        mem, o = self.image.region(addr)
+        if mem is not None:
+            mem[o:o+size] = (value & ((1 << (8*size)) - 1)).to_bytes(size, "little")
+            return
+        self.io_write(addr, value)
+
+    def io_read(self, addr):
+        if addr == SYSTICK_CVR:
+            return (self.systick_cvr - (self.cycles - self.systick_at)) & 0xffffff
+        if addr == SYSTICK_RVR:
+            return 0xffffff
+        if addr == SYSTICK_CSR:
+            return 5
+        if addr == SIO_CPUID:
+            return self.core
+        if SIO_SPINLOCK0 <= addr < SIO_SPINLOCK0 + 32*4:
+            return 1 << ((addr - SIO_SPINLOCK0) // 4) # a single core: the lock is always free
+        value = self.io_reads.get(addr, 0)
+        return value(self) if callable(value) else value
+
+    def io_write(self, addr, value):
+        if addr == SYSTICK_CVR:
+            self.systick_cvr = 0
+            self.systick_at = self.cycles
+        elif addr in self.io_writes:
+            self.io_writes[addr](self, value)
+
+    # --- flags
+
+    def _nz(self, result):
+        self.n = result >> 31
+        self.z = 1 if result == 0 else 0
+
+    def _add(self, a, b, carry):
+        full = a + b + carry
+        result = full & M32
+        self.n = result >> 31
+        self.z = 1 if result == 0 else 0
+        self.c = 1 if full > M32 else 0
+        self.v = 1 if ((a ^ result) & (b ^ result)) >> 31 else 0
+        return result
+
+    def _cond(self, cond):
+        if cond == 0:  return self.z
+        if cond == 1:  return not self.z
+        if cond == 2:  return self.c
+        if cond == 3:  return not self.c
+        if cond == 4:  return self.n
+        if cond == 5:  return not self.n
+        if cond == 6:  return self.v
+        if cond == 7:  return not self.v
+        if cond == 8:  return self.c and not self.z
+        if cond == 9:  return (not self.c) or self.z
+        if cond == 10: return self.n == self.v
+        if cond == 11: return self.n != self.v
+        if cond == 12: return (not self.z) and (self.n == self.v)
+        if cond == 13: return self.z or (self.n != self.v)
+        return True
+
+    # --- execution
+
+    def call(self, function, *args, max_cycles=50000000):
+        """Call a function (address or symbol name) with up to 4 word arguments, returns r0."""
+        if isinstance(function, str):
+            function = self.image.sym(function)
+        if len(args) > 4:
+            raise ModelError("only 4 arguments are supported")
+        for i, a in enumerate(args):
+            self.r[i] = a & M32
+        self.r[13] = self.stack_top
+        self.r[14] = RETURN_ADDR | 1
+        pc = function & ~1
+        limit = self.cycles + max_cycles
+        r = self.r
+        hooks = self.image.hooks
+        decoded = self.decoded
+        while pc != RETURN_ADDR:
+            if pc in hooks:
+                result = hooks[pc](self)
+                if result is not None:
+                    r[0] = result & M32
+                pc = r[14] & ~1
+                continue
+            op = decoded.get(pc)
+            if op is None:
+                op = decoded[pc] = self._decode(pc)
+            pc = op(self)
+            self.instructions += 1
+            if self.cycles > limit:
+                raise ModelError("no return after %d cycles (pc 0x%08x)" % (max_cycles, pc))
+        return r[0]
+
+    def _decode(self, pc):
+        image = self.image
+        mem, o = image.region(pc)
+        if mem is None:
+            raise ModelError("executing unmapped 0x%08x" % pc)
+        if mem is image.extern:
+            # undefined function without hook: return 0
+            name = image.symbol_names.get(pc, "0x%08x" % pc)
+            def op(cpu, name=name):
+                cpu.r[0] = 0
+                return cpu.r[14] & ~1
+            return op
+        hw = int.from_bytes(mem[o:o+2], "little")
+        nxt = pc + 2
+        pcv = pc + 4 # value of PC read by the instruction
+        top5 = hw >> 11
+
+        if top5 < 3:
+            # LSLS/LSRS/ASRS (immediate)
+            kind, imm, rm, rd = top5, (hw >> 6) & 31, (hw >> 3) & 7, hw & 7
+            if kind == 0:
+                if imm == 0:
+                    def op(cpu):
+                        v = cpu.r[rm]; cpu.r[rd] = v; cpu._nz(v); cpu.cycles += 1; return nxt
+                else:
+                    def op(cpu):
+                        v = cpu.r[rm]; cpu.c = (v >> (32-imm)) & 1; v = (v << imm) & M32
+                        cpu.r[rd] = v; cpu._nz(v); cpu.cycles += 1; return nxt
+            elif kind == 1:
+                sh = imm or 32
+                def op(cpu):
+                    v = cpu.r[rm]; cpu.c = (v >> (sh-1)) & 1; v = v >> sh
+                    cpu.r[rd] = v; cpu._nz(v); cpu.cycles += 1; return nxt
+            else:
+                sh = imm or 32
+                def op(cpu):
+                    v = cpu.r[rm]; sv = v - (1 << 32) if v >> 31 else v
+                    cpu.c = (sv >> (sh-1)) & 1; v = (sv >> sh) & M32
+                    cpu.r[rd] = v; cpu._nz(v); cpu.cycles += 1; return nxt
+            return op
+        if top5 == 3:
+            sub, imm_op = (hw >> 9) & 1, (hw >> 10) & 1
+            x, rn, rd = (hw >> 6) & 7, (hw >> 3) & 7, hw & 7
+            def op(cpu):
+                b = x if imm_op else cpu.r[x]
+                if sub:
+                    cpu.r[rd] = cpu._add(cpu.r[rn], (~b) & M32, 1)
+                else:
+                    cpu.r[rd] = cpu._add(cpu.r[rn], b, 0)
+                cpu.cycles += 1
+                return nxt
+            return op
+        if top5 < 8:
+            kind, rd, imm = top5 & 3, (hw >> 8) & 7, hw & 0xff
+            if kind == 0:
+                def op(cpu):
+                    cpu.r[rd] = imm; cpu._nz(imm); cpu.cycles += 1; return nxt
+            elif kind == 1:
+                def op(cpu):
+                    cpu._add(cpu.r[rd], (~imm) & M32, 1); cpu.cycles += 1; return nxt
+            elif kind == 2:
+                def op(cpu):
+                    cpu.r[rd] = cpu._add(cpu.r[rd], imm, 0); cpu.cycles += 1; return nxt
+            else:
+                def op(cpu):
+                    cpu.r[rd] = cpu._add(cpu.r[rd], (~imm) & M32, 1); cpu.cycles += 1; return nxt
+            return op
+        if (hw >> 10) == 0x10:
+            return self._decode_dp(hw, nxt)
+        if (hw >> 10) == 0x11:
+            return self._decode_special(hw, pc, nxt, pcv)
+        if top5 == 9:
+            rt, addr = (hw >> 8) & 7, (pcv & ~3) + (hw & 0xff)*4
+            def op(cpu):
+                cpu.r[rt] = cpu.load(addr, 4); cpu.cycles += 2; return nxt
+            return op
+        if (hw >> 12) == 5:
+            kind, rm, rn, rt = (hw >> 9) & 7, (hw >> 6) & 7, (hw >> 3) & 7, hw & 7
+            size = (4, 2, 1, 1, 4, 2, 1, 2)[kind]
+            if kind < 3:
+                def op(cpu):
+                    cpu.store((cpu.r[rn] + cpu.r[rm]) & M32, size, cpu.r[rt]); cpu.cycles += 2; return nxt
+            else:
+                signed = kind in (3, 7)
+                def op(cpu):
+                    v = cpu.load((cpu.r[rn] + cpu.r[rm]) & M32, size)
+                    if signed and v >> (8*size-1):
+                        v = (v - (1 << (8*size))) & M32
+                    cpu.r[rt] = v; cpu.cycles += 2; return nxt
+            return op
+        if (hw >> 13) == 3 or (hw >> 12) == 8:
+            if (hw >> 12) == 8:
+                size, load = 2, (hw >> 11) & 1
+            else:
+                size, load = (1 if (hw >> 12) & 1 else 4), (hw >> 11) & 1
+            imm, rn, rt = ((hw >> 6) & 31)*size, (hw >> 3) & 7, hw & 7
+            if load:
+                def op(cpu):
+                    cpu.r[rt] = cpu.load((cpu.r[rn] + imm) & M32, size); cpu.cycles += 2; return nxt
+            else:
+                def op(cpu):
+                    cpu.store((cpu.r[rn] + imm) & M32, size, cpu.r[rt]); cpu.cycles += 2; return nxt
+            return op
+        if (hw >> 12) == 9:
+            load, rt, imm = (hw >> 11) & 1, (hw >> 8) & 7, (hw & 0xff)*4
+            if load:
+                def op(cpu):
+                    cpu.r[rt] = cpu.load((cpu.r[13] + imm) & M32, 4); cpu.cycles += 2; return nxt
+            else:
+                def op(cpu):
+                    cpu.store((cpu.r[13] + imm) & M32, 4, cpu.r[rt]); cpu.cycles += 2; return nxt
+            return op
+        if (hw >> 12) == 0xa:
+            rd, imm = (hw >> 8) & 7, (hw & 0xff)*4
+            if (hw >> 11) & 1:
+                def op(cpu):
+                    cpu.r[rd] = (cpu.r[13] + imm) & M32; cpu.cycles += 1; return nxt
+            else:
+                value = ((pcv & ~3) + imm) & M32
+                def op(cpu):
+                    cpu.r[rd] = value; cpu.cycles += 1; return nxt
+            return op
+        if (hw >> 12) == 0xb:
+            return self._decode_misc(hw, pc, nxt)
+        if (hw >> 12) == 0xc:
+            load, rn, regs = (hw >> 11) & 1, (hw >> 8) & 7, [i for i in range(8) if hw & (1 << i)]
+            count = len(regs)
+            if load:
+                writeback = rn not in regs
+                def op(cpu):
+                    a = cpu.r[rn]
+                    values = [cpu.load(a + 4*i, 4) for i in range(count)]
+                    if writeback:
+                        cpu.r[rn] = (a + 4*count) & M32
+                    for reg, v in zip(regs, values):
+                        cpu.r[reg] = v
+                    cpu.cycles += 1 + count
+                    return nxt
+            else:
+                def op(cpu):
+                    a = cpu.r[rn]
+                    for i, reg in enumerate(regs):
+                        cpu.store(a + 4*i, 4, cpu.r[reg])
+                    cpu.r[rn] = (a + 4*count) & M32
+                    cpu.cycles += 1 + count
+                    return nxt
+            return op
+        if (hw >> 12) == 0xd:
+            cond = (hw >> 8) & 15
+            if cond == 15:
+                raise ModelError("SVC at 0x%08x" % pc)
+            if cond == 14:
+                raise ModelError("UDF at 0x%08x" % pc)
+            off = hw & 0xff
+            if off & 0x80:
+                off -= 0x100
+            target = pcv + 2*off
+            def op(cpu):
+                if cpu._cond(cond):
+                    cpu.cycles += 2
+                    return target
+                cpu.cycles += 1
+                return nxt
+            return op
+        if top5 == 0x1c:
+            off = hw & 0x7ff
+            if off & 0x400:
+                off -= 0x800
+            target = pcv + 2*off
+            def op(cpu):
+                cpu.cycles += 2; return target
+            return op
+        if top5 == 0x1e:
+            lo = int.from_bytes(mem[o+2:o+4], "little")
+            return self._decode32(hw, lo, pc)
+        raise ModelError("undefined instruction 0x%04x at 0x%08x" % (hw, pc))
+
+    def _decode_dp(self, hw, nxt):
+        kind, rm, rdn = (hw >> 6) & 15, (hw >> 3) & 7, hw & 7
+        if kind == 0:
+            def op(cpu):
+                v = cpu.r[rdn] & cpu.r[rm]; cpu.r[rdn] = v; cpu._nz(v); cpu.cycles += 1; return nxt
+        elif kind == 1:
+            def op(cpu):
+                v = cpu.r[rdn] ^ cpu.r[rm]; cpu.r[rdn] = v; cpu._nz(v); cpu.cycles += 1; return nxt
+        elif kind in (2, 3, 4, 7):
+            def op(cpu):
+                v, sh = cpu.r[rdn], cpu.r[rm] & 0xff
+                if sh:
+                    if kind == 2:
+                        cpu.c = ((v >> (32-sh)) & 1) if sh <= 32 else 0
+                        v = (v << sh) & M32 if sh < 32 else 0
+                    elif kind == 3:
+                        cpu.c = ((v >> (sh-1)) & 1) if sh <= 32 else 0
+                        v = v >> sh if sh < 32 else 0
+                    elif kind == 4:
+                        sv = v - (1 << 32) if v >> 31 else v
+                        s = sh if sh < 32 else 32
+                        cpu.c = (sv >> (s-1)) & 1
+                        v = (sv >> s) & M32
+                    else:
+                        s = sh & 31
+                        if s:
+                            v = ((v >> s) | (v << (32-s))) & M32
+                        cpu.c = v >> 31
+                cpu.r[rdn] = v; cpu._nz(v); cpu.cycles += 1; return nxt
+        elif kind == 5:
+            def op(cpu):
+                cpu.r[rdn] = cpu._add(cpu.r[rdn], cpu.r[rm], cpu.c); cpu.cycles += 1; return nxt
+        elif kind == 6:
+            def op(cpu):
+                cpu.r[rdn] = cpu._add(cpu.r[rdn], (~cpu.r[rm]) & M32, cpu.c); cpu.cycles += 1; return nxt
+        elif kind == 8:
+            def op(cpu):
+                cpu._nz(cpu.r[rdn] & cpu.r[rm]); cpu.cycles += 1; return nxt
+        elif kind == 9:
+            def op(cpu):
+                cpu.r[rdn] = cpu._add((~cpu.r[rm]) & M32, 0, 1); cpu.cycles += 1; return nxt
+        elif kind == 10:
+            def op(cpu):
+                cpu._add(cpu.r[rdn], (~cpu.r[rm]) & M32, 1); cpu.cycles += 1; return nxt
+        elif kind == 11:
+            def op(cpu):
+                cpu._add(cpu.r[rdn], cpu.r[rm], 0); cpu.cycles += 1; return nxt
+        elif kind == 12:
+            def op(cpu):
+                v = cpu.r[rdn] | cpu.r[rm]; cpu.r[rdn] = v; cpu._nz(v); cpu.cycles += 1; return nxt
+        elif kind == 13:
+            def op(cpu):
+                v = (cpu.r[rdn] * cpu.r[rm]) & M32; cpu.r[rdn] = v; cpu._nz(v); cpu.cycles += 1; return nxt
+        elif kind == 14:
+            def op(cpu):
+                v = cpu.r[rdn] & ~cpu.r[rm] & M32; cpu.r[rdn] = v; cpu._nz(v); cpu.cycles += 1; return nxt
+        else:
+            def op(cpu):
+                v = (~cpu.r[rm]) & M32; cpu.r[rdn] = v; cpu._nz(v); cpu.cycles += 1; return nxt
+        return op
+
+    def _decode_special(self, hw, pc, nxt, pcv):
+        kind = (hw >> 8) & 3
+        rm = (hw >> 3) & 15
+        rdn = (hw & 7) | ((hw >> 4) & 8)
+        def get(cpu, reg):
+            return pcv if reg == 15 else cpu.r[reg]
+        if kind == 0:
+            def op(cpu):
+                v = (get(cpu, rdn) + get(cpu, rm)) & M32
+                if rdn == 15:
+                    cpu.cycles += 2; return v & ~1
+                cpu.r[rdn] = v; cpu.cycles += 1; return nxt
+        elif kind == 1:
+            def op(cpu):
+                cpu._add(get(cpu, rdn), (~get(cpu, rm)) & M32, 1); cpu.cycles += 1; return nxt
+        elif kind == 2:
+            def op(cpu):
+                v = get(cpu, rm)
+                if rdn == 15:
+                    cpu.cycles += 2; return v & ~1
+                cpu.r[rdn] = v; cpu.cycles += 1; return nxt
+        else:
+            link = (hw >> 7) & 1
+            rm = (hw >> 3) & 15
+            def op(cpu):
+                target = get(cpu, rm)
+                if not target & 1:
+                    raise ModelError("BX to ARM state at 0x%08x" % pc)
+                if link:
+                    cpu.r[14] = nxt | 1
+                cpu.cycles += 2
+                return target & ~1
+        return op
+
+    def _decode_misc(self, hw, pc, nxt):
+        if (hw >> 8) == 0xb0:
+            imm = (hw & 0x7f)*4
+            if hw & 0x80:
+                def op(cpu):
+                    cpu.r[13] = (cpu.r[13] - imm) & M32; cpu.cycles += 1; return nxt
+            else:
+                def op(cpu):
+                    cpu.r[13] = (cpu.r[13] + imm) & M32; cpu.cycles += 1; return nxt
+            return op
+        if (hw >> 8) == 0xb2:
+            kind, rm, rd = (hw >> 6) & 3, (hw >> 3) & 7, hw & 7
+            def op(cpu):
+                v = cpu.r[rm]
+                if kind == 0:
+                    v = v & 0xffff; v = (v - 0x10000) & M32 if v & 0x8000 else v
+                elif kind == 1:
+                    v = v & 0xff; v = (v - 0x100) & M32 if v & 0x80 else v
+                elif kind == 2:
+                    v = v & 0xffff
+                else:
+                    v = v & 0xff
+                cpu.r[rd] = v; cpu.cycles += 1; return nxt
+            return op
+        if (hw >> 9) == 0x5a:
+            regs = [i for i in range(8) if hw & (1 << i)] + ([14] if hw & 0x100 else [])
+            count = len(regs)
+            def op(cpu):
+                a = (cpu.r[13] - 4*count) & M32
+                for i, reg in enumerate(regs):
+                    cpu.store(a + 4*i, 4, cpu.r[reg])
+                cpu.r[13] = a; cpu.cycles += 1 + count; return nxt
+            return op
+        if (hw >> 9) == 0x5e:
+            regs = [i for i in range(8) if hw & (1 << i)]
+            count = len(regs) + (1 if hw & 0x100 else 0)
+            popc = hw & 0x100
+            def op(cpu):
+                a = cpu.r[13]
+                for i, reg in enumerate(regs):
+                    cpu.r[reg] = cpu.load(a + 4*i, 4)
+                cpu.r[13] = (a + 4*count) & M32
+                if popc:
+                    target = cpu.load(a + 4*len(regs), 4)
+                    cpu.cycles += 3 + count
+                    return target & ~1
+                cpu.cycles += 1 + count
+                return nxt
+            return op
+        if (hw >> 6) == 0x2e8 or (hw >> 6) == 0x2e9 or (hw >> 6) == 0x2eb:
+            kind, rm, rd = (hw >> 6) & 3, (hw >> 3) & 7, hw & 7
+            def op(cpu):
+                v = cpu.r[rm]
+                if kind == 0:
+                    v = int.from_bytes(v.to_bytes(4, "little"), "big")
+                elif kind == 1:
+                    v = ((v & 0x00ff00ff) << 8 | (v >> 8) & 0x00ff00ff) & M32
+                else:
+                    v = ((v & 0xff) << 8) | ((v >> 8) & 0xff)
+                    v = (v - 0x10000) & M32 if v & 0x8000 else v
+                cpu.r[rd] = v; cpu.cycles += 1; return nxt
+            return op
+        if (hw & 0xffe8) == 0xb660:
+            def op(cpu):
+                cpu.cycles += 1; return nxt # CPS: interrupts are not modeled
+            return op
+        if hw == 0xbf20:
+            def op(cpu):
+                cpu.cycles += 1 # WFE: the harness may produce the awaited event
+                if cpu.wfe:
+                    cpu.wfe(cpu)
+                return nxt
+            return op
+        if (hw >> 8) == 0xbf:
+            def op(cpu):
+                cpu.cycles += 1; return nxt # NOP, YIELD, WFI, SEV
+            return op
+        if (hw >> 8) == 0xbe:
+            raise ModelError("BKPT at 0x%08x" % pc)
+        raise ModelError("undefined instruction 0x%04x at 0x%08x" % (hw, pc))
+
+    def _decode32(self, hi, lo, pc):
+        nxt = pc + 4
+        if (lo & 0xd000) == 0xd000:
+            s = (hi >> 10) & 1
+            i1 = 1 - (((lo >> 13) & 1) ^ s)
+            i2 = 1 - (((lo >> 11) & 1) ^ s)
+            off = (s << 24) | (i1 << 23) | (i2 << 22) | ((hi & 0x3ff) << 12) | ((lo & 0x7ff) << 1)
+            if s:
+                off -= 1 << 25
+            target = (pc + 4 + off) & M32
+            def op(cpu):
+                cpu.r[14] = nxt | 1; cpu.cycles += 3; return target
+            return op
+        if (hi & 0xfff0) == 0xf3b0 and (lo & 0xff00) == 0x8f00:
+            def op(cpu):
+                cpu.cycles += 3; return nxt # DMB, DSB, ISB
+            return op
+        if (hi & 0xfff0) == 0xf380 and (lo & 0xff00) == 0x8800:
+            def op(cpu):
+                cpu.cycles += 3; return nxt # MSR: special registers are not modeled
+            return op
+        if hi == 0xf3ef and (lo & 0xf000) == 0x8000:
+            rd = (lo >> 8) & 15
+            def op(cpu):
+                cpu.r[rd] = 0; cpu.cycles += 3; return nxt # MRS
+            return op
+        raise ModelError("undefined instruction 0x%04x%04x at 0x%08x" % (hi, lo, pc))
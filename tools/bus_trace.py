@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+
+# MIT License
+# Copyright (c) 2024 Thorsten Brehm
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Decode a bus trace exported by the firmware (FEATURE_BUS_TRACE, see applebus/bus_trace.h).
+# The export is written to flash, 32KB into the configuration area. Read it with picotool, e.g.
+#   PICO:  picotool save -r 0x101E8000 0x101EC000 trace.bin
+#   PICO2: picotool save -r 0x103E8000 0x103ED000 trace.bin
+# Usage:
+#   bus_trace.py trace.bin           print the capture
+#   bus_trace.py trace.bin --replay  print "<bus word> <cycles>" lines (hex/decimal) for replaying
+#                                    the raw PIO words through businterface()
+
+import struct
+import sys
+
+MAGIC   = 0x52543241 # 'A2TR'
+HEADER  = "<IHHIIIBBBBIII"
+RECORD  = "<II"
+TRIGGERS = ["NONE", "MANUAL", "WRITE", "ACCESS", "SWITCH", "RESET"]
+
+def readTrace(data):
+    (magic, version, headerSize, count, triggerIndex, clockKhz, trigger, rwBit, devselBit, addressShift,
+     triggerFirst, triggerLast, reserved) = struct.unpack_from(HEADER, data, 0)
+    if magic != MAGIC:
+        raise ValueError("no bus trace found (bad magic word)")
+    if version != 2:
+        raise ValueError("unsupported bus trace version %d" % version)
+    header = {
+        "count": count, "trigger_index": triggerIndex, "clock_khz": clockKhz,
+        "trigger": TRIGGERS[trigger] if trigger < len(TRIGGERS) else str(trigger),
+        "rw_bit": rwBit, "devsel_bit": devselBit, "address_shift": addressShift,
+        "trigger_first": triggerFirst, "trigger_last": triggerLast
+    }
+    recordSize = struct.calcsize(RECORD)
+    records = []
+    for i in range(count):
+        records.append(struct.unpack_from(RECORD, data, headerSize + i*recordSize))
+    return header, records
+
+def printTrace(header, records):
+    if header["trigger_first"] > 0xffff:
+        addresses = "(no address)"
+    else:
+        addresses = "$%04X-$%04X" % (header["trigger_first"], header["trigger_last"])
+    print("trigger: %s %s, %d records, CPU clock %d kHz" %
+          (header["trigger"], addresses, len(records), header["clock_khz"]))
+    trigger = header["trigger_index"]
+    if trigger == 0xffffffff:
+        trigger = 0
+    mhz = header["clock_khz"] / 1000.0
+    for (i, (value, cycles)) in enumerate(records):
+        address = (value >> header["address_shift"]) & 0xffff
+        write   = (value & (1 << header["rw_bit"])) == 0
+        devsel  = (value & (1 << header["devsel_bit"])) == 0
+        line = "%6d %6d %8.2fus %s $%04X" % (i - trigger, cycles, cycles / mhz, "W" if write else "R", address)
+        line += " $%02X" % (value & 0xff) if write else "    "
+        if devsel:
+            line += " DEV"
+        if i == header["trigger_index"]:
+            line += " <TRIGGER"
+        print(line)
+
+def main(argv):
+    if len(argv) < 2:
+        print("Usage: %s <trace.bin> [--replay]" % argv[0])
+        return 1
+    with open(argv[1], "rb") as f:
+        data = f.read()
+    header, records = readTrace(data)
+    if "--replay" in argv:
+        for (value, cycles) in records:
+            print("%08x %d" % (value, cycles))
+    else:
+        printTrace(header, records)
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,716 @@
+#!/usr/bin/env python3
+
+# MIT License
+# Copyright (c) 2024 Thorsten Brehm
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Compare firmware builds without hardware: links the RP2040 object files of a build with armv6m.py
+# and reports sizes or runs firmware functions on its Cortex-M0+ cycle model.
+# OBJS is a build's object directory (e.g. build/CMakeFiles/A2DVI_v1_PICO.dir) or a list of object
+# files. Build for the RP2040: the model only knows ARMv6-M.
+# Usage:
+#   cycle_model.py sizes OBJS [OBJS2]   RAM/flash bytes per section type, and the change to OBJS2
+#   cycle_model.py kernels OBJS [OBJS2] cycles per scanline of the line kernels for random video
+#                                       memory. With OBJS2: checks that both give the same scanlines
+#                                       and fails (exit code 1) when they differ. This is the test of
+#                                       the assembly kernels: OBJS default, OBJS2 FEATURE_ASM_KERNELS
+#   cycle_model.py modes OBJS [OBJS2]   cycles per scanline of every monochrome kernel, per color mode.
+#                                       With OBJS2: the change, fails when the scanlines differ
+#   cycle_model.py frames OBJS [OBJS2] [--bus] [--repeat] [--color=white,green,amber]
+#                                       renders one frame per video mode through render_loop(): cycles per
+#                                       frame. With OBJS2: fails when any mode sends different scanlines
+#                                       (the debug lines are not rendered). --bus: the video memory is
+#                                       written through the bus decoder, followed by writes to all other
+#                                       RAM (e.g. to compare builds with and without FEATURE_SPARSE_SHADOW).
+#                                       --repeat: renders two frames per mode and compares the second,
+#                                       which a FEATURE_ROW_CACHE build sends from its cache
+#   cycle_model.py indexed OBJS         cycles per scanline of the indexed-color stage and of the
+#                                       fused DHGR color kernel
+#   cycle_model.py replay OBJS [TRACE] [--machine=auto,ii,iie,iigs] [--words=N] [--video-writes=PCT]
+#                                       replays bus words through abus_loop() for each machine's
+#                                       decoder: cycles per word, busy share and RX FIFO levels.
+#                                       TRACE: output of "bus_trace.py trace.bin --replay" (the cycle
+#                                       deltas must be at 252MHz), otherwise a synthetic 6502 trace.
+#                                       With FEATURE_BUS_STATS: also prints the firmware's bus_stats
+#
+# The cycle counts are the model's (see armv6m.py), not hardware measurements.
+
+import hashlib
+import random
+import sys
+
+import armv6m
+
+def load(spec):
+    """Link the objects of a build directory (or a comma separated list of object files)."""
+    return armv6m.Image(armv6m.object_files(spec.split(",")))
+
+# --- sizes
+
+SECTION_TYPES = ["text", "rodata", "time_critical", "delayed_code", "delayed_data", "data", "bss",
+                 "appledata", "flashdata"]
+
+def symbol_sizes(image):
+    sizes = {}
+    for obj in image.objects:
+        for sym in obj.symbols:
+            if sym["name"] and sym["size"] and sym["type"] != armv6m.STT_SECTION and \
+               sym["shndx"] in obj.addr:
+                sizes[sym["name"]] = sizes.get(sym["name"], 0) + sym["size"]
+    return sizes
+
+def cmd_sizes(args):
+    images = [load(a) for a in args]
+    types = SECTION_TYPES + sorted(set(t for i in images for t in i.sizes if t not in SECTION_TYPES))
+    print("%-16s" % "section" + "".join("%10s" % ("OBJS%d" % (n+1) if n else "OBJS") for n in range(len(images))) +
+          ("%10s" % "change" if len(images) > 1 else ""))
+    for t in types + ["RAM", "flash"]:
+        if t == "RAM":
+            values = [i.ram_top - armv6m.RAM_BASE for i in images]
+        elif t == "flash":
+            values = [i.flash_top - armv6m.FLASH_BASE for i in images]
+        else:
+            values = [i.sizes.get(t, 0) for i in images]
+        if not any(values):
+            continue
+        line = "%-16s" % t + "".join("%10d" % v for v in values)
+        if len(images) > 1:
+            line += "%+10d" % (values[-1] - values[0])
+        print(line)
+    if len(images) > 1:
+        # the symbols which changed most
+        old, new = symbol_sizes(images[0]), symbol_sizes(images[-1])
+        changes = [(new.get(s, 0) - old.get(s, 0), s) for s in set(old) | set(new)]
+        changes = sorted((c for c in changes if c[0]), key=lambda c: -abs(c[0]))[:20]
+        if changes:
+            print("\nlargest symbol changes:")
+            for change, name in changes:
+                print("  %+6d %6d  %s" % (change, new.get(name, 0), name))
+    return 0
+
+# --- running firmware functions
+
+DVI_MONO_LINE_TAG, DVI_MONO_LINE_ALL_LANES = 1, 2 # libdvi/dvi.h
+
+class Firmware:
+    """A build loaded into the model, with its DVI queues set up by libdvi's dvi_init()."""
+    def __init__(self, spec, core=0):
+        self.image = load(spec)
+        self.cpu = armv6m.Cpu(self.image, core)
+        self.queues = []
+        self.image.hook("malloc", lambda cpu: self.image.alloc(cpu.r[0], 8))
+        self.image.hook("queue_init_with_spinlock", self._queue_init)
+        self.image.hook("memset", self._memset)
+
+    def _memset(self, cpu):
+        # the C library is not linked: run memset() in Python, at no cost
+        dest, value, size = cpu.r[0:3]
+        if size:
+            self.image.write_bytes(dest, bytes([value & 0xff]) * size)
+        return dest
+
+    def _queue_init(self, cpu):
+        q, size, count, lock = cpu.r[0:4]
+        self.image.write32(q, armv6m.SIO_SPINLOCK0 + 4*lock)    # core.spin_lock
+        self.image.write32(q+4, self.image.alloc(size*(count+1))) # data
+        self.image.write32(q+8, 0)                                # wptr, rptr
+        self.image.write32(q+12, size | (count << 16))            # element_size, element_count
+        self.queues.append(q)
+
+    def init_dvi(self):
+        dvi0 = self.image.sym("dvi0")
+        self.image.write32(dvi0, self.image.sym("dvi_timing_640x480p_60hz")) # dvi0.timing
+        self.cpu.call("dvi_init", dvi0, 0, 1)
+        self.q_tmds_valid, self.q_tmds_free = self.queues[0], self.queues[1]
+        self.sent = []
+        self.cpu.wfe = self._dvi_wait
+
+    def _dvi_wait(self, cpu):
+        # waiting for a free scanline buffer: the DVI DMA IRQ would release one
+        self.sent = self.scanlines()
+
+    def queue_pop(self, q):
+        data, ptrs, count = self.image.read32(q+4), self.image.read32(q+8), self.image.read32(q+12) >> 16
+        wptr, rptr = ptrs & 0xffff, ptrs >> 16
+        if wptr == rptr:
+            return None
+        value = self.image.read32(data + 4*rptr)
+        self.image.write32(q+8, wptr | ((0 if rptr >= count else rptr+1) << 16))
+        return value
+
+    def queue_push(self, q, value):
+        data, ptrs, count = self.image.read32(q+4), self.image.read32(q+8), self.image.read32(q+12) >> 16
+        wptr, rptr = ptrs & 0xffff, ptrs >> 16
+        self.image.write32(data + 4*wptr, value)
+        self.image.write32(q+8, (0 if wptr >= count else wptr+1) | (rptr << 16))
+
+    def scanlines(self):
+        """Takes the sent scanlines (3 channels of 320 TMDS words each) and returns their buffers.
+        Single-lane lines (DVI_MONO_LINE_TAG, e.g. from FEATURE_ROW_CACHE) are expanded to the
+        lanes the DVI DMA would read."""
+        lines, self.sent = self.sent, []
+        while True:
+            tmdsbuf = self.queue_pop(self.q_tmds_valid)
+            if tmdsbuf is None:
+                return lines
+            if tmdsbuf & DVI_MONO_LINE_TAG:
+                line = self.image.read_bytes(tmdsbuf & ~3, 320*4)
+                black = self.image.read_bytes(self.image.sym("row_cache_black"), 320*4)
+                lines.append(line*3 if tmdsbuf & DVI_MONO_LINE_ALL_LANES else black + line + black)
+                continue
+            lines.append(self.image.read_bytes(tmdsbuf, 3*320*4))
+            self.queue_push(self.q_tmds_free, tmdsbuf)
+
+    def pointer_table(self, name, index):
+        return self.image.read32(self.image.sym(name) + 4*index)
+
+    def timed_call(self, function, *args):
+        start = self.cpu.cycles
+        self.cpu.call(function, *args)
+        return self.cpu.cycles - start
+
+# --- kernels
+
+# name, kernel table, index (0: color, 1: first monochrome kernel, see render.h), kind
+KERNELS = [
+    ("hires mono",  "hires_line_kernels",  1, "line"),
+    ("dhgr mono",   "dhgr_line_kernels",   1, "line"),
+    ("text80 mono", "text80_line_kernels", 0, "text80"),
+    ("hires color", "hires_line_kernels",  0, "line"),
+    ("dhgr color",  "dhgr_line_kernels",   0, "line"),
+]
+
+def video_pages(fw):
+    """The HIRES and text pages, main and auxiliary memory (older builds: hgr_p1..4, text_p1..4)."""
+    if fw.image.has("render_hgr_pages"):
+        return ([fw.pointer_table("render_hgr_pages", i) for i in range(4)],
+                [fw.pointer_table("render_text_pages", i) for i in range(4)])
+    return ([fw.image.read32(fw.image.sym("hgr_p%d" % (i+1))) for i in range(4)],
+            [fw.image.read32(fw.image.sym("text_p%d" % (i+1))) for i in range(4)])
+
+def fill_video_memory(fw, seed):
+    rnd = random.Random(seed)
+    hgr_pages, text_pages = video_pages(fw)
+    for i in range(4):
+        fw.image.write_bytes(hgr_pages[i], bytes(rnd.getrandbits(8) for _ in range(0x2000)))
+        fw.image.write_bytes(text_pages[i], bytes(rnd.getrandbits(8) for _ in range(0x400)))
+
+def run_kernels(spec):
+    fw = Firmware(spec)
+    fw.init_dvi()
+    fw.cpu.call("render_init")
+    if fw.image.has("config_load_charsets"):
+        fw.cpu.call("config_load_charsets")
+    fill_video_memory(fw, 1)
+    if fw.image.has("video_planes_init"):
+        fw.cpu.call("video_planes_init") # FEATURE_VIDEO_PLANES: decode the planes from the memory
+    results = {}
+    for name, table, index, kind in KERNELS:
+        kernel = fw.pointer_table(table, index)
+        cycles, digest, count = 0, hashlib.sha1(), 0
+        if kind == "line":
+            for line in range(192):
+                cycles += fw.timed_call(kernel, 0, line)
+                for scanline in fw.scanlines():
+                    digest.update(scanline)
+                    count += 1
+        else:
+            pages = [fw.pointer_table("render_text_pages", i) for i in range(4)]
+            for row in range(24):
+                cycles += fw.timed_call(kernel, pages[0], pages[2], row)
+                for scanline in fw.scanlines():
+                    digest.update(scanline)
+                    count += 1
+        if count == 0:
+            raise armv6m.ModelError("%s: no scanlines were sent" % name)
+        results[name] = (cycles / count, digest.hexdigest())
+    return results
+
+def cmd_kernels(args):
+    results = [run_kernels(a) for a in args]
+    print("cycles per scanline, including the DVI queue handling")
+    print("%-14s" % "kernel" + "".join("%10s" % ("OBJS%d" % (n+1) if n else "OBJS") for n in range(len(results))) +
+          ("%10s  %s" % ("change", "scanlines") if len(results) > 1 else ""))
+    failed = 0
+    for name, _, _, _ in KERNELS:
+        values = [r[name][0] for r in results]
+        line = "%-14s" % name + "".join("%10.0f" % v for v in values)
+        if len(results) > 1:
+            same = all(r[name][1] == results[0][name][1] for r in results)
+            line += "%+9.1f%%  %s" % (100.0*(values[-1]-values[0])/values[0], "same" if same else "DIFFERENT")
+            failed += not same
+        print(line)
+    return 1 if failed else 0
+
+# name, kernel table, indexes of the white/green/amber kernels, kind
+MONO_KERNELS = [
+    ("lores",  "lores_line_kernels",  (1, 2, 3), "line"),
+    ("hires",  "hires_line_kernels",  (1, 2, 3), "line"),
+    ("dhgr",   "dhgr_line_kernels",   (1, 2, 3), "line"),
+    ("dgr",    "dgr_line_kernels",    (0, 1, 2), "line"),
+    ("text40", "text40_line_kernels", (0, 1, 2), "text40"),
+    ("text80", "text80_line_kernels", (0, 1, 2), "text80"),
+]
+COLOR_MODES = ("white", "green", "amber")
+
+def run_modes(spec):
+    fw = Firmware(spec)
+    fw.init_dvi()
+    fw.cpu.call("render_init")
+    if fw.image.has("config_load_charsets"):
+        fw.cpu.call("config_load_charsets")
+    fill_video_memory(fw, 1)
+    pages = [fw.pointer_table("render_text_pages", i) for i in range(4)]
+    results = {}
+    for name, table, indexes, kind in MONO_KERNELS:
+        for index, mode in zip(indexes, COLOR_MODES):
+            kernel = fw.pointer_table(table, index)
+            cycles, digest, count = 0, hashlib.sha1(), 0
+            for line in range(192 if kind == "line" else 24):
+                if kind == "line":
+                    cycles += fw.timed_call(kernel, 0, line)
+                elif kind == "text40":
+                    cycles += fw.timed_call(kernel, pages[0], line)
+                else:
+                    cycles += fw.timed_call(kernel, pages[0], pages[2], line)
+                for scanline in fw.scanlines():
+                    digest.update(scanline)
+                    count += 1
+            if count == 0:
+                raise armv6m.ModelError("%s %s: no scanlines were sent" % (name, mode))
+            results[(name, mode)] = (cycles / count, digest.hexdigest())
+    return results
+
+def cmd_modes(args):
+    results = [run_modes(a) for a in args]
+    print("cycles per scanline of the monochrome kernels, including the DVI queue handling")
+    print("%-16s" % "kernel" + "".join("%10s" % ("OBJS%d" % (n+1) if n else "OBJS") for n in range(len(results))) +
+          ("%10s  %s" % ("change", "scanlines") if len(results) > 1 else ""))
+    failed = 0
+    for name, _, _, _ in MONO_KERNELS:
+        for mode in COLOR_MODES:
+            values = [r[(name, mode)][0] for r in results]
+            line = "%-16s" % ("%s %s" % (name, mode)) + "".join("%10.0f" % v for v in values)
+            if len(results) > 1:
+                same = all(r[(name, mode)][1] == results[0][(name, mode)][1] for r in results)
+                line += "%+9.1f%%  %s" % (100.0*(values[-1]-values[0])/values[0], "same" if same else "DIFFERENT")
+                failed += not same
+            print(line)
+    return 1 if failed else 0
+
+# --- whole frames
+
+# soft switches and internal flags (applebus/buffers.h)
+TEXT, MIXED, HIRES, PAGE2 = 0x1, 0x2, 0x4, 0x8
+STORE80, COL80, DGR, MONO = 0x100, 0x2000, 0x8000, 0x10000
+VIDEO7, V7_MODE0, V7_MODE3 = 0x04000000, 0x0, 0x3
+
+# name, soft_switches, internal_flags (the Video-7 mode is in the lower bits)
+FRAME_MODES = [
+    ("text40",             TEXT,                           V7_MODE3),
+    ("text40 page2",       TEXT|PAGE2,                     V7_MODE3),
+    ("text80",             TEXT|COL80,                     V7_MODE3),
+    ("lores",              0,                              V7_MODE3),
+    ("lores mixed",        MIXED,                          V7_MODE3),
+    ("lores mixed 80",     MIXED|COL80,                    V7_MODE3),
+    ("dgr",                COL80|DGR,                      V7_MODE3),
+    ("dgr mixed",          MIXED|COL80|DGR,                V7_MODE3),
+    ("hires",              HIRES,                          V7_MODE3),
+    ("hires page2",        HIRES|PAGE2,                    V7_MODE3),
+    ("hires mixed",        HIRES|MIXED,                    V7_MODE3),
+    ("hires mixed 80",     HIRES|MIXED|COL80,              V7_MODE3),
+    ("dhgr",               HIRES|COL80|DGR,                V7_MODE3),
+    ("dhgr mixed",         HIRES|MIXED|COL80|DGR,          V7_MODE3),
+    ("dhgr 80store page2", HIRES|COL80|DGR|STORE80|PAGE2,  V7_MODE3),
+    ("video7 mode0 dhgr",  HIRES|COL80|DGR,                VIDEO7|V7_MODE0),
+    ("video7 f/b hires",   HIRES|DGR|STORE80,              VIDEO7|V7_MODE3),
+    ("video7 color text",  TEXT|DGR|STORE80,               VIDEO7|V7_MODE3),
+]
+
+class FrameDone(Exception):
+    pass
+
+def write_video_memory_bus(fw, seed):
+    """Fills the video pages of both banks through the IIe bus decoder, then writes to the rest of
+    the RAM, which must not show up on the screen."""
+    rnd = random.Random(seed)
+    fw.cpu.call("set_machine", MACHINES["iie"])
+    decode = fw.image.read32(fw.image.sym("businterface"))
+    def write(address, data):
+        fw.cpu.call(decode, bus_word(address, data, write=True))
+    video = [(0x2000, 0x4000), (0x0400, 0x0800)]
+    others = [a for a in range(0xc000) if not any(start <= a < start+size for start, size in video)]
+    for aux in (False, True):
+        write(0xc005 if aux else 0xc004, 0) # RAMWRTON/RAMWRTOFF
+        for start, size in video:
+            for address in range(start, start+size):
+                write(address, rnd.getrandbits(8))
+        for address in rnd.sample(others, 4000):
+            write(address, rnd.getrandbits(8))
+    write(0xc004, 0)
+
+COLOR_MODES = {"white": 0, "green": 1, "amber": 2} # COLOR_MODE_* (config.h)
+
+def run_frames(spec, bus=False, repeat=False, color="white"):
+    fw = Firmware(spec)
+    fw.init_dvi()
+    if fw.image.has("config_load_charsets"):
+        fw.cpu.call("config_load_charsets")
+    if bus:
+        write_video_memory_bus(fw, 1)
+    else:
+        fill_video_memory(fw, 1)
+    fw.image.write_bytes(fw.image.sym("color_mode"), bytes([COLOR_MODES[color]]))
+
+    frames = [0]
+    def render_debug(cpu):
+        # render_debug(false) ends the frame. The debug lines themselves are not compared.
+        if cpu.r[0] == 0:
+            frames[0] += 1
+            if repeat and frames[0] % 2:
+                fw.scanlines() # only the second frame counts
+                return
+            raise FrameDone()
+    fw.image.hook("render_debug", render_debug)
+
+    results = {}
+    for name, switches, flags in FRAME_MODES:
+        for mono in (False, True):
+            fw.image.write32(fw.image.sym("soft_switches"), switches | (MONO if mono else 0))
+            fw.image.write32(fw.image.sym("internal_flags"), flags)
+            fw.image.write_bytes(fw.image.sym("mono_rendering"), bytes([mono]))
+            start = fw.cpu.cycles
+            try:
+                fw.cpu.call("render_loop")
+            except FrameDone:
+                pass
+            cycles = fw.cpu.cycles - start
+            digest, count = hashlib.sha1(), 0
+            for scanline in fw.scanlines():
+                digest.update(scanline)
+                count += 1
+            if count == 0:
+                raise armv6m.ModelError("%s: no scanlines were sent" % name)
+            results[(name, mono)] = (cycles, count, digest.hexdigest())
+    return results
+
+def cmd_frames(args):
+    bus, repeat = "--bus" in args, "--repeat" in args
+    color = ([a[len("--color="):] for a in args if a.startswith("--color=")] or ["white"])[-1]
+    if color not in COLOR_MODES:
+        raise armv6m.ModelError("unknown color mode %s" % color)
+    results = [run_frames(a, bus, repeat, color) for a in args if not a.startswith("--")]
+    print("cycles per %s (render_loop, including render_init), random video memory, %s" %
+          ("two frames, the second is compared" if repeat else "frame", color))
+    print("%-26s" % "mode" + "".join("%10s" % ("OBJS%d" % (n+1) if n else "OBJS") for n in range(len(results))) +
+          ("%10s  %s" % ("change", "scanlines") if len(results) > 1 else ""))
+    failed = 0
+    for name, _, _ in FRAME_MODES:
+        for mono in (False, True):
+            key = (name, mono)
+            values = [r[key][0] for r in results]
+            line = "%-26s" % (name + (" mono" if mono else "")) + "".join("%10d" % v for v in values)
+            if len(results) > 1:
+                same = all(r[key][1:] == results[0][key][1:] for r in results)
+                line += "%+9.1f%%  %s" % (100.0*(values[-1]-values[0])/values[0], "same" if same else "DIFFERENT")
+                failed += not same
+            print(line)
+    return 1 if failed else 0
+
+# --- indexed-color stage
+
+def cmd_indexed(args):
+    fw = Firmware(args[0])
+    fw.init_dvi()
+    fw.cpu.call("render_init")
+    fill_video_memory(fw, 1)
+
+    def per_line(kernel):
+        cycles = 0
+        for line in range(192):
+            cycles += fw.timed_call(kernel, 0, line)
+            fw.scanlines()
+        return cycles / 192.0
+
+    def expand(words):
+        indexes = fw.image.sym("render_line_indexes")
+        for i, w in enumerate(words):
+            fw.image.write32(indexes + 4*i, w)
+        tmdsbuf = fw.queue_pop(fw.q_tmds_free)
+        cycles = fw.timed_call("render_expand_indexed", indexes, tmdsbuf, fw.image.sym("tmds_lorescolor"))
+        fw.queue_push(fw.q_tmds_free, tmdsbuf)
+        return cycles
+
+    rnd = random.Random(2)
+    words = 560//2//8
+    print("cycles per scanline, random video memory")
+    print("%-44s%8.0f" % ("DHGR color, fused kernel", per_line(fw.pointer_table("dhgr_line_kernels", 0))))
+    print("%-44s%8.0f" % ("Video-7 F/B HIRES, decode to indexes + expand", per_line("render_dhgr_v7fb_line")))
+    print("%-44s%8.0f" % ("expand only, random indexes", expand([rnd.getrandbits(32) for _ in range(words)])))
+    print("%-44s%8.0f" % ("expand only, one color per 8 pixels", expand([rnd.getrandbits(4)*0x11111111 for _ in range(words)])))
+    return 0
+
+# --- bus replay
+
+# bus word layout (applebus/abus.h, abus_pin_config.h)
+BUS_DEVSEL = 1 << 8  # clear: card register access
+BUS_READ   = 1 << 9  # set: read cycle
+BUS_ADDRESS_SHIFT = 11
+
+SYS_CLOCK_HZ = 252000000
+BUS_CYCLES = SYS_CLOCK_HZ / 1023000.0 # CPU cycles per 6502 cycle
+
+MACHINES = {"ii": 0, "iie": 1, "iigs": 2, "auto": 0xff} # compat_t (config/config.h)
+
+# PIO 0 registers of the bus state machine (SM 0, see abus_setup.h)
+PIO0_FSTAT  = 0x50200004
+PIO0_FLEVEL = 0x5020000c
+PIO0_RXF0   = 0x50200020
+PIO_FIFO_DEPTH = 4
+
+def bus_word(address, data=0, write=False, devsel=False):
+    return (address << BUS_ADDRESS_SHIFT) | (0 if write else BUS_READ) | (0 if devsel else BUS_DEVSEL) | data
+
+def word_kind(value):
+    address = value >> BUS_ADDRESS_SHIFT
+    if not value & BUS_READ:
+        if 0x400 <= address < 0x800:
+            return "text write"
+        if 0x2000 <= address < 0x6000:
+            return "HIRES write"
+        return "RAM write" if address < 0xc000 else "I/O write"
+    return "read" if (address & 0xff00) != 0xc000 else "I/O read"
+
+def synthetic_trace(count, video_writes, seed=3):
+    """6502-like bus activity at 1.023MHz: mostly reads, 20% writes, video_writes% of all cycles
+    are writes to the text/HIRES pages, 1% soft switch, keyboard and card register accesses."""
+    rnd = random.Random(seed)
+    words = []
+    pc = 0x0800
+    carry = 0.0
+    for _ in range(count):
+        r = rnd.random()*100
+        if r < 1:
+            # soft switches (read or written), keyboard, VBL and the card's registers (slot 3)
+            address = rnd.choice([0xc000, 0xc001, 0xc00c, 0xc00d, 0xc010, 0xc019, 0xc030,
+                                  0xc050, 0xc051, 0xc054, 0xc055, 0xc057, 0xc0b0 + rnd.getrandbits(4)])
+            if address >= 0xc0b0:
+                value = bus_word(address, rnd.getrandbits(8), devsel=True)
+            else:
+                value = bus_word(address, rnd.getrandbits(8), write=rnd.random() < 0.5)
+        elif r < 1 + video_writes:
+            address = rnd.choice([0x400 + rnd.getrandbits(10), 0x2000 + rnd.getrandbits(13)])
+            value = bus_word(address, rnd.getrandbits(8), write=True)
+        elif r < 1 + max(video_writes, 20):
+            address = rnd.choice([rnd.getrandbits(8), 0x100 + rnd.getrandbits(8), 0x6000 + rnd.getrandbits(14)])
+            value = bus_word(address, rnd.getrandbits(8), write=True)
+        elif r < 80:
+            # instruction stream, with an occasional jump
+            pc = (pc + 1) if rnd.random() < 0.9 else rnd.choice([0x0800, 0x6000, 0xd000, 0xf800]) + rnd.getrandbits(10)
+            value = bus_word(pc & 0xbfff if pc < 0xc000 else pc & 0xffff, rnd.getrandbits(8))
+        else:
+            value = bus_word(rnd.choice([rnd.getrandbits(8), 0x0800 + rnd.getrandbits(12), 0xe000 + rnd.getrandbits(13)]),
+                             rnd.getrandbits(8))
+        carry += BUS_CYCLES
+        delta = int(carry)
+        carry -= delta
+        words.append((value, delta))
+    return words
+
+def read_trace(path):
+    words = []
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) == 2:
+                words.append((int(fields[0], 16), int(fields[1])))
+    return words
+
+class ReplayDone(Exception):
+    pass
+
+class BusReplay:
+    """The PIO's RX FIFO, filled from a trace at the trace's timing, read by abus_loop().
+    A word's cycles run from its read to the loop's next FIFO access. Words arriving at a full FIFO
+    are dropped. The model does not poll an empty FIFO cycle by cycle: the second poll in a row
+    skips ahead to the next word's arrival."""
+    def __init__(self, fw, words):
+        self.fw = fw
+        self.words = words
+        self.arrival = None  # set by the first FIFO access, after abus_loop()'s initialization
+        self.next = 0        # next word to arrive
+        self.fifo = []
+        self.dropped = 0
+        self.polled_empty = False
+        self.read_at = None  # time the last word was read
+        self.levels = [0]*(PIO_FIFO_DEPTH+1)
+        self.busy = 0
+        self.max = 0
+        self.per_kind = {}
+        self.kind = None
+        cpu = fw.cpu
+        cpu.io_reads[PIO0_FSTAT] = self.fstat
+        cpu.io_reads[PIO0_FLEVEL] = self.flevel
+        cpu.io_reads[PIO0_RXF0] = self.rxf
+
+    def _advance(self, now):
+        if self.arrival is None:
+            self.start = t = now
+            self.arrival = []
+            for _, delta in self.words:
+                t += delta
+                self.arrival.append(t)
+        while self.next < len(self.words) and self.arrival[self.next] <= now:
+            if len(self.fifo) < PIO_FIFO_DEPTH:
+                self.fifo.append(self.words[self.next][0])
+            else:
+                self.dropped += 1 # the state machine stalls: the bus cycle is lost
+            self.next += 1
+
+    def _loop_access(self, cpu):
+        # first PIO access after reading a word: abus_loop() is done with it
+        if self.read_at is not None:
+            cycles = cpu.cycles - self.read_at
+            self.busy += cycles
+            self.max = max(self.max, cycles)
+            total, count = self.per_kind.get(self.kind, (0, 0))
+            self.per_kind[self.kind] = (total + cycles, count + 1)
+            self.read_at = None
+            self._advance(cpu.cycles)
+            self.levels[len(self.fifo)] += 1
+        else:
+            self._advance(cpu.cycles)
+
+    def fstat(self, cpu):
+        self._loop_access(cpu)
+        if not self.fifo:
+            if self.next >= len(self.words):
+                raise ReplayDone()
+            if self.polled_empty:
+                # polling an empty FIFO: skip ahead to the next word
+                cpu.cycles = max(cpu.cycles, self.arrival[self.next])
+                self._advance(cpu.cycles)
+            self.polled_empty = True
+        full = 1 if len(self.fifo) == PIO_FIFO_DEPTH else 0
+        empty = 0 if self.fifo else 1
+        return full | (empty << 8)
+
+    def flevel(self, cpu):
+        self._loop_access(cpu)
+        return len(self.fifo) << 4
+
+    def rxf(self, cpu):
+        self._advance(cpu.cycles)
+        self.polled_empty = False
+        value = self.fifo.pop(0) if self.fifo else 0
+        self.read_at = cpu.cycles
+        self.kind = word_kind(value)
+        return value
+
+def _lmul(cpu):
+    product = ((cpu.r[0] | (cpu.r[1] << 32)) * (cpu.r[2] | (cpu.r[3] << 32))) & 0xffffffffffffffff
+    cpu.r[1] = product >> 32
+    return product
+
+def _uldivmod(cpu):
+    a, b = cpu.r[0] | (cpu.r[1] << 32), cpu.r[2] | (cpu.r[3] << 32)
+    q, m = (a // b, a % b) if b else (0, 0)
+    cpu.r[1], cpu.r[2], cpu.r[3] = q >> 32, m & 0xffffffff, m >> 32
+    return q
+
+def _uidivmod(cpu):
+    a, b = cpu.r[0], cpu.r[1]
+    q, m = (a // b, a % b) if b else (0, 0)
+    cpu.r[1] = m
+    return q
+
+def replay(spec, machine, words):
+    fw = Firmware(spec, core=1)
+    # clock, time and runtime helpers for bus_stats.c (not used per bus word): hooks at no cost
+    fw.image.hook("clock_get_hz", lambda cpu: SYS_CLOCK_HZ)
+    fw.image.hook("time_us_32", lambda cpu: cpu.cycles * 1000000 // SYS_CLOCK_HZ)
+    fw.image.hook("__aeabi_lmul", _lmul)
+    fw.image.hook("__aeabi_uldivmod", _uldivmod)
+    fw.image.hook("__aeabi_uidiv", _uidivmod)
+    fw.image.hook("__aeabi_uidivmod", _uidivmod)
+    fw.image.hook("abus_pio_setup", lambda cpu: None)
+    fw.cpu.call("set_machine", MACHINES[machine])
+    bus = BusReplay(fw, words)
+    try:
+        fw.cpu.call("abus_loop", max_cycles=sum(delta for _, delta in words) + 50000000)
+    except ReplayDone:
+        pass
+    bus.elapsed = fw.cpu.cycles - bus.start
+    bus.firmware_stats = None
+    if fw.image.has("bus_stats"):
+        # FEATURE_BUS_STATS: publish the period since the last update, read the firmware's figures
+        fw.cpu.call("bus_stats_update")
+        stats = fw.image.sym("bus_stats")
+        bus.firmware_stats = [fw.image.read32(stats + 4*i) for i in range(9)] + \
+                             [fw.image.read32(fw.image.sym("bus_stats_peak_cycles"))]
+    return fw, bus
+
+def cmd_replay(args):
+    options = dict(a[2:].split("=", 1) for a in args if a.startswith("--") and "=" in a)
+    paths = [a for a in args if not a.startswith("--")]
+    words = read_trace(paths[1]) if len(paths) > 1 else \
+        synthetic_trace(int(options.get("words", 100000)), float(options.get("video-writes", 5)))
+    machines = options.get("machine", "auto,ii,iie,iigs").split(",")
+    kinds = ["read", "RAM write", "text write", "HIRES write", "I/O read", "I/O write"]
+    print("%d bus words, %s" % (len(words), "trace " + paths[1] if len(paths) > 1 else "synthetic trace"))
+    print("%-6s%8s%8s%6s%8s  %-24s" % ("", "avg", "max", "busy", "dropped", "FIFO level 0/1/2/3/4") +
+          "".join("%12s" % k for k in kinds))
+    firmware_stats = []
+    for machine in machines:
+        fw, bus = replay(paths[0], machine, words)
+        count = sum(c for _, c in bus.per_kind.values())
+        line = "%-6s%8.1f%8d%5.1f%%%8d  %-24s" % (machine, bus.busy/float(count), bus.max,
+                                               100.0*bus.busy/bus.elapsed, bus.dropped,
+                                               "/".join("%d" % l for l in bus.levels))
+        for k in kinds:
+            total, n = bus.per_kind.get(k, (0, 0))
+            line += "%12s" % ("%.1f" % (total/float(n)) if n else "-")
+        print(line)
+        firmware_stats.append((machine, bus.firmware_stats))
+    if firmware_stats[0][1]:
+        print("\nbus_stats of the firmware (FEATURE_BUS_STATS, last period), cycles from the read to the end of businterface():")
+        print("%-6s%8s%8s%6s%8s  %-24s%8s" % ("", "avg", "max", "busy", "words", "FIFO level 0/1/2/3/4", "peak"))
+        for machine, (l0, l1, l2, l3, l4, count, busy, avg, peak_period, peak) in firmware_stats:
+            print("%-6s%8d%8d%5d%%%8d  %-24s%8d" % (machine, avg, peak_period, busy, count,
+                                                   "%d/%d/%d/%d/%d" % (l0, l1, l2, l3, l4), peak))
+    return 0
+
+COMMANDS = {"sizes": (cmd_sizes, 1, 2), "kernels": (cmd_kernels, 1, 2), "modes": (cmd_modes, 1, 2),
+            "frames": (cmd_frames, 1, 5),
+            "indexed": (cmd_indexed, 1, 1),
+            "replay": (cmd_replay, 1, 6)}
+
+def main(argv):
+    if len(argv) < 2 or argv[1] not in COMMANDS or not (COMMANDS[argv[1]][1] <= len(argv)-2 <= COMMANDS[argv[1]][2]):
+        print("Usage: %s <%s> OBJS... (see the file header)" % (argv[0], "|".join(COMMANDS)))
+        return 1
+    try:
+        return COMMANDS[argv[1]][0](argv[2:])
+    except armv6m.ModelError as e:
+        print("error: %s" % e)
+        return 1
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
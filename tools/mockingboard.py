@@ -0,0 +1,269 @@
+#!/usr/bin/env python3
+
+# MIT License
+# Copyright (c) 2024 Thorsten Brehm
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Render the Mockingboard audio of a bus trace to a WAV file (FEATURE_MOCKINGBOARD), to verify the
+# firmware's synthesis (firmware/audio/ay8910.c) and to profile its cost. The trace is the flash export
+# of the bus trace recorder (tools/bus_trace.py), or its "--replay" text output. Each bus word is one
+# bus cycle, the time base of the firmware. The AY generator below is the same fixed-point, table-driven
+# block generator as the firmware's, so the samples match.
+# Usage:
+#   mockingboard.py <trace.bin|replay.txt> <out.wav> [--slot N] [--pad SECONDS] [--profile]
+#   mockingboard.py --demo <out.wav> [--profile]     render a built-in test sequence (no trace needed)
+# --pad keeps rendering for the given time after the end of the trace (a trace is only a few ms long).
+# --profile reports the synthesis cost per second of audio, and the work per second (samples, blocks,
+# counter steps) which dominates the firmware's cost.
+
+import struct
+import sys
+import time
+import wave
+
+from bus_trace import readTrace
+
+AY_CLOCK_HZ  = 1020484
+AY_FRAC_BITS = 12
+SAMPLE_RATE  = 22050
+CYCLES_PER_SAMPLE = (AY_CLOCK_HZ << 8) // SAMPLE_RATE # 24.8 fixed-point
+
+VOLUME = [0, 139, 201, 295, 436, 645, 899, 1470, 1731, 2784, 3889, 4881, 6161, 7736, 9198, 10922]
+
+def envelopeTable():
+    table = []
+    for shape in range(16):
+        attack = (shape & 0x4) != 0
+        alternate = (shape & 0x2) != 0
+        levels = []
+        for step in range(32):
+            if step < 16:
+                level = step if attack else 15-step
+            elif not (shape & 0x8):
+                level = 0
+            elif shape & 0x1:
+                level = 15 if attack != alternate else 0
+            elif attack != alternate:
+                level = step-16
+            else:
+                level = 31-step
+            levels.append(level)
+        table.append(levels)
+    return table
+
+ENVELOPE = envelopeTable()
+
+class AY8910:
+    def __init__(self):
+        self.steps = 0
+        self.reset()
+
+    def reset(self):
+        self.regs = [0]*16
+        self.regs[7] = 0x3f
+        self.step = ((AY_CLOCK_HZ//8) << AY_FRAC_BITS) // SAMPLE_RATE
+        self.tonePeriod = [1 << AY_FRAC_BITS]*3
+        self.toneCount = [0]*3
+        self.toneOut = [0]*3
+        self.noisePeriod = 1 << (AY_FRAC_BITS+1)
+        self.noiseCount = 0
+        self.noiseLfsr = 1
+        self.envPeriod = 1 << (AY_FRAC_BITS+1)
+        self.envCount = 0
+        self.envStep = 0
+        self.envShape = 0
+
+    def write(self, reg, value):
+        reg &= 0xf
+        self.regs[reg] = value
+        if reg < 6:
+            channel = reg // 2
+            period = ((self.regs[channel*2+1] & 0xf) << 8) | self.regs[channel*2]
+            self.tonePeriod[channel] = (period or 1) << AY_FRAC_BITS
+        elif reg == 6:
+            self.noisePeriod = ((value & 0x1f) or 1) << (AY_FRAC_BITS+1)
+        elif reg in (11, 12):
+            self.envPeriod = (((self.regs[12] << 8) | self.regs[11]) or 1) << (AY_FRAC_BITS+1)
+        elif reg == 13:
+            self.envShape = value & 0xf
+            self.envStep = 0
+            self.envCount = 0
+
+    def render(self, samples):
+        out = []
+        step = self.step
+        mixer = self.regs[7]
+        shape = ENVELOPE[self.envShape]
+        repeats = (self.envShape & 0x9) == 0x8
+        for i in range(samples):
+            for c in range(3):
+                self.toneCount[c] += step
+                while self.toneCount[c] >= self.tonePeriod[c]:
+                    self.toneCount[c] -= self.tonePeriod[c]
+                    self.toneOut[c] ^= 1
+                    self.steps += 1
+            self.noiseCount += step
+            while self.noiseCount >= self.noisePeriod:
+                self.noiseCount -= self.noisePeriod
+                self.noiseLfsr = (self.noiseLfsr >> 1) | (((self.noiseLfsr ^ (self.noiseLfsr >> 3)) & 1) << 16)
+                self.steps += 1
+            self.envCount += step
+            while self.envCount >= self.envPeriod:
+                self.envCount -= self.envPeriod
+                if self.envStep < 31:
+                    self.envStep += 1
+                elif repeats:
+                    self.envStep = 0
+                self.steps += 1
+            noise = self.noiseLfsr & 1
+            sample = 0
+            for c in range(3):
+                amplitude = self.regs[8+c]
+                volume = VOLUME[shape[self.envStep] if amplitude & 0x10 else amplitude & 0xf]
+                on = (self.toneOut[c] | ((mixer >> c) & 1)) & (noise | ((mixer >> (c+3)) & 1))
+                sample += volume if on else -volume
+            out.append(sample)
+        return out
+
+class Mockingboard:
+    """The VIA/AY protocol (firmware/applebus/mockingboard.c) and the block scheduling of
+    firmware/audio/audio.c: samples are rendered up to each register write."""
+    def __init__(self, slot):
+        self.page = 0xC000 | (slot << 8)
+        self.ora = [0, 0]
+        self.latch = [0xff, 0xff]
+        self.ay = [AY8910(), AY8910()]
+        self.cycle = 0
+        self.fraction = 0
+        self.left = []
+        self.right = []
+        self.blocks = 0
+        self.writes = 0
+        self.synthTime = 0.0
+
+    def render(self, cycle):
+        self.fraction += (cycle - self.cycle) << 8
+        self.cycle = cycle
+        samples = self.fraction // CYCLES_PER_SAMPLE
+        self.fraction -= samples * CYCLES_PER_SAMPLE
+        if samples:
+            start = time.perf_counter()
+            self.left  += self.ay[0].render(samples)
+            self.right += self.ay[1].render(samples)
+            self.synthTime += time.perf_counter() - start
+            self.blocks += 1
+
+    def write(self, cycle, address, data):
+        if (address & 0xff00) != self.page:
+            return
+        chip = (address >> 7) & 1
+        reg = address & 0xf
+        if reg in (0x1, 0xf):
+            self.ora[chip] = data
+        elif reg == 0x0:
+            function = data & 0x7
+            if function == 0x7:
+                self.latch[chip] = self.ora[chip] if self.ora[chip] < 16 else 0xff
+            elif function == 0x6 and self.latch[chip] < 16:
+                self.render(cycle)
+                self.ay[chip].write(self.latch[chip], self.ora[chip])
+                self.writes += 1
+            elif function < 0x4:
+                self.render(cycle)
+                self.ay[chip].reset()
+
+def readBusWords(filename):
+    """(value, rw_bit, address_shift) of a trace export or of bus_trace.py's --replay output"""
+    with open(filename, "rb") as f:
+        data = f.read()
+    try:
+        header, records = readTrace(data)
+        return [value for (value, cycles) in records], header["rw_bit"], header["address_shift"]
+    except (ValueError, struct.error):
+        words = [int(line.split()[0], 16) for line in data.decode().splitlines() if line.strip()]
+        return words, 9, 11
+
+def demoBusWords(rwBit=9, addressShift=11, slot=4):
+    """A bus trace of a program which plays a chord on the left AY and an enveloped noise on the right."""
+    page = 0xC000 | (slot << 8)
+    words = []
+    def busWrite(address, data):
+        words.append((address << addressShift) | data) # R/W low: write
+    def ayWrite(chip, reg, value):
+        base = page | (chip << 7)
+        for (port, data) in ((1, reg), (0, 7), (0, 4), (1, value), (0, 6), (0, 4)):
+            busWrite(base | port, data)
+    def idle(cycles):
+        words.extend([(0xF000 << addressShift) | (1 << rwBit)] * cycles)
+    for chip in (0, 1):
+        busWrite(page | (chip << 7) | 0, 0) # reset
+        busWrite(page | (chip << 7) | 0, 4)
+    for (reg, value) in ((0, 0xd5), (1, 0x01), (2, 0x55), (3, 0x01), (4, 0x1c), (5, 0x01), (7, 0x38), (8, 12), (9, 10), (10, 10)):
+        ayWrite(0, reg, value)
+    for (reg, value) in ((6, 0x08), (7, 0x37), (8, 0x10), (11, 0x00), (12, 0x08), (13, 0x0a)):
+        ayWrite(1, reg, value)
+    idle(AY_CLOCK_HZ // 2)
+    ayWrite(0, 8, 0)
+    idle(AY_CLOCK_HZ // 2)
+    return words, rwBit, addressShift
+
+def writeWav(filename, left, right):
+    with wave.open(filename, "wb") as f:
+        f.setnchannels(2)
+        f.setsampwidth(2)
+        f.setframerate(SAMPLE_RATE)
+        f.writeframes(b"".join(struct.pack("<hh", l, r) for (l, r) in zip(left, right)))
+
+def main(argv):
+    def option(name, default):
+        return type(default)(argv[argv.index(name)+1]) if name in argv else default
+    # file names: arguments which are neither options nor option values
+    args = [a for (i, a) in enumerate(argv[1:]) if not a.startswith("--") and argv[i] not in ("--slot", "--pad")]
+    slot = option("--slot", 4)
+    pad = option("--pad", 0.0)
+    if "--demo" in argv:
+        if len(args) < 1:
+            print("Usage: %s --demo <out.wav> [--profile]" % argv[0])
+            return 1
+        (words, rwBit, addressShift) = demoBusWords(slot=slot)
+        outFile = args[0]
+    else:
+        if len(args) < 2:
+            print("Usage: %s <trace.bin|replay.txt> <out.wav> [--slot N] [--pad SECONDS] [--profile]" % argv[0])
+            return 1
+        (words, rwBit, addressShift) = readBusWords(args[0])
+        outFile = args[1]
+    mb = Mockingboard(slot)
+    for (cycle, value) in enumerate(words):
+        if (value & (1 << rwBit)) == 0:
+            mb.write(cycle, (value >> addressShift) & 0xffff, value & 0xff)
+    mb.render(len(words) + int(pad * AY_CLOCK_HZ))
+    writeWav(outFile, mb.left, mb.right)
+
+    seconds = len(mb.left) / SAMPLE_RATE
+    print("%s: %.3f s of audio, %d AY register writes" % (outFile, seconds, mb.writes))
+    if "--profile" in argv and seconds > 0:
+        print("synthesis (host): %.1f ms per second of audio" % (1000.0 * mb.synthTime / seconds))
+        print("per second of audio: %d samples, %.0f blocks, %.0f counter steps (2 AYs)" %
+              (SAMPLE_RATE*2, mb.blocks / seconds, (mb.ay[0].steps + mb.ay[1].steps) / seconds))
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
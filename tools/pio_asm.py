@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+
+# MIT License
+# Copyright (c) 2024 Thorsten Brehm
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Assemble the PIO programs without the SDK's pioasm, to check their sizes and whether the programs
+# loaded together fit into a PIO's 32 instruction slots. Knows the subset of the PIO assembly
+# language used by A2DVI and libdvi (RP2040 instruction set, no .lang_opt or expressions).
+# Usage:
+#   pio_asm.py FILE.pio...          size, wrap, side-set and JMP pin use of each program, followed
+#                                   by the A2DVI PIO layouts whose programs were all found. Fails
+#                                   (exit code 1) when a layout does not fit or a program has errors
+#   pio_asm.py --hex FILE.pio...    also lists the encoded instructions (as in pioasm's C headers)
+
+import re
+import sys
+
+PIO_SLOTS = 32
+
+# programs loaded into the same PIO, per build option (see applebus/abus_setup.h, dvi/dvi_pin_config.h)
+LAYOUTS = [
+    ("pio0",                                        ["abus"]),
+    ("pio0 FEATURE_BUS_TIMING",                     ["abus", "abus_phi0_timing"]),
+    ("pio0 FEATURE_READ_DATA",                      ["abus_read_data"]),
+    ("pio0 FEATURE_READ_DATA FEATURE_BUS_TIMING",   ["abus_read_data", "abus_phi0_timing"]),
+    ("pio0 FEATURE_BUS_FILTER",                     ["abus_filtered", "abus_filter_counter"]),
+    ("pio1",                                        ["dvi_serialiser"]),
+    ("pio1 FEATURE_BUS_FILTER FEATURE_BUS_TIMING",  ["dvi_serialiser", "abus_phi0_timing"]),
+]
+
+OPCODES = {"jmp": 0, "wait": 1, "in": 2, "out": 3, "push": 4, "pull": 4, "mov": 5, "irq": 6, "set": 7}
+JMP_CONDITIONS = {"": 0, "!x": 1, "x--": 2, "!y": 3, "y--": 4, "x!=y": 5, "pin": 6, "!osre": 7}
+WAIT_SOURCES = {"gpio": 0, "pin": 1, "irq": 2}
+IN_SOURCES = {"pins": 0, "x": 1, "y": 2, "null": 3, "isr": 6, "osr": 7}
+OUT_DESTINATIONS = {"pins": 0, "x": 1, "y": 2, "null": 3, "pindirs": 4, "pc": 5, "isr": 6, "exec": 7}
+MOV_DESTINATIONS = {"pins": 0, "x": 1, "y": 2, "exec": 4, "pc": 5, "isr": 6, "osr": 7}
+MOV_SOURCES = {"pins": 0, "x": 1, "y": 2, "null": 3, "status": 5, "isr": 6, "osr": 7}
+SET_DESTINATIONS = {"pins": 0, "x": 1, "y": 2, "pindirs": 4}
+
+class AsmError(Exception):
+    pass
+
+class Program:
+    def __init__(self, name):
+        self.name = name
+        self.origin = None
+        self.side_set = 0        # side-set bits, including the enable bit of "opt"
+        self.side_opt = False
+        self.lines = []          # (source line number, text)
+        self.labels = {}
+        self.public = []
+        self.wrap_target = None
+        self.wrap = None
+        self.code = []
+        self.jmp_pin = False
+
+def number(text, defines):
+    text = text.strip()
+    if text.lower() in defines:
+        return defines[text.lower()]
+    try:
+        return int(text.replace("_", ""), 0)
+    except ValueError:
+        raise AsmError("bad value '%s'" % text)
+
+def parse(path):
+    """Split a .pio file into programs, with their directives, labels and instruction lines."""
+    programs, defines, program, in_code_block = [], {}, None, False
+    for number_, raw in enumerate(open(path), 1):
+        line = re.split(r";|//", raw)[0].strip()
+        if in_code_block:
+            in_code_block = not raw.strip().startswith("%}")
+            continue
+        if raw.strip().startswith("%"):
+            in_code_block = True # "% c-sdk {" ... "%}"
+            continue
+        if not line:
+            continue
+        words = line.split()
+        directive = words[0].lower()
+        try:
+            if directive == ".program":
+                program = Program(words[1])
+                programs.append(program)
+            elif directive == ".define":
+                args = [w for w in words[1:] if w.lower() != "public"]
+                defines[args[0].lower()] = number(args[1], defines)
+            elif program is None:
+                raise AsmError("'%s' outside of a program" % line)
+            elif directive == ".origin":
+                program.origin = number(words[1], defines)
+            elif directive == ".side_set":
+                program.side_opt = "opt" in [w.lower() for w in words[2:]]
+                program.side_set = number(words[1], defines) + program.side_opt
+            elif directive == ".wrap_target":
+                program.wrap_target = len(program.lines)
+            elif directive == ".wrap":
+                program.wrap = len(program.lines) - 1
+            elif directive.startswith("."):
+                raise AsmError("unknown directive %s" % directive)
+            else:
+                while True:
+                    label = re.match(r"(public\s+)?([A-Za-z_]\w*)\s*:\s*(.*)$", line, re.IGNORECASE)
+                    if not label:
+                        break
+                    program.labels[label.group(2).lower()] = len(program.lines)
+                    if label.group(1):
+                        program.public.append(label.group(2))
+                    line = label.group(3)
+                if line:
+                    program.lines.append((number_, line))
+        except (AsmError, IndexError) as e:
+            raise AsmError("%s:%d: %s" % (path, number_, e if isinstance(e, AsmError) else "missing operand"))
+    return programs, defines
+
+def operand(table, text, what):
+    key = text.strip().lower()
+    if key not in table:
+        raise AsmError("bad %s '%s'" % (what, text.strip()))
+    return table[key]
+
+def bit_count(text, defines):
+    count = number(text, defines)
+    if not 1 <= count <= 32:
+        raise AsmError("bit count %d out of range" % count)
+    return count & 31
+
+def encode(program, text, defines):
+    # delay and side-set suffixes
+    delay, side = 0, None
+    match = re.search(r"\[([^\]]+)\]\s*$", text)
+    if match:
+        delay = number(match.group(1), defines)
+        text = text[:match.start()].strip()
+    match = re.search(r"\bside\s+(\S+)\s*$", text, re.IGNORECASE)
+    if match:
+        side = number(match.group(1), defines)
+        text = text[:match.start()].strip()
+
+    words = text.split(None, 1)
+    mnemonic = words[0].lower()
+    args = [a.strip() for a in words[1].split(",")] if len(words) > 1 else []
+
+    if mnemonic == "nop":
+        mnemonic, args = "mov", ["y", "y"]
+    if mnemonic not in OPCODES:
+        raise AsmError("unknown instruction '%s'" % mnemonic)
+    opcode = OPCODES[mnemonic] << 13
+
+    if mnemonic == "jmp":
+        condition = args[0].replace(" ", "").lower() if len(args) > 1 else ""
+        target = args[-1]
+        if condition == "pin":
+            program.jmp_pin = True
+        # "jmp X!=Y label" is written without a comma
+        parts = target.split()
+        if len(parts) == 2:
+            condition, target = parts[0].replace(" ", "").lower(), parts[1]
+            program.jmp_pin |= condition == "pin"
+        if target.lower() in program.labels:
+            address = program.labels[target.lower()]
+        else:
+            address = number(target, defines)
+        arg = (operand(JMP_CONDITIONS, condition, "condition") << 5) | address
+    elif mnemonic == "wait":
+        parts = " ".join(args).split()
+        if len(parts) < 3:
+            raise AsmError("wait needs polarity, source and index")
+        index = number(parts[2], defines)
+        if parts[1].lower() == "irq" and len(parts) > 3 and parts[3].lower() == "rel":
+            index |= 0x10
+        arg = (number(parts[0], defines) << 7) | (operand(WAIT_SOURCES, parts[1], "wait source") << 5) | index
+    elif mnemonic == "in":
+        arg = (operand(IN_SOURCES, args[0], "in source") << 5) | bit_count(args[1], defines)
+    elif mnemonic == "out":
+        arg = (operand(OUT_DESTINATIONS, args[0], "out destination") << 5) | bit_count(args[1], defines)
+    elif mnemonic in ("push", "pull"):
+        flags = [a.lower() for a in (words[1].split() if len(words) > 1 else [])]
+        block = "noblock" not in flags
+        conditional = ("iffull" if mnemonic == "push" else "ifempty") in flags
+        arg = ((mnemonic == "pull") << 7) | (conditional << 6) | (block << 5)
+    elif mnemonic == "mov":
+        source, op = args[1].replace(" ", ""), 0
+        if source.startswith("~") or source.startswith("!"):
+            source, op = source[1:], 1
+        elif source.startswith("::"):
+            source, op = source[2:], 2
+        arg = (operand(MOV_DESTINATIONS, args[0], "mov destination") << 5) | (op << 3) | \
+              operand(MOV_SOURCES, source, "mov source")
+    elif mnemonic == "irq":
+        parts = [p.lower() for p in args[0].split()] if args else []
+        clear, wait = "clear" in parts, "wait" in parts
+        parts = [p for p in parts if p not in ("set", "nowait", "clear", "wait")]
+        index = number(parts[0], defines)
+        if "rel" in parts:
+            index |= 0x10
+        arg = (clear << 6) | (wait << 5) | index
+    else: # set
+        value = number(args[1], defines)
+        if not 0 <= value <= 31:
+            raise AsmError("set value %d out of range" % value)
+        arg = (operand(SET_DESTINATIONS, args[0], "set destination") << 5) | value
+
+    delay_bits = 5 - program.side_set
+    if not 0 <= delay < (1 << delay_bits):
+        raise AsmError("delay %d does not fit into %d bits" % (delay, delay_bits))
+    field = delay
+    if side is not None:
+        if not program.side_set:
+            raise AsmError("side-set without .side_set")
+        value_bits = program.side_set - program.side_opt
+        if not 0 <= side < (1 << value_bits):
+            raise AsmError("side-set value %d out of range" % side)
+        field |= side << delay_bits
+        if program.side_opt:
+            field |= 0x10
+    elif program.side_set and not program.side_opt:
+        raise AsmError("side-set value required")
+    return opcode | (field << 8) | arg
+
+def assemble(path):
+    programs, defines = parse(path)
+    for program in programs:
+        for number_, text in program.lines:
+            try:
+                program.code.append((encode(program, text, defines), text))
+            except (AsmError, IndexError) as e:
+                raise AsmError("%s:%d: %s" % (path, number_, e if isinstance(e, AsmError) else "missing operand"))
+        if program.wrap_target is None:
+            program.wrap_target = 0
+        if program.wrap is None:
+            program.wrap = len(program.code) - 1
+    return programs
+
+def main(argv):
+    show_hex = "--hex" in argv
+    paths = [a for a in argv[1:] if not a.startswith("--")]
+    if not paths:
+        print("Usage: %s [--hex] FILE.pio... (see the file header)" % argv[0])
+        return 1
+    programs = {}
+    try:
+        for path in paths:
+            for program in assemble(path):
+                programs[program.name] = program
+    except AsmError as e:
+        print("error: %s" % e)
+        return 1
+
+    print("%-22s %5s %7s %6s %9s %8s  %s" % ("program", "size", "origin", "wrap", "side-set", "jmp pin", "public labels"))
+    for program in programs.values():
+        print("%-22s %5d %7s %6s %9s %8s  %s" % (
+            program.name, len(program.code), "-" if program.origin is None else program.origin,
+            "%d-%d" % (program.wrap_target, program.wrap),
+            ("%d%s" % (program.side_set - program.side_opt, " opt" if program.side_opt else "")) if program.side_set else "-",
+            "yes" if program.jmp_pin else "-", " ".join(program.public)))
+        if show_hex:
+            for address, (instruction, text) in enumerate(program.code):
+                print("    0x%04x, // %2d: %s" % (instruction, address, text))
+
+    failed = 0
+    print("\n%-44s %5s  %s" % ("PIO layout", "slots", "programs"))
+    for name, names in LAYOUTS:
+        if not all(n in programs for n in names):
+            continue
+        used = sum(len(programs[n].code) for n in names)
+        ok = used <= PIO_SLOTS
+        failed += not ok
+        print("%-44s %2d/%d  %s%s" % (name, used, PIO_SLOTS, " + ".join("%s (%d)" % (n, len(programs[n].code)) for n in names),
+                                      "" if ok else "  DOES NOT FIT"))
+    return 1 if failed else 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
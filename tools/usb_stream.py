@@ -0,0 +1,381 @@
+#!/usr/bin/env python3
+
+# MIT License
+# Copyright (c) 2024 Thorsten Brehm
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Receive the USB stream of the firmware (FEATURE_USB_STREAM, see firmware/usb/usb_stream.h).
+# The firmware shows up as a serial port (CDC), e.g. /dev/ttyACM0. It sends telemetry twice per
+# second, and bus traces and video snapshots on request. The telemetry lines also show the stream's
+# throughput, measured from the bytes received between two telemetry packets and the firmware's time.
+# Usage:
+#   usb_stream.py <port>                   print the telemetry
+#   usb_stream.py <port> --trace trace.bin request the bus trace (recorder must be stopped), saved in
+#                                          the flash export format of tools/bus_trace.py
+#   usb_stream.py <port> --video video.bin request a snapshot of the displayed video pages, saved as
+#                                          frame/soft switches/flags (3x32bit) followed by the text
+#                                          page (main, aux) and the HIRES page (main, aux)
+#   usb_stream.py <port> --audio audio.wav --seconds N
+#                                          record N seconds of the Mockingboard audio (FEATURE_MOCKINGBOARD)
+#   usb_stream.py --loopback [--ep-size N] run the receiver against a stand-in of the firmware's
+#                                          packetizer and of TinyUSB's transfers, with synthetic data
+#                                          (no hardware needed). --ep-size overrides the CDC endpoint
+#                                          buffer size of the model (CFG_TUD_CDC_EP_BUFSIZE)
+
+import os
+import random
+import struct
+import sys
+import wave
+
+MAGIC        = 0xA2D5
+HEADER       = "<HBBHHI"
+VIDEO        = "<III"
+TRACE_HEADER = "<IHHIIIBBBBIII"
+
+COUNTERS_PACKET, TRACE_HEADER_PACKET, TRACE_VALUES, TRACE_DELTAS, VIDEO_HEADER, VIDEO_DATA, VIDEO_END, AUDIO = range(1, 9)
+
+COUNTER_NAMES = ["time_us", "frame", "bus", "overflow", "resets", "devregs", "switches", "flags",
+                 "bus_busy%", "bus_max", "late_lines", "idle%", "trace", "dropped", "synth_us", "ay_dropped"]
+
+AUDIO_SAMPLE_RATE = 22050
+
+TEXT_SIZE  = 0x400
+HIRES_SIZE = 0x2000
+
+SOFTSW_PAGE_2  = 0x008
+SOFTSW_80STORE = 0x100
+
+class Receiver:
+    def __init__(self, quiet=False):
+        self.buffer   = b""
+        self.seq      = None
+        self.lost     = 0
+        self.quiet    = quiet
+        self.counters = None
+        self.trace    = None # (header bytes, records) of the last complete trace
+        self.video    = None # bytes of the last complete video snapshot
+        self.traceHeader = None
+        self.videoHeader = None
+        self.audio       = []   # stereo samples, packed as 32bit words
+        self.audioNext   = None # sample number of the next audio packet
+        self.audioGaps   = 0
+        self.bytes       = 0    # bytes received
+        self.rateStart   = None # (bytes, firmware time) at the previous telemetry packet
+        self.rate        = 0    # bytes/s between the last two telemetry packets
+
+    def feed(self, data):
+        self.bytes  += len(data)
+        self.buffer += data
+        size = struct.calcsize(HEADER)
+        while len(self.buffer) >= size:
+            (magic, ptype, seq, length, reserved, arg) = struct.unpack_from(HEADER, self.buffer, 0)
+            if magic != MAGIC:
+                # resynchronize on the next magic word
+                self.buffer = self.buffer[1:]
+                continue
+            if len(self.buffer) < size + length:
+                break
+            payload = self.buffer[size:size+length]
+            self.buffer = self.buffer[size+length:]
+            if (self.seq is not None) and (seq != ((self.seq + 1) & 0xff)):
+                self.lost += (seq - self.seq - 1) & 0xff
+            self.seq = seq
+            self.packet(ptype, arg, payload)
+
+    def packet(self, ptype, arg, payload):
+        if ptype == COUNTERS_PACKET:
+            values = struct.unpack_from("<%dI" % (len(payload) // 4), payload, 0)
+            self.counters = dict(zip(COUNTER_NAMES, values))
+            if self.rateStart:
+                (bytes0, time0) = self.rateStart
+                elapsed = (self.counters["time_us"] - time0) & 0xffffffff
+                if elapsed:
+                    self.rate = (self.bytes - bytes0) * 1000000 // elapsed
+            self.rateStart = (self.bytes, self.counters["time_us"])
+            if not self.quiet:
+                print(" ".join("%s=%d" % (k, v) for (k, v) in self.counters.items() if k != "switches" and k != "flags") +
+                      " switches=%08x flags=%08x lost=%d rate=%.1fKB/s" % (self.counters["switches"], self.counters["flags"], self.lost, self.rate/1024))
+        elif ptype == TRACE_HEADER_PACKET:
+            count = struct.unpack_from(TRACE_HEADER, payload, 0)[3]
+            self.traceHeader = (payload, [0]*count, [0]*count, [False]*count, [False]*count)
+            if count == 0:
+                self.traceComplete()
+        elif ptype in (TRACE_VALUES, TRACE_DELTAS) and self.traceHeader:
+            (header, values, deltas, haveValues, haveDeltas) = self.traceHeader
+            (fmt, target, have) = ("<I", values, haveValues) if ptype == TRACE_VALUES else ("<H", deltas, haveDeltas)
+            elem = struct.calcsize(fmt)
+            for i in range(len(payload) // elem):
+                if arg + i < len(target):
+                    target[arg+i] = struct.unpack_from(fmt, payload, i*elem)[0]
+                    have[arg+i] = True
+            if all(haveValues) and all(haveDeltas):
+                self.traceComplete()
+        elif ptype == VIDEO_HEADER:
+            self.videoHeader = (payload, {})
+        elif ptype == VIDEO_DATA and self.videoHeader:
+            self.videoHeader[1][arg] = payload
+        elif ptype == VIDEO_END and self.videoHeader:
+            (header, chunks) = self.videoHeader
+            (frame, switches, flags) = struct.unpack_from(VIDEO, header, 0)
+            page2 = 1 if (switches & (SOFTSW_80STORE | SOFTSW_PAGE_2)) == SOFTSW_PAGE_2 else 0
+            data = bytearray(header)
+            for (base, size) in ((TEXT_SIZE, TEXT_SIZE), (HIRES_SIZE, HIRES_SIZE)):
+                for aux in (0, 1):
+                    segment = bytearray(size)
+                    for (key, chunk) in chunks.items():
+                        address = key & 0xffff
+                        if ((key >> 16) == aux) and (base*(1+page2) <= address < base*(2+page2)):
+                            offset = address - base*(1+page2)
+                            segment[offset:offset+len(chunk)] = chunk
+                    data += segment
+            self.video = bytes(data)
+            self.videoHeader = None
+            if not self.quiet:
+                print("video snapshot: frames %d-%d, soft switches %08x" % (frame, arg, switches))
+        elif ptype == AUDIO:
+            if (self.audioNext is not None) and (arg != self.audioNext):
+                self.audioGaps += 1
+            self.audioNext = (arg + len(payload) // 4) & 0xffffffff
+            self.audio += struct.unpack_from("<%dI" % (len(payload) // 4), payload, 0)
+
+    def traceComplete(self):
+        (header, values, deltas, haveValues, haveDeltas) = self.traceHeader
+        self.trace = (header, list(zip(values, deltas)))
+        self.traceHeader = None
+        if not self.quiet:
+            print("bus trace: %d records" % len(values) if values else "bus trace: empty (recorder armed?)")
+
+def writeWav(filename, samples):
+    with wave.open(filename, "wb") as f:
+        f.setnchannels(2)
+        f.setsampwidth(2)
+        f.setframerate(AUDIO_SAMPLE_RATE)
+        f.writeframes(b"".join(struct.pack("<I", s) for s in samples))
+
+def writeTrace(filename, trace):
+    (header, records) = trace
+    with open(filename, "wb") as f:
+        f.write(header)
+        for (value, cycles) in records:
+            f.write(struct.pack("<II", value, cycles))
+
+class Loopback:
+    """Stand-in for the firmware's side of the stream (usb_stream.c): the same packets, chunking,
+    ring wrap-around and per-frame rate limit, on synthetic data. The USB transport is modelled like
+    TinyUSB's CDC class: packets are queued in the TX FIFO, and the tud_task() call of each frame
+    starts a single IN transfer of at most EP_BUFSIZE bytes."""
+    FRAME_BYTES   = 2048 # USB_STREAM_FRAME_BYTES
+    TX_BUFSIZE    = 2048 # CFG_TUD_CDC_TX_BUFSIZE
+    EP_BUFSIZE    = 2048 # CFG_TUD_CDC_EP_BUFSIZE
+    CHUNK         = 512
+    COUNTER_FRAMES = 30
+    TRACE_SIZE    = 1024
+
+    def __init__(self):
+        rnd = random.Random(2)
+        self.seq      = 0
+        self.frame    = 0
+        self.requests = b""
+        self.switches = SOFTSW_PAGE_2 | 0x1 # text mode, page 2
+        self.main = bytearray(rnd.getrandbits(8) for i in range(0x6000))
+        self.aux  = bytearray(rnd.getrandbits(8) for i in range(0x6000))
+        # a stopped recording which wrapped around the ring
+        self.traceIndex  = 1500
+        self.traceValues = [rnd.getrandbits(32) for i in range(self.TRACE_SIZE)]
+        self.traceDeltas = [rnd.getrandbits(16) for i in range(self.TRACE_SIZE)]
+        self.xfer = None
+        self.audio = False
+        self.audioWrite = 0
+        self.pcm = [0]*2048
+        self.fifo = bytearray()
+
+    def expectedTrace(self):
+        first = self.traceIndex - self.TRACE_SIZE
+        return [(self.traceValues[(first+i) % self.TRACE_SIZE], self.traceDeltas[(first+i) % self.TRACE_SIZE])
+                for i in range(self.TRACE_SIZE)]
+
+    def expectedVideo(self):
+        page2 = 1
+        return (struct.pack(VIDEO, 0, self.switches, 0) +
+                self.main[TEXT_SIZE*(1+page2):TEXT_SIZE*(2+page2)] + self.aux[TEXT_SIZE*(1+page2):TEXT_SIZE*(2+page2)] +
+                self.main[HIRES_SIZE*(1+page2):HIRES_SIZE*(2+page2)] + self.aux[HIRES_SIZE*(1+page2):HIRES_SIZE*(2+page2)])
+
+    def write(self, data):
+        self.requests += data
+
+    def packet(self, ptype, arg, payload):
+        size = struct.calcsize(HEADER) + len(payload)
+        if (size > self.budget) or (len(self.fifo) + size > self.TX_BUFSIZE):
+            return False
+        self.budget -= size
+        self.fifo += struct.pack(HEADER, MAGIC, ptype, self.seq, len(payload), 0, arg) + payload
+        self.seq = (self.seq + 1) & 0xff
+        return True
+
+    def packets(self):
+        # generator of the transfer steps: yields whenever the frame's budget is used up
+        if self.xfer == b"T":
+            count = self.TRACE_SIZE
+            header = struct.pack(TRACE_HEADER, 0x52543241, 2, struct.calcsize(TRACE_HEADER), count, 0xffffffff, 250000, 1, 9, 10, 11, 0x10000, 0x10000, 0)
+            while not self.packet(TRACE_HEADER_PACKET, 0, header):
+                yield
+            for (ptype, ring, fmt) in ((TRACE_VALUES, self.traceValues, "<I"), (TRACE_DELTAS, self.traceDeltas, "<H")):
+                elem = struct.calcsize(fmt)
+                pos = 0
+                while pos < count:
+                    first = (self.traceIndex - count + pos) % self.TRACE_SIZE
+                    records = min(count - pos, self.TRACE_SIZE - first, self.CHUNK // elem)
+                    payload = b"".join(struct.pack(fmt, v) for v in ring[first:first+records])
+                    while not self.packet(ptype, pos, payload):
+                        yield
+                    pos += records
+        elif self.xfer == b"V":
+            while not self.packet(VIDEO_HEADER, 0, struct.pack(VIDEO, self.frame, self.switches, 0)):
+                yield
+            for size in (TEXT_SIZE, HIRES_SIZE):
+                for (aux, memory) in ((0, self.main), (1, self.aux)):
+                    for pos in range(0, size, self.CHUNK):
+                        address = size*2 + pos
+                        while not self.packet(VIDEO_DATA, address | (aux << 16), bytes(memory[address:address+self.CHUNK])):
+                            yield
+            while not self.packet(VIDEO_END, self.frame, b""):
+                yield
+
+    def read(self):
+        # one frame of the stream: tud_task() transfers what the previous frames queued
+        out = bytes(self.fifo[:self.EP_BUFSIZE])
+        del self.fifo[:self.EP_BUFSIZE]
+        self.budget = self.FRAME_BYTES
+        for request in self.requests:
+            if request == ord("A"):
+                self.audio = not self.audio
+                self.audioRead = self.audioWrite
+                continue
+            self.xfer = bytes([request])
+            self.steps = self.packets()
+        self.requests = b""
+        # one frame of audio: a ramp, which makes lost or repeated samples visible
+        for i in range(AUDIO_SAMPLE_RATE // 60):
+            self.pcm[self.audioWrite % len(self.pcm)] = self.audioWrite & 0xffffffff
+            self.audioWrite += 1
+        # audio goes first: it must keep up with the synthesis
+        while self.audio and self.audioRead != self.audioWrite:
+            first = self.audioRead % len(self.pcm)
+            samples = min(self.audioWrite - self.audioRead, len(self.pcm) - first, self.CHUNK // 4)
+            if not self.packet(AUDIO, self.audioRead, struct.pack("<%dI" % samples, *self.pcm[first:first+samples])):
+                break
+            self.audioRead += samples
+        if self.frame % self.COUNTER_FRAMES == 0:
+            counters = [self.frame*16667, self.frame, self.frame*17030, 0, 1, 0, self.switches, 0, 42, 120, 0, 35, 1024, 0, 61000, 0]
+            self.packet(COUNTERS_PACKET, 0, struct.pack("<%dI" % len(counters), *counters))
+        if self.xfer:
+            if next(self.steps, "done") == "done":
+                self.xfer = None
+        self.frame += 1
+        return out
+
+def loopback(epSize):
+    device = Loopback()
+    if epSize:
+        device.EP_BUFSIZE = epSize
+    receiver = Receiver()
+    device.write(b"T")
+    for frame in range(30):
+        receiver.feed(device.read())
+    device.write(b"VA")
+    for frame in range(90):
+        # deliver the stream in odd pieces, as the USB host does
+        data = device.read()
+        for i in range(0, len(data), 100):
+            receiver.feed(data[i:i+100])
+
+    ok = True
+    if (receiver.trace is None) or (receiver.trace[1] != device.expectedTrace()):
+        print("FAILED: bus trace mismatch")
+        ok = False
+    if (receiver.video is None) or (receiver.video[12:] != device.expectedVideo()[12:]):
+        print("FAILED: video snapshot mismatch")
+        ok = False
+    if (len(receiver.audio) < AUDIO_SAMPLE_RATE//2) or receiver.audioGaps or \
+       any(receiver.audio[i+1] != receiver.audio[i]+1 for i in range(len(receiver.audio)-1)):
+        print("FAILED: audio samples lost")
+        ok = False
+    if receiver.lost:
+        print("FAILED: %d packets lost" % receiver.lost)
+        ok = False
+    print("loopback: %d bytes in %d frames (%.1fKB/s at 60Hz)" % (receiver.bytes, device.frame, receiver.bytes*60/device.frame/1024))
+    print("loopback: %s" % ("OK" if ok else "FAILED"))
+    return 0 if ok else 1
+
+def main(argv):
+    if "--loopback" in argv:
+        return loopback(int(argv[argv.index("--ep-size")+1]) if "--ep-size" in argv else None)
+    if len(argv) < 2:
+        print("Usage: %s <port> [--trace trace.bin] [--video video.bin] [--audio audio.wav --seconds N] | --loopback" % argv[0])
+        return 1
+
+    import tty
+    fd = os.open(argv[1], os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+    traceFile = argv[argv.index("--trace")+1] if "--trace" in argv else None
+    videoFile = argv[argv.index("--video")+1] if "--video" in argv else None
+    audioFile = argv[argv.index("--audio")+1] if "--audio" in argv else None
+    seconds   = float(argv[argv.index("--seconds")+1]) if "--seconds" in argv else 10.0
+
+    receiver = Receiver()
+    # one transfer at a time: the video snapshot is requested once the trace is complete
+    if traceFile:
+        os.write(fd, b"T")
+    elif videoFile:
+        os.write(fd, b"V")
+    if audioFile:
+        os.write(fd, b"A")
+    try:
+        while True:
+            receiver.feed(os.read(fd, 4096))
+            if traceFile and receiver.trace:
+                writeTrace(traceFile, receiver.trace)
+                print("saved %s" % traceFile)
+                traceFile = None
+                if videoFile:
+                    os.write(fd, b"V")
+            if videoFile and receiver.video and not traceFile:
+                with open(videoFile, "wb") as f:
+                    f.write(receiver.video)
+                print("saved %s" % videoFile)
+                videoFile = None
+            if audioFile and len(receiver.audio) >= seconds * AUDIO_SAMPLE_RATE:
+                os.write(fd, b"A")
+                writeWav(audioFile, receiver.audio)
+                print("saved %s (%d gaps)" % (audioFile, receiver.audioGaps))
+                audioFile = None
+            if (len(argv) > 2) and not traceFile and not videoFile and not audioFile:
+                break
+    except KeyboardInterrupt:
+        if audioFile and receiver.audio:
+            writeWav(audioFile, receiver.audio)
+            print("saved %s (%d gaps)" % (audioFile, receiver.audioGaps))
+    finally:
+        os.close(fd)
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))